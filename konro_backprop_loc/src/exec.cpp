@@ -39,9 +39,8 @@ static void soft_sighandler(int signum) {
 
 static void __attribute__((__noreturn__)) execute(char **argv) {
   /* PreInit from current process */
-  cpu_set_t mask, def;
+  cpu_set_t mask;
   CPU_ZERO(&mask);
-  CPU_ZERO(&def);
 
   /* Set up signal handler to properly finalize DLB */
   struct sigaction sa = {.sa_handler = &soft_sighandler};
@@ -52,21 +51,14 @@ static void __attribute__((__noreturn__)) execute(char **argv) {
   sigaction(SIGABRT, &sa, NULL);
   sigaction(SIGTERM, &sa, NULL);
 
-  /* Fork-exec */
-  pid_t pid = fork();
+  /* Spawn-exec: the child starts in its Konro cgroup and returns from
+   * spawn only when Konro has set its CPUs. This process has a single
+   * thread, so the child can use the C library until execvp */
+  pid_t pid = konro::spawn(argv[0]);
   if (pid < 0) {
     exit(EXIT_FAILURE);
   } else if (pid == 0) {
-
-    sched_getaffinity(pid, sizeof(cpu_set_t), &mask);
-    sched_getaffinity(pid, sizeof(cpu_set_t), &def);
-
-    konro::sendAddMessage();
-
-    while (CPU_EQUAL(&mask, &def)) {
-      sched_getaffinity(pid, sizeof(cpu_set_t), &mask);
-      usleep(100000);
-    }
+    sched_getaffinity(0, sizeof(cpu_set_t), &mask);
     int error = DLB_PreInit(&mask, NULL);
     printf("err: %i\n", error);
     execvp(argv[0], argv);
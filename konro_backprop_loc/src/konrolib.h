@@ -2,6 +2,7 @@
 #define KONROFEEDBACK_H
 
 #include <string>
+#include <sys/types.h>
 
 /*!
  * \brief client library for implementing integrated applications.
@@ -47,6 +48,44 @@ namespace konro {
      */
     extern std::string sendAddMessage();
 
+    /*!
+     * Reserves an empty cgroup prepared by Konro for an application
+     * which has not been started yet.
+     *
+     * The file descriptor can be passed to clone3() with the
+     * CLONE_INTO_CGROUP flag, so that the application is created
+     * directly in its cgroup. The caller must close it.
+     *
+     * \return the file descriptor of the cgroup directory, or -1 in
+     *         case of error
+     */
+    extern int reserveCgroup();
+
+    /*!
+     * Creates a child process managed by Konro, like fork().
+     *
+     * If the calling process has a single thread, the child is created
+     * with clone3() inside a cgroup reserved with reserveCgroup(), so it
+     * is never migrated. Otherwise, or if a cgroup cannot be reserved
+     * or used (e.g. the process has no write access to it), the child
+     * is created with fork() and Konro moves it.
+     * In both cases the child returns from spawn() only when the policy
+     * has placed it, so the program started by exec() runs with its
+     * resources from the first instruction.
+     * \p
+     * The child of clone3() should call exec() soon: the C library does
+     * not run the fork handlers and does not update its per-thread data
+     * as it does for fork(), so functions which use the thread id
+     * (e.g. raise(), abort()) must not be called before exec(). The
+     * other functions are safe because the parent has a single thread.
+     *
+     * \param name the name of the application sent to Konro; if empty,
+     *        the name of the calling program
+     * \return like fork(): 0 in the child, the pid of the child in the
+     *         parent, -1 in case of error
+     */
+    extern pid_t spawn(const std::string &name = "");
+
 }   // namespace feedback
 
 #endif // KONROFEEDBACK_H
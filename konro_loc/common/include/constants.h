@@ -3,6 +3,7 @@
 
 #if defined(KONRO_RM)
 	#define CONFIG_PATH "konro.ini"
+	#define STATE_JOURNAL_PATH "konro.journal"
 #elif defined(KORNO_APPLIB)
 	#define CONFIG_PATH "applib.ini"
 #elif defined(KONRO_COMMON)
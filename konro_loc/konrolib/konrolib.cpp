@@ -3,8 +3,14 @@
 #include "../lib/httplib/httplib.h"
 #include "../lib/json/json.hpp"
 #include <string>
+#include <fstream>
+#include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <cerrno>
+#include <fcntl.h>
+#include <linux/sched.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -79,6 +85,56 @@ namespace {
     }
 
 #undef PID_FNAME
+
+    /*!
+     * \brief Sends an add message for a process to Konro
+     * \param wait if true, Konro replies when the process has been placed
+     */
+    std::string sendAdd(pid_t pid, const std::string &name, bool wait) {
+        nlohmann::json j;
+        j["pid"] = pid;
+        j["namespace"] = getPidNamespace();
+        j["name"] = name;
+        if (wait) {
+            j["wait"] = true;
+        }
+        return sendPost("add", j.dump());
+    }
+
+    /*!
+     * \brief Returns true if the calling process has a single thread
+     */
+    bool isSingleThreaded() {
+        std::ifstream ifs("/proc/self/status");
+        std::string line;
+        while (std::getline(ifs, line)) {
+            if (line.compare(0, 8, "Threads:") == 0)
+                return std::atoi(line.c_str() + 8) == 1;
+        }
+        return false;
+    }
+
+    /*!
+     * \brief Creates a child process inside the cgroup "cgroupFd"
+     *
+     * The raw clone3() bypasses the C library: the fork handlers are not
+     * run and the locks of malloc and stdio are not reset, so the child
+     * may only use the C library if the parent has a single thread.
+     * \return like fork(); -1 if clone3() is not available
+     */
+    pid_t cloneIntoCgroup([[maybe_unused]] int cgroupFd) {
+#if defined(SYS_clone3) && defined(CLONE_INTO_CGROUP)
+        struct clone_args args;
+        memset(&args, 0, sizeof(args));
+        args.flags = CLONE_INTO_CGROUP;
+        args.exit_signal = SIGCHLD;
+        args.cgroup = static_cast<__u64>(cgroupFd);
+        return static_cast<pid_t>(syscall(SYS_clone3, &args, sizeof(args)));
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
 }
 
 template<typename T>
@@ -126,12 +182,7 @@ std::string sendAddMessage()
     microseconds us;
 #endif
 
-    nlohmann::json j;
-    j["pid"] = getpid();
-    j["namespace"] = getPidNamespace();
-    j["name"] = getProgramName();
-
-    std::string out = sendPost("add", j.dump());
+    std::string out = sendAdd(getpid(), getProgramName(), false);
 
 #ifdef TIMING
     high_resolution_clock::time_point _end_ = high_resolution_clock::now();
@@ -144,4 +195,67 @@ std::string sendAddMessage()
     return out;
 }
 
+int reserveCgroup()
+{
+    std::string reply = sendPost("reserve", "");
+    nlohmann::json j = nlohmann::json::parse(reply, nullptr, false);
+    if (j.is_discarded() || !j.contains("cgroup") || !j["cgroup"].is_string())
+        return -1;
+    std::string cgroupDir = j["cgroup"];
+    return open(cgroupDir.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+}
+
+pid_t spawn(const std::string &name)
+{
+#ifdef TIMING
+    using namespace std::chrono;
+    high_resolution_clock::time_point _start_ = high_resolution_clock::now();
+#endif
+    // the child waits on the pipe until it has been placed
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) < 0)
+        return -1;
+
+    pid_t pid = -1;
+    // with other threads a lock may be held at the time of the clone
+    if (isSingleThreaded()) {
+        int cgroupFd = reserveCgroup();
+        if (cgroupFd >= 0) {
+            pid = cloneIntoCgroup(cgroupFd);
+            close(cgroupFd);
+        }
+    }
+    if (pid < 0) {
+        pid = fork();
+    }
+    if (pid < 0) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(pipeFds[1]);
+        char c;
+        // end of file when the parent closes the pipe (or terminates)
+        while (read(pipeFds[0], &c, 1) < 0 && errno == EINTR)
+            ;
+        close(pipeFds[0]);
+        return 0;
+    }
+
+    close(pipeFds[0]);
+    sendAdd(pid, name.empty() ? getProgramName() : name, true);
+    close(pipeFds[1]);
+
+#ifdef TIMING
+    high_resolution_clock::time_point _end_ = high_resolution_clock::now();
+    microseconds elapsed = std::chrono::duration_cast<microseconds>(_end_ - _start_);
+    std::cout << "KONROLIB timing: spawn = "
+              << elapsed.count()
+              << " microseconds"
+              << std::endl;
+#endif
+    return pid;
+}
+
 }   // namespace feedback
@@ -2,7 +2,11 @@
 #define APP_H
 
 #include "namespaces.h"
+#include "processnames.h"
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <set>
 #include <string>
 #include <unistd.h>
 
@@ -25,8 +29,8 @@ private:
     pid_t pid_;
     /*! The type of the application */
     AppType appType_;
-    /*! The name of the application */
-    std::string name_;
+    /*! The name of the application, read from /proc on first use if null */
+    mutable std::atomic<ProcessNames::Name> name_;
     /*! The PID of the application in its own PID namespace.
         If 0, the app belongs to Konro's ns and this field should be ignored. */
     pid_t nsPid_;
@@ -36,8 +40,13 @@ private:
 
     std::string cgroupDir_;
 
+    /*! The threads created by the application after it was added to Konro */
+    std::set<pid_t> threads_;
+
     App(pid_t pid, AppType appType, std::string appName, pid_t nsPid, namespace_t ns) :
-        pid_(pid), appType_(appType), name_(appName), nsPid_(nsPid), ns_(ns) {}
+        pid_(pid), appType_(appType),
+        name_(appName.empty() ? nullptr : ProcessNames::intern(appName)),
+        nsPid_(nsPid), ns_(ns) {}
 
 public:
     typedef std::shared_ptr<App> AppPtr;
@@ -129,10 +138,37 @@ public:
 
     /*!
      * \brief Gets the name of the application
+     *
+     * If the name is not known yet, it is read from /proc/<pid>/cmdline
+     * and cached, so that the name is read at most once.
      * \return the application's name
      */
-    const std::string &getName() const noexcept {
-        return name_;
+    ProcessNames::Name getNamePtr() const {
+        ProcessNames::Name name = name_.load();
+        if (!name) {
+            ProcessNames::Name expected;
+            name = ProcessNames::read(pid_);
+            // keep the name set by a concurrent call
+            if (!name_.compare_exchange_strong(expected, name))
+                name = expected;
+        }
+        return name;
+    }
+
+    /*!
+     * \brief Gets the name of the application
+     * \return the application's name
+     */
+    std::string getName() const {
+        return *getNamePtr();
+    }
+
+    /*!
+     * \brief Checks if the name of the application is known,
+     *        i.e. getName() does not need to access /proc
+     */
+    bool hasName() const noexcept {
+        return name_.load() != nullptr;
     }
 
     /*!
@@ -140,7 +176,53 @@ public:
      * \param name the application's name
      */
     void setName(const std::string &appName) {
-        name_ = appName;
+        name_.store(ProcessNames::intern(appName));
+    }
+
+    /*!
+     * \brief Shares the name of another application, e.g. of the
+     *        parent of a forked process
+     */
+    void setName(const App &other) {
+        name_.store(other.name_.load());
+    }
+
+    /*!
+     * \brief Forgets the name of the application (e.g. after an exec),
+     *        so that it is read again on the next use
+     */
+    void resetName() {
+        name_.store(nullptr);
+    }
+
+    /*!
+     * \brief Adds a thread of the application.
+     *
+     * Threads are members of the App of their process and share its
+     * cgroup. The thread list is managed by the WorkloadManager thread.
+     * \param tid the thread id
+     */
+    void addThread(pid_t tid) {
+        threads_.insert(tid);
+    }
+
+    /*!
+     * \brief Removes a thread of the application
+     * \return true if the thread was a member of the application
+     */
+    bool removeThread(pid_t tid) {
+        return threads_.erase(tid) > 0;
+    }
+
+    /*!
+     * \brief Removes all the threads of the application (e.g. after an exec)
+     */
+    void clearThreads() {
+        threads_.clear();
+    }
+
+    std::size_t getThreadCount() const noexcept {
+        return threads_.size();
     }
 
     const std::string getCgroupDir() const noexcept {
@@ -0,0 +1,136 @@
+#ifndef APPREGISTRY_H
+#define APPREGISTRY_H
+
+#include "namespaces.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief The set of applications managed by a Konro component
+ *
+ * Applications are indexed by pid and, for applications running in
+ * another PID namespace, by (namespace, pid in the namespace): both
+ * lookups take constant time and need no temporary object.
+ * The applications are stored in a vector, so iterating over them
+ * is as fast as iterating over an array; the iteration order is
+ * not specified.
+ * \p
+ * T must provide getPid(), getNsPid() and getPidNamespace().
+ * The registry is not threadsafe.
+ */
+template<typename T>
+class AppRegistry {
+public:
+    using Ptr = std::shared_ptr<T>;
+    using const_iterator = typename std::vector<Ptr>::const_iterator;
+
+    /*! default number of applications for which memory is reserved */
+    static constexpr std::size_t DEFAULT_CAPACITY = 16384;
+
+private:
+    struct NsPidHash {
+        std::size_t operator()(const std::pair<namespace_t, pid_t> &key) const noexcept {
+            return std::hash<namespace_t>()(key.first) * 31 + std::hash<pid_t>()(key.second);
+        }
+    };
+
+    std::vector<Ptr> apps_;
+    /*! position of each application in apps_ */
+    std::unordered_map<pid_t, std::size_t> byPid_;
+    /*! pid of the applications not in Konro's namespace */
+    std::unordered_map<std::pair<namespace_t, pid_t>, pid_t, NsPidHash> byNsPid_;
+
+public:
+    explicit AppRegistry(std::size_t capacity = DEFAULT_CAPACITY) {
+        apps_.reserve(capacity);
+        byPid_.reserve(capacity);
+    }
+
+    /*!
+     * Adds an application
+     * \return false if an application with the same pid is present
+     */
+    bool insert(Ptr app) {
+        auto res = byPid_.emplace(app->getPid(), apps_.size());
+        if (!res.second)
+            return false;
+        if (app->getPidNamespace() != 0) {
+            byNsPid_[std::make_pair(app->getPidNamespace(), app->getNsPid())] = app->getPid();
+        }
+        apps_.push_back(std::move(app));
+        return true;
+    }
+
+    /*!
+     * Removes the application with the specified pid
+     * \return the removed application, or nullptr if not found
+     */
+    Ptr erase(pid_t pid) {
+        auto it = byPid_.find(pid);
+        if (it == byPid_.end())
+            return nullptr;
+        std::size_t pos = it->second;
+        byPid_.erase(it);
+        Ptr app = std::move(apps_[pos]);
+        if (app->getPidNamespace() != 0) {
+            byNsPid_.erase(std::make_pair(app->getPidNamespace(), app->getNsPid()));
+        }
+        // fill the hole with the last application
+        if (pos != apps_.size() - 1) {
+            apps_[pos] = std::move(apps_.back());
+            byPid_[apps_[pos]->getPid()] = pos;
+        }
+        apps_.pop_back();
+        return app;
+    }
+
+    /*!
+     * Returns the application with the specified pid, or nullptr
+     */
+    Ptr find(pid_t pid) const {
+        auto it = byPid_.find(pid);
+        return it == byPid_.end() ? nullptr : apps_[it->second];
+    }
+
+    /*!
+     * Returns the application with the specified pid in the specified
+     * PID namespace, or nullptr. Namespace 0 is Konro's namespace.
+     */
+    Ptr findByNsPid(pid_t nspid, namespace_t ns) const {
+        if (ns == 0)
+            return find(nspid);
+        auto it = byNsPid_.find(std::make_pair(ns, nspid));
+        return it == byNsPid_.end() ? nullptr : find(it->second);
+    }
+
+    bool contains(pid_t pid) const {
+        return byPid_.find(pid) != byPid_.end();
+    }
+
+    std::size_t size() const noexcept {
+        return apps_.size();
+    }
+
+    bool empty() const noexcept {
+        return apps_.empty();
+    }
+
+    const_iterator begin() const noexcept {
+        return apps_.begin();
+    }
+
+    const_iterator end() const noexcept {
+        return apps_.end();
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // APPREGISTRY_H
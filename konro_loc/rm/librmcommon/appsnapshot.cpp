@@ -0,0 +1,94 @@
+#include "appsnapshot.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace rmcommon {
+
+namespace {
+
+/*! Prints a string as a JSON string */
+void printJsonString(ostream &os, const string &s)
+{
+    os << '"';
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            os << buf;
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+}   // namespace
+
+AppSnapshot &AppSnapshot::instance()
+{
+    static AppSnapshot snapshot;
+    return snapshot;
+}
+
+uint64_t AppSnapshot::add(shared_ptr<App> app)
+{
+    lock_guard<mutex> lck(mut_);
+    if (apps_.insert(move(app)))
+        ++version_;
+    return version_;
+}
+
+uint64_t AppSnapshot::remove(pid_t pid)
+{
+    lock_guard<mutex> lck(mut_);
+    if (apps_.erase(pid))
+        ++version_;
+    return version_;
+}
+
+uint64_t AppSnapshot::version()
+{
+    lock_guard<mutex> lck(mut_);
+    return version_;
+}
+
+size_t AppSnapshot::size()
+{
+    lock_guard<mutex> lck(mut_);
+    return apps_.size();
+}
+
+void AppSnapshot::printOnOstream(ostream &os)
+{
+    // copy the pointers, so that formatting does not block the updates
+    vector<shared_ptr<App>> apps;
+    uint64_t version;
+    {
+        lock_guard<mutex> lck(mut_);
+        apps.assign(apps_.begin(), apps_.end());
+        version = version_;
+    }
+    os << "{\"version\":" << version << ",\"apps\":[";
+    const char *sep = "";
+    for (const auto &app: apps) {
+        os << sep
+           << "{\"pid\":" << app->getPid()
+           << ",\"type\":\"" << App::getAppTypeString(app->getAppType())
+           << "\",\"name\":";
+        printJsonString(os, app->hasName() ? app->getName() : string());
+        if (app->getPidNamespace() != 0) {
+            os << ",\"nspid\":" << app->getNsPid()
+               << ",\"namespace\":" << app->getPidNamespace();
+        }
+        os << "}";
+        sep = ",";
+    }
+    os << "]}";
+}
+
+}   // namespace rmcommon
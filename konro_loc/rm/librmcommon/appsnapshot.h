@@ -0,0 +1,60 @@
+#ifndef APPSNAPSHOT_H
+#define APPSNAPSHOT_H
+
+#include "app.h"
+#include "appregistry.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief The applications currently monitored by Konro
+ *
+ * The WorkloadManager updates the snapshot at each addition and removal,
+ * in constant time; other threads (e.g. the HTTP server) read it on
+ * demand. Every change increments the version, so a reader can tell
+ * whether the set changed since its last query.
+ */
+class AppSnapshot {
+    std::mutex mut_;
+    AppRegistry<App> apps_;
+    std::uint64_t version_;
+
+    AppSnapshot() : version_(0) {}
+
+public:
+    static AppSnapshot &instance();
+
+    AppSnapshot(const AppSnapshot &) = delete;
+    AppSnapshot &operator=(const AppSnapshot &) = delete;
+
+    /*!
+     * Adds an application
+     * \return the new version of the snapshot
+     */
+    std::uint64_t add(std::shared_ptr<App> app);
+
+    /*!
+     * Removes the application with the specified pid
+     * \return the new version of the snapshot
+     */
+    std::uint64_t remove(pid_t pid);
+
+    std::uint64_t version();
+
+    std::size_t size();
+
+    /*!
+     * Prints the version and the applications as a JSON object.
+     * Only the names already known are printed, so /proc is not read.
+     */
+    void printOnOstream(std::ostream &os);
+};
+
+}   // namespace rmcommon
+
+#endif // APPSNAPSHOT_H
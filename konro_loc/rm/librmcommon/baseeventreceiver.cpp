@@ -7,13 +7,48 @@ using namespace std;
 namespace rmcommon {
 
 BaseEventReceiver::BaseEventReceiver(const char *threadName) :
+    queue_({QUEUE_CAPACITY, CONTROL_QUOTA}),
     threadName_(threadName)
 {
 }
 
 void BaseEventReceiver::addEvent(std::shared_ptr<const BaseEvent> event)
 {
-    queue_.push(event);
+    if (coalescer_.offer(event)) {
+        std::size_t id = event->getTypeId();
+        std::size_t lane = CONTROL_LANE;
+        if (id < lanes_.size()) {
+            lane = lanes_[id];
+        }
+        queue_.push(event, lane);
+    }
+}
+
+void BaseEventReceiver::stop()
+{
+    BaseThread::stop();
+    queue_.interrupt();
+}
+
+bool BaseEventReceiver::processEvent(std::shared_ptr<const BaseEvent> event)
+{
+    dispatcher_.dispatch(event);
+    return true;
+}
+
+BaseEventReceiver::EventLatency &BaseEventReceiver::eventLatency(const BaseEvent &event)
+{
+    std::size_t id = event.getTypeId();
+    if (latency_.size() <= id) {
+        latency_.resize(id + 1);
+    }
+    EventLatency &lat = latency_[id];
+    if (lat.queue == nullptr) {
+        LatencyStats &stats = LatencyStats::instance();
+        lat.queue = &stats.histogram(threadName_, event.getName(), "queue");
+        lat.handle = &stats.histogram(threadName_, event.getName(), "handle");
+    }
+    return lat;
 }
 
 void BaseEventReceiver::run()
@@ -22,18 +57,30 @@ void BaseEventReceiver::run()
 
     using Logger = log4cpp::Category;
     Logger::getRoot().info("%s starts", getThreadName().c_str());
+    vector<shared_ptr<const rmcommon::BaseEvent>> batch;
     while (!stopped()) {
-        shared_ptr<const rmcommon::BaseEvent> event;
-        if (queue_.waitAndPop(event, WAIT_POP_TIMEOUT_MILLIS)) {
-//            Logger::getRoot().info("BASEEEVENTRECEIVER received event %s",
-//                                   event->getName().c_str());
-            if (!processEvent(event))
-                stop();
-        } else {
-            // Logger::getRoot().info("BaseEventReceiver: no event");
+        if (queue_.waitAndDrain(batch) > 0) {
+            KonroTimer::TimePoint start = KonroTimer::now();
+            for (auto &queued: batch) {
+                shared_ptr<const BaseEvent> event = coalescer_.take(queued);
+//                Logger::getRoot().info("BASEEEVENTRECEIVER received event %s",
+//                                       event->getName().c_str());
+                EventLatency &lat = eventLatency(*event);
+                lat.queue->record(chrono::duration_cast<KonroTimer::TimeUnit>(start - event->getTimePoint()));
+                bool goOn = processEvent(event);
+                KonroTimer::TimePoint end = KonroTimer::now();
+                lat.handle->record(chrono::duration_cast<KonroTimer::TimeUnit>(end - start));
+                start = end;
+                if (!goOn) {
+                    stop();
+                    break;
+                }
+            }
+            batch.clear();
         }
     }
-    Logger::getRoot().info("%s stops", getThreadName().c_str());
+    Logger::getRoot().info("%s stops, %lu events coalesced", getThreadName().c_str(),
+                           (unsigned long)getCoalescedEvents());
 }
 
 
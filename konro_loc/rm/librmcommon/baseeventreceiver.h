@@ -2,12 +2,18 @@
 #define BASEEVENTRECEIVER_H
 
 #include "basethread.h"
-#include "threadsafequeue.h"
+#include "lanequeue.h"
+#include "eventbus.h"
+#include "eventdispatcher.h"
+#include "eventcoalescer.h"
+#include "latencystats.h"
 #include "events/baseevent.h"
 #include <string>
 #include <thread>
 #include <atomic>
 #include <chrono>
+#include <vector>
+#include <cstdint>
 
 namespace rmcommon {
 
@@ -16,21 +22,63 @@ namespace rmcommon {
  * events in a separate thread.
  * \p
  * BaseEventReceiver receives BaseEvents via addEvent
- * and puts them in a queue. For each event, the processEvent
- * function is called.
+ * and puts them in a lock-free queue. Each time the thread wakes
+ * up, the pending events are drained from the queue and the
+ * processEvent function is called for each of them. The thread
+ * sleeps without timeout while the queue is empty: stop() wakes it up.
+ * \p
+ * The queue has two lanes. Lifecycle events (the ones which add or
+ * remove applications) are processed before control events; at most
+ * CONTROL_QUOTA control events are processed between two checks of
+ * the lifecycle lane, so that neither lane can starve the other.
+ * \p
+ * For each event type, the time spent in the queue and the time spent
+ * in the handler are recorded in LatencyStats, using the thread name
+ * as component name.
  * \p
  * The thread stops when the stop() function is called or when
  * the processEvent() function returns false.
  * \p
- * Derived classes must override the function
+ * Derived classes declare only the events they care about, by
+ * subscribing a handler for each event type:
  * \code
- * bool processEvent(.....);
+ * subscribe(bus, &MyReceiver::processForkEvent);
  * \endcode
+ * The default processEvent() calls the handler registered for the
+ * type of the event; events without a handler are counted.
+ * \p
+ * Events which only carry the latest state of an application can be
+ * coalesced with coalesce(): while one of them waits in the queue,
+ * newer events for the same application replace it.
  */
 class BaseEventReceiver : public rmcommon::BaseThread {
-    rmcommon::ThreadsafeQueue<std::shared_ptr<const rmcommon::BaseEvent>> queue_;
-    const std::chrono::milliseconds WAIT_POP_TIMEOUT_MILLIS = std::chrono::milliseconds(5000);
+public:
+    enum Lane {
+        LIFECYCLE_LANE,     // events which add or remove applications
+        CONTROL_LANE,       // feedbacks, timers, monitoring data
+        NUM_LANES
+    };
+
+private:
+    static constexpr std::size_t QUEUE_CAPACITY = 4096;
+    static constexpr std::size_t CONTROL_QUOTA = 64;
+
+    rmcommon::LaneQueue<std::shared_ptr<const rmcommon::BaseEvent>, NUM_LANES, QUEUE_CAPACITY> queue_;
+    /*! lane of each event type, indexed by type id */
+    std::vector<std::uint8_t> lanes_;
     std::string threadName_;
+    rmcommon::EventDispatcher dispatcher_;
+    rmcommon::EventCoalescer coalescer_;
+
+    struct EventLatency {
+        LatencyHistogram *queue = nullptr;
+        LatencyHistogram *handle = nullptr;
+    };
+    /*! latency histograms indexed by type id, used by the receiver thread only */
+    std::vector<EventLatency> latency_;
+
+    /*! Returns the latency histograms for the type of the event */
+    EventLatency &eventLatency(const BaseEvent &event);
 
     /*! The thread function */
     virtual void run() override;
@@ -38,8 +86,45 @@ class BaseEventReceiver : public rmcommon::BaseThread {
 protected:
     BaseEventReceiver(const char *threadName);
 
+    /*!
+     * Subscribes to the events of type EventType published on the bus.
+     * The events are queued and later passed to "handler" in the
+     * thread of the receiver.
+     * Must be called before the thread is started.
+     *
+     * \param bus the event bus
+     * \param handler the member function which processes the events
+     * \param lane the queue lane of the events
+     */
+    template<typename T, typename EventType>
+    void subscribe(EventBus &bus, void (T::*handler)(std::shared_ptr<const EventType>),
+                   Lane lane = CONTROL_LANE) {
+        std::size_t id = eventTypeId<EventType>();
+        if (lanes_.size() <= id) {
+            lanes_.resize(id + 1, CONTROL_LANE);
+        }
+        lanes_[id] = lane;
+        dispatcher_.registerHandler(static_cast<T *>(this), handler);
+        bus.subscribe<BaseEventReceiver, EventType, BaseEvent>(this, &BaseEventReceiver::addEvent);
+    }
+
+    /*!
+     * Coalesces the queued events of type EventType by application.
+     * Must be called before subscribing to EventType.
+     *
+     * \param key returns the (pid, namespace) pair of the application
+     *            an event refers to
+     */
+    template<typename EventType, typename KeyFunction>
+    void coalesce(KeyFunction key) {
+        coalescer_.coalesce<EventType>(key);
+    }
+
 public:
 
+    /*! Stops the thread, waking it up if it is waiting for events */
+    virtual void stop() override;
+
     /*!
      * \brief Adds an event to the tread safe queue
      * \param event the event to add
@@ -49,8 +134,25 @@ public:
     /*!
      * Processes a generic event by calling the appropriate handler function.
      * \param event the event to process
+     * \return false to stop the thread
+     */
+    virtual bool processEvent(std::shared_ptr<const rmcommon::BaseEvent> event);
+
+    /*!
+     * Returns the number of events received for which no handler
+     * was subscribed
+     */
+    std::uint64_t getUnhandledEvents() const noexcept {
+        return dispatcher_.getUnhandledEvents();
+    }
+
+    /*!
+     * Returns the number of events merged into an event
+     * which was still waiting in the queue
      */
-    virtual bool processEvent(std::shared_ptr<const rmcommon::BaseEvent> event) = 0;
+    std::uint64_t getCoalescedEvents() const noexcept {
+        return coalescer_.getCoalescedEvents();
+    }
 };
 
 }   // namespace rmcommon
@@ -21,6 +21,21 @@ void BaseThread::start()
 void BaseThread::stop()
 {
     stop_ = true;
+    stopWakeup_.notify();
+}
+
+bool BaseThread::sleepFor(chrono::milliseconds millis)
+{
+    using Clock = chrono::steady_clock;
+    Clock::time_point deadline = Clock::now() + millis;
+    while (!stopped()) {
+        auto remaining = chrono::ceil<chrono::milliseconds>(deadline - Clock::now());
+        if (remaining <= chrono::milliseconds::zero()) {
+            return true;
+        }
+        stopWakeup_.wait(remaining);
+    }
+    return false;
 }
 
 void BaseThread::join()
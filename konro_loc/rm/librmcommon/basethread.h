@@ -2,7 +2,9 @@
 #define BASETHREAD_H
 
 #include "threadname.h"
+#include "wakeup.h"
 #include <string>
+#include <chrono>
 #include <thread>
 #include <atomic>
 
@@ -11,6 +13,7 @@ namespace rmcommon {
 class BaseThread {
     std::thread baseThread_;
     std::atomic_bool stop_;
+    Wakeup stopWakeup_;
 public:
     BaseThread();
     virtual ~BaseThread();
@@ -30,7 +33,7 @@ public:
     /*! Executes the run() function in a new thread */
     virtual void start();
 
-    /*! Sets the stop_ flag to true */
+    /*! Sets the stop_ flag to true and wakes up the thread */
     virtual void stop();
 
     virtual void run() = 0;
@@ -40,6 +43,15 @@ public:
     bool stopped() {
         return stop_;
     }
+
+    /*!
+     * Sleeps for the specified time, or until stop() is called.
+     * Must be called from the run function.
+     *
+     * \param millis the time to sleep
+     * \return false if the thread has been stopped
+     */
+    bool sleepFor(std::chrono::milliseconds millis);
 };
 
 }   // namespace rmcommon
@@ -29,14 +29,14 @@
 
 // This is the interface for MemberFunctionHandler that each specialization will use
 
+#include "eventtypeid.h"
+#include "eventpool.h"
 #include <vector>
-#include <map>
-#include <typeinfo>
-#include <typeindex>
 #include <type_traits>
 #include <memory>
 #include <iostream>
 #include <mutex>
+#include <atomic>
 
 namespace rmcommon {
 
@@ -104,30 +104,52 @@ private:
  * // which is passed to all observers
  * bus.publish(new EventDerived1());
  * \endcode
+ * \p
+ * The subscribers are stored in an immutable table indexed by
+ * eventTypeId<EventType>(). subscribe() builds a new copy of the table
+ * and atomically replaces the current one, so publish() never takes
+ * a lock. Replaced tables are only freed when the EventBus is destroyed,
+ * because a publisher may still be reading them (subscriptions happen
+ * at startup, so only a few tables are ever created).
  */
 class EventBus {
     using HandlerList = std::vector<IHandlerFunctionBase *>;
-    std::map<std::type_index, HandlerList *> subscribers;
+    using SubscriberTable = std::vector<HandlerList>;
+
+    std::atomic<const SubscriberTable *> subscribers;
+    /*! all the tables ever published (the last one is the current one) */
+    std::vector<std::unique_ptr<const SubscriberTable>> tables;
+    /*! all the handlers ever subscribed */
+    std::vector<std::unique_ptr<IHandlerFunctionBase>> handlers;
+    /*! serializes subscriptions */
     std::mutex global_mutex;
 
-public:
-    explicit EventBus() {}
-    ~EventBus() {
-        {
-            std::unique_lock<std::mutex> lck(global_mutex);
-            for (auto &elem: subscribers) {
-                //std::cout << "deleting " << elem.first.hash_code() << std::endl;
-                if (elem.second != nullptr) {
-                    for (auto &handler: *elem.second) {
-                        //std::cout << "deleting handler\n";
-                        delete handler;
-                    }
-                }
-                delete elem.second;
-            }
+    /*!
+     * Returns the observers of the events with the specified type id
+     * or nullptr if there are no observers
+     */
+    const HandlerList *findHandlers(std::size_t id) const {
+        const SubscriberTable *table = subscribers.load(std::memory_order_acquire);
+        if (id >= table->size() || (*table)[id].empty()) {
+            return nullptr;
+        }
+        return &(*table)[id];
+    }
+
+    template<typename EventType>
+    static void dispatch(const HandlerList &handlers, std::shared_ptr<const EventType> &p) {
+        for (auto handler : handlers) {
+            handler->exec(&p);
         }
     }
 
+public:
+    explicit EventBus() {
+        tables.emplace_back(new SubscriberTable());
+        subscribers.store(tables.back().get(), std::memory_order_release);
+    }
+    ~EventBus() = default;
+
     // Disable copy and assignment
     EventBus(const EventBus &other) = delete;
     EventBus &operator=(const EventBus &other) = delete;
@@ -144,40 +166,61 @@ public:
     template<typename T, typename EventType, typename BaseEvent = EventType>
     void subscribe(T *instance, void (T::*memberFunction)(std::shared_ptr<const BaseEvent>)) {
         std::unique_lock<std::mutex> lck(global_mutex);
-        HandlerList *handlers = subscribers[typeid(EventType)];
+        std::size_t id = eventTypeId<EventType>();
 
-        if (handlers == nullptr) {
-            // this is the first subscription for this event type
-            handlers = new HandlerList();
-            subscribers[typeid(EventType)] = handlers;
+        handlers.emplace_back(new MemberFunctionHandler<T, const BaseEvent>(instance, memberFunction));
+
+        // copy-on-write: the current table is never modified
+        SubscriberTable *table = new SubscriberTable(*subscribers.load(std::memory_order_relaxed));
+        if (table->size() <= id) {
+            table->resize(id + 1);
         }
-        IHandlerFunctionBase *ptr = new MemberFunctionHandler<T, const BaseEvent>(instance, memberFunction);
-        handlers->push_back(ptr);
+        (*table)[id].push_back(handlers.back().get());
+        tables.emplace_back(table);
+        subscribers.store(table, std::memory_order_release);
     }
 
     /*!
      * Publishes an event of type EventType. All observers will receive the event.
      * Note that the observers are processed sequentially, i.e. observer2 will not
      * be called until observer1 has finished processing.
+     * The function is wait-free: observers subscribed concurrently with
+     * the call may or may not receive the event.
      *
      * \param event the event to publish. A shared_ptr of this event will be created
      *              from the event and sent to the receivers
      */
     template<typename EventType>
     void publish(EventType *event) {
-        std::unique_lock<std::mutex> lck(global_mutex);
-        HandlerList *handlers = subscribers[typeid(EventType)];
-        if (handlers == nullptr) {
-            return;         // no subscriber for this event type
-        }
         // create the shared_ptr of the event that will be passed
         // to the receivers
         std::shared_ptr<const EventType> p{event}; // = std::shared_ptr<EventType>(event);
-        for (auto handler : *handlers) {
-            if (handler != nullptr) {
-                handler->exec(&p);
-            }
+        const HandlerList *handlers = findHandlers(eventTypeId<EventType>());
+        if (handlers == nullptr) {
+            return;         // no subscriber for this event type
+        }
+        dispatch(*handlers, p);
+    }
+
+    /*!
+     * Creates an event of type EventType with the specified constructor
+     * arguments and publishes it.
+     * The event and its shared_ptr control block are allocated with a
+     * single allocation from a memory pool (see PoolAllocator), which
+     * is cheaper than publish(new EventType(...)) for high-rate events.
+     * If there are no subscribers, the event is not even created.
+     *
+     * \param args the arguments for the constructor of EventType
+     */
+    template<typename EventType, typename... Args>
+    void publishPooled(Args &&...args) {
+        const HandlerList *handlers = findHandlers(eventTypeId<EventType>());
+        if (handlers == nullptr) {
+            return;         // no subscriber for this event type
         }
+        std::shared_ptr<const EventType> p =
+                std::allocate_shared<EventType>(PoolAllocator<EventType>(), std::forward<Args>(args)...);
+        dispatch(*handlers, p);
     }
 };
 
@@ -0,0 +1,130 @@
+#ifndef EVENTCOALESCER_H
+#define EVENTCOALESCER_H
+
+#include "events/baseevent.h"
+#include "eventtypeid.h"
+#include "namespaces.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief Merges queued events which refer to the same application
+ *
+ * For the event types registered with coalesce(), at most one event
+ * per (pid, namespace) waits in the queue of a receiver: while an event
+ * is pending, newer events with the same key replace it instead of being
+ * queued. The pending event keeps its position in the queue, but the
+ * receiver processes the newest value, so the reaction latency does not
+ * grow with the backlog.
+ * \p
+ * offer() may be called by any thread; take() is called by the
+ * receiver thread. Event types must be registered before the first
+ * call to offer().
+ */
+class EventCoalescer {
+public:
+    using AppKey = std::pair<pid_t, namespace_t>;
+
+private:
+    using KeyFunction = std::function<AppKey(const BaseEvent &)>;
+    using Key = std::tuple<std::size_t, pid_t, namespace_t>;
+
+    /*! key functions indexed by event type id */
+    std::vector<KeyFunction> keyFunctions_;
+    /*! newest event for each key waiting in the queue */
+    std::map<Key, std::shared_ptr<const BaseEvent>> pending_;
+    std::mutex mut_;
+    std::atomic<std::uint64_t> coalescedEvents_;
+
+    const KeyFunction *findKeyFunction(std::size_t id) const noexcept {
+        if (id < keyFunctions_.size() && keyFunctions_[id])
+            return &keyFunctions_[id];
+        return nullptr;
+    }
+
+public:
+    EventCoalescer() : coalescedEvents_(0) {}
+
+    /*!
+     * Enables coalescing for the events of type EventType.
+     *
+     * \param key returns the (pid, namespace) pair identifying
+     *            the application an event refers to
+     */
+    template<typename EventType, typename KeyFn>
+    void coalesce(KeyFn key) {
+        std::size_t id = eventTypeId<EventType>();
+        if (keyFunctions_.size() <= id) {
+            keyFunctions_.resize(id + 1);
+        }
+        keyFunctions_[id] = [key](const BaseEvent &event) -> AppKey {
+            // the type id guarantees the concrete type of the event
+            return key(static_cast<const EventType &>(event));
+        };
+    }
+
+    /*!
+     * Called when an event is received.
+     *
+     * \param event the received event
+     * \return true if the event must be queued, false if it
+     *         replaced a pending event
+     */
+    bool offer(const std::shared_ptr<const BaseEvent> &event) {
+        std::size_t id = event->getTypeId();
+        const KeyFunction *keyFn = findKeyFunction(id);
+        if (keyFn == nullptr)
+            return true;
+        AppKey appKey = (*keyFn)(*event);
+        Key key(id, appKey.first, appKey.second);
+        std::lock_guard<std::mutex> lck(mut_);
+        auto res = pending_.emplace(key, event);
+        if (res.second)
+            return true;
+        res.first->second = event;
+        coalescedEvents_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /*!
+     * Called when an event is removed from the queue.
+     *
+     * \param event the event removed from the queue
+     * \return the newest event with the same key, or the event
+     *         itself if its type is not coalesced
+     */
+    std::shared_ptr<const BaseEvent> take(const std::shared_ptr<const BaseEvent> &event) {
+        std::size_t id = event->getTypeId();
+        const KeyFunction *keyFn = findKeyFunction(id);
+        if (keyFn == nullptr)
+            return event;
+        AppKey appKey = (*keyFn)(*event);
+        Key key(id, appKey.first, appKey.second);
+        std::lock_guard<std::mutex> lck(mut_);
+        auto it = pending_.find(key);
+        if (it == pending_.end())
+            return event;
+        std::shared_ptr<const BaseEvent> newest = std::move(it->second);
+        pending_.erase(it);
+        return newest;
+    }
+
+    /*! Returns the number of events merged into a pending event */
+    std::uint64_t getCoalescedEvents() const noexcept {
+        return coalescedEvents_.load(std::memory_order_relaxed);
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // EVENTCOALESCER_H
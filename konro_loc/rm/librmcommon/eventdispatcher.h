@@ -0,0 +1,75 @@
+#ifndef EVENTDISPATCHER_H
+#define EVENTDISPATCHER_H
+
+#include "events/baseevent.h"
+#include "eventtypeid.h"
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+namespace rmcommon {
+
+/*!
+ * \brief Maps each event type to its handler in O(1)
+ *
+ * Handlers are stored in a vector indexed by the type id of the event
+ * (see BaseEvent::getTypeId()), so dispatching an event costs one
+ * indexed load and one indirect call, regardless of the number of
+ * registered event types.
+ * \p
+ * Handlers must be registered before the first call to dispatch();
+ * the class is not threadsafe.
+ */
+class EventDispatcher {
+    using Handler = std::function<void(const std::shared_ptr<const BaseEvent> &)>;
+    std::vector<Handler> handlers_;
+    /*! number of events received without a registered handler */
+    std::uint64_t unhandledEvents_;
+
+public:
+    EventDispatcher() : unhandledEvents_(0) {}
+
+    /*!
+     * Registers the member function of "instance" which handles
+     * events of type EventType
+     *
+     * \param instance the object which handles the events
+     * \param handler the member function to call
+     */
+    template<typename T, typename EventType>
+    void registerHandler(T *instance, void (T::*handler)(std::shared_ptr<const EventType>)) {
+        std::size_t id = eventTypeId<EventType>();
+        if (handlers_.size() <= id) {
+            handlers_.resize(id + 1);
+        }
+        handlers_[id] = [instance, handler](const std::shared_ptr<const BaseEvent> &event) {
+            // the type id guarantees the concrete type of the event
+            (instance->*handler)(std::static_pointer_cast<const EventType>(event));
+        };
+    }
+
+    /*!
+     * Calls the handler registered for the concrete type of the event.
+     *
+     * \param event the event to dispatch
+     * \return false if no handler is registered for the event type
+     */
+    bool dispatch(const std::shared_ptr<const BaseEvent> &event) {
+        std::size_t id = event->getTypeId();
+        if (id < handlers_.size() && handlers_[id]) {
+            handlers_[id](event);
+            return true;
+        }
+        ++unhandledEvents_;
+        return false;
+    }
+
+    std::uint64_t getUnhandledEvents() const noexcept {
+        return unhandledEvents_;
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // EVENTDISPATCHER_H
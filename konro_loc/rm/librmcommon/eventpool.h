@@ -0,0 +1,148 @@
+#ifndef EVENTPOOL_H
+#define EVENTPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+namespace rmcommon {
+
+/*!
+ * \brief A threadsafe pool of fixed size memory blocks
+ *
+ * Blocks are carved from chunks allocated with operator new and are
+ * never given back to the system: the pool grows up to the peak number
+ * of blocks in use and then serves every allocation from its free list.
+ * \p
+ * Blocks can be released by any thread. Released blocks are pushed
+ * on a lock-free list which the allocating thread takes over in one
+ * atomic exchange when its own free list is empty, so the common
+ * case (events allocated by one producer and released by consumers)
+ * never makes the threads wait for each other.
+ */
+class BlockPool {
+    struct Block {
+        Block *next;
+    };
+
+    const std::size_t blockSize_;
+    const std::size_t blocksPerChunk_;
+    /*! free blocks reserved for allocate(), protected by mut_ */
+    Block *freeList_;
+    /*! blocks released by deallocate() */
+    std::atomic<Block *> returned_;
+    std::mutex mut_;
+    std::vector<std::unique_ptr<std::byte[]>> chunks_;
+
+    /*! Adds a new chunk of blocks to the free list. Called with mut_ held */
+    void grow() {
+        std::byte *chunk = new std::byte[blockSize_ * blocksPerChunk_];
+        chunks_.emplace_back(chunk);
+        for (std::size_t i = 0; i < blocksPerChunk_; ++i) {
+            Block *b = reinterpret_cast<Block *>(chunk + i * blockSize_);
+            b->next = freeList_;
+            freeList_ = b;
+        }
+    }
+
+public:
+    explicit BlockPool(std::size_t blockSize, std::size_t blocksPerChunk = 256) :
+        blockSize_(blockSize < sizeof(Block) ? sizeof(Block) : blockSize),
+        blocksPerChunk_(blocksPerChunk),
+        freeList_(nullptr),
+        returned_(nullptr)
+    {
+    }
+
+    BlockPool(const BlockPool &) = delete;
+    BlockPool &operator=(const BlockPool &) = delete;
+
+    void *allocate() {
+        std::lock_guard<std::mutex> lck(mut_);
+        if (freeList_ == nullptr) {
+            freeList_ = returned_.exchange(nullptr, std::memory_order_acquire);
+            if (freeList_ == nullptr) {
+                grow();
+            }
+        }
+        Block *b = freeList_;
+        freeList_ = b->next;
+        return b;
+    }
+
+    void deallocate(void *p) noexcept {
+        Block *b = static_cast<Block *>(p);
+        b->next = returned_.load(std::memory_order_relaxed);
+        while (!returned_.compare_exchange_weak(b->next, b,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed))
+            ;
+    }
+
+    /*! Returns the total number of blocks owned by the pool */
+    std::size_t capacity() {
+        std::lock_guard<std::mutex> lck(mut_);
+        return chunks_.size() * blocksPerChunk_;
+    }
+};
+
+/*!
+ * Returns the pool which serves blocks of "Size" bytes.
+ * \note The pool is intentionally leaked, so that events released
+ *       during static destruction still find a valid pool.
+ */
+template<std::size_t Size>
+BlockPool &blockPool()
+{
+    static BlockPool *pool = new BlockPool(Size);
+    return *pool;
+}
+
+/*!
+ * \brief A standard allocator which takes single objects from a BlockPool
+ *
+ * Meant to be used with std::allocate_shared, so that an event and the
+ * control block of its shared_ptr are allocated together from the pool:
+ * \code
+ * auto p = std::allocate_shared<ForkEvent>(PoolAllocator<ForkEvent>(), data, len);
+ * \endcode
+ * Arrays (n > 1) are allocated with std::allocator.
+ */
+template<typename T>
+class PoolAllocator {
+    static constexpr std::size_t BLOCK_ALIGN = alignof(std::max_align_t);
+    static constexpr std::size_t BLOCK_SIZE = (sizeof(T) + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+    static_assert(alignof(T) <= BLOCK_ALIGN, "PoolAllocator does not support over-aligned types");
+
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept = default;
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+    T *allocate(std::size_t n) {
+        if (n == 1)
+            return static_cast<T *>(blockPool<BLOCK_SIZE>().allocate());
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept {
+        if (n == 1)
+            blockPool<BLOCK_SIZE>().deallocate(p);
+        else
+            std::allocator<T>().deallocate(p, n);
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U> &) const noexcept {
+        return true;
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // EVENTPOOL_H
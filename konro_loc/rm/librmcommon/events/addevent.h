@@ -5,29 +5,60 @@
 #include "../app.h"
 #include <memory>
 #include <iostream>
+#include <vector>
 
 namespace rmcommon {
 
 /*!
  * \class event generated by the WorkloadManager after validating
  * a ForkEvent or an AddRequestEvent.
+ *
+ * When a whole process tree is adopted, a single event carries the
+ * root application and the other processes of the tree (the members),
+ * which share the control group of the root.
+ *
+ * Applications recovered from the cgroup hierarchy after a restart of
+ * Konro are marked as recovered: their resources are already assigned.
  */
 class AddEvent : public BaseEvent {
 
     std::shared_ptr<rmcommon::App> app_;
+    std::vector<std::shared_ptr<rmcommon::App>> members_;
+    bool recovered_;
 
 public:
 
-    AddEvent(std::shared_ptr<rmcommon::App> app) :
-        BaseEvent("AddEvent"),
-        app_(app) {}
+    AddEvent(std::shared_ptr<rmcommon::App> app,
+             std::vector<std::shared_ptr<rmcommon::App>> members = {},
+             bool recovered = false) :
+        BaseEvent("AddEvent", eventTypeId<AddEvent>()),
+        app_(app),
+        members_(std::move(members)),
+        recovered_(recovered) {}
 
     std::shared_ptr<rmcommon::App> getApp() const {
         return app_;
     }
 
+    /*! The other processes added together with the application */
+    const std::vector<std::shared_ptr<rmcommon::App>> &getMembers() const {
+        return members_;
+    }
+
+    /*! True if the application was managed before Konro restarted */
+    bool isRecovered() const {
+        return recovered_;
+    }
+
     void printOnOstream(std::ostream &os) const override {
-        os << "{\"pid\":" << app_->getPid() << "}";
+        os << "{\"pid\":" << app_->getPid();
+        if (!members_.empty()) {
+            os << ",\"members\":" << members_.size();
+        }
+        if (recovered_) {
+            os << ",\"recovered\":true";
+        }
+        os << "}";
     }
 };
 
@@ -15,17 +15,28 @@ namespace rmcommon {
 class AddRequestEvent : public BaseEvent {
 
     std::shared_ptr<rmcommon::App> app_;
+    bool tree_;
 
 public:
 
-    AddRequestEvent(std::shared_ptr<rmcommon::App> app) :
-        BaseEvent("AddRequestEvent"),
-        app_(app) {}
+    /*!
+     * \param app the application to add
+     * \param tree if true, the existing descendants of the application
+     *             are added as well
+     */
+    AddRequestEvent(std::shared_ptr<rmcommon::App> app, bool tree = false) :
+        BaseEvent("AddRequestEvent", eventTypeId<AddRequestEvent>()),
+        app_(app),
+        tree_(tree) {}
 
     std::shared_ptr<rmcommon::App> getApp() const {
         return app_;
     }
 
+    bool isTree() const {
+        return tree_;
+    }
+
     void printOnOstream(std::ostream &os) const override {
         os << "{\"pid\":" << app_->getPid() << "}";
     }
@@ -2,6 +2,7 @@
 #define BASEEVENT_H
 
 #include "../timer.h"
+#include "../eventtypeid.h"
 #include <iostream>
 #include <string>
 
@@ -9,13 +10,18 @@ namespace rmcommon {
 
 /*!
  * \class a generic event related to a process managed by Konro
+ *
+ * Derived classes pass eventTypeId<DerivedClass>() to the constructor,
+ * so that the concrete type of an event can be known without dynamic_cast.
  */
 class BaseEvent {
-    std::string name_;
+    const char *name_;                  // always a string literal
+    std::size_t typeId_;
     KonroTimer::TimePoint t_;           // event creation
 public:
-    BaseEvent(const char *name) :
+    BaseEvent(const char *name, std::size_t typeId) :
         name_(name),
+        typeId_(typeId),
         t_(KonroTimer::now()) {
     }
     virtual ~BaseEvent() {}
@@ -29,6 +35,11 @@ public:
         return name_;
     }
 
+    /*! Returns eventTypeId<> of the concrete event class */
+    std::size_t getTypeId() const noexcept {
+        return typeId_;
+    }
+
     void setTimePoint(const KonroTimer::TimePoint &t) {
         t_ = t;
     }
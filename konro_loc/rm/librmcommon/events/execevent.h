@@ -2,8 +2,10 @@
 #define EXECEVENT_H
 
 #include "baseevent.h"
-#include <vector>
+#include <array>
+#include <algorithm>
 #include <cstdint>
+#include <linux/cn_proc.h>
 
 namespace rmcommon {
 
@@ -12,12 +14,14 @@ namespace rmcommon {
  */
 class ExecEvent : public BaseEvent {
 public:
-    std::vector<std::uint8_t> data_;
+    /*! the proc_event received from the Proc Connector */
+    alignas(struct proc_event) std::array<std::uint8_t, sizeof(struct proc_event)> data_;
 
     ExecEvent(const uint8_t *data, size_t len) :
-        BaseEvent("ExecEvent"),
-        data_(data, data+len)
+        BaseEvent("ExecEvent", eventTypeId<ExecEvent>()),
+        data_{}
     {
+        std::copy_n(data, std::min(len, data_.size()), data_.begin());
     }
 
     virtual void printOnOstream(std::ostream &os) const {
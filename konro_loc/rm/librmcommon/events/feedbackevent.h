@@ -25,7 +25,7 @@ class FeedbackEvent : public BaseEvent {
 
 public:
     FeedbackEvent(std::shared_ptr<rmcommon::App> app, int feedback) :
-        BaseEvent("FeedbackEvent"),
+        BaseEvent("FeedbackEvent", eventTypeId<FeedbackEvent>()),
         app_(app),
         feedback_(feedback)
     {}
@@ -32,7 +32,7 @@ class FeedbackRequestEvent : public BaseEvent {
 
 public:
     FeedbackRequestEvent(pid_t pid, namespace_t ns, int feedback) :
-        BaseEvent("FeedbackRequestEvent"),
+        BaseEvent("FeedbackRequestEvent", eventTypeId<FeedbackRequestEvent>()),
         pid_(pid),
         ns_(ns),
         feedback_(feedback)
@@ -3,8 +3,10 @@
 
 #include "baseevent.h"
 #include <string>
-#include <vector>
+#include <array>
+#include <algorithm>
 #include <cstdint>
+#include <linux/cn_proc.h>
 
 namespace rmcommon {
 
@@ -13,12 +15,14 @@ namespace rmcommon {
  */
 class ForkEvent : public BaseEvent {
 public:
-    std::vector<std::uint8_t> data_;
+    /*! the proc_event received from the Proc Connector */
+    alignas(struct proc_event) std::array<std::uint8_t, sizeof(struct proc_event)> data_;
 
     ForkEvent(const uint8_t *data, size_t len) :
-        BaseEvent("ForkEvent"),
-        data_(data, data+len)
+        BaseEvent("ForkEvent", eventTypeId<ForkEvent>()),
+        data_{}
     {
+        std::copy_n(data, std::min(len, data_.size()), data_.begin());
     }
 
     virtual void printOnOstream(std::ostream &os) const {
@@ -19,7 +19,7 @@ class MonitorEvent : public BaseEvent {
     PlatformLoad platLoad_;
 public:
     MonitorEvent(PlatformTemperature temp, PlatformPower power, PlatformLoad load) :
-        BaseEvent("MonitorEvent"),
+        BaseEvent("MonitorEvent", eventTypeId<MonitorEvent>()),
         platTemp_(temp),
         platPower_(power),
         platLoad_(load)
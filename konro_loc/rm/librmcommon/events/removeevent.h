@@ -18,7 +18,7 @@ class RemoveEvent : public BaseEvent {
 public:
 
     RemoveEvent(std::shared_ptr<rmcommon::App> app) :
-        BaseEvent("RemoveEvent"),
+        BaseEvent("RemoveEvent", eventTypeId<RemoveEvent>()),
         app_(app) {}
 
     std::shared_ptr<rmcommon::App> getApp() const {
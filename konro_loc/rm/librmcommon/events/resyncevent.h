@@ -0,0 +1,37 @@
+#ifndef RESYNCEVENT_H
+#define RESYNCEVENT_H
+
+#include "baseevent.h"
+#include <cstdint>
+#include <iostream>
+
+namespace rmcommon {
+
+/*!
+ * \class event generated by the ProcListener when the kernel dropped
+ * Proc Connector messages (socket receive buffer overrun).
+ * Fork, exec and exit events may have been lost, so the receivers
+ * must rebuild their state from the system.
+ */
+class ResyncEvent : public BaseEvent {
+
+    /*! number of overruns detected so far */
+    std::uint64_t overruns_;
+
+public:
+    explicit ResyncEvent(std::uint64_t overruns) :
+        BaseEvent("ResyncEvent", eventTypeId<ResyncEvent>()),
+        overruns_(overruns) {}
+
+    std::uint64_t getOverruns() const noexcept {
+        return overruns_;
+    }
+
+    void printOnOstream(std::ostream &os) const override {
+        os << "{\"overruns\":" << overruns_ << "}";
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // RESYNCEVENT_H
@@ -12,7 +12,7 @@ namespace rmcommon {
  */
 class TimerEvent : public BaseEvent {
 public:
-    TimerEvent() : BaseEvent("TimerEvent") {
+    TimerEvent() : BaseEvent("TimerEvent", eventTypeId<TimerEvent>()) {
     }
 
     void printOnOstream(std::ostream &os) const override {
@@ -0,0 +1,42 @@
+#ifndef EVENTTYPEID_H
+#define EVENTTYPEID_H
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+namespace rmcommon {
+
+namespace detail {
+
+inline std::size_t nextEventTypeId() noexcept
+{
+    static std::atomic<std::size_t> counter(0);
+    return counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+template<typename EventType>
+inline std::size_t eventTypeIdImpl() noexcept
+{
+    static const std::size_t id = nextEventTypeId();
+    return id;
+}
+
+}   // namespace detail
+
+/*!
+ * Returns a small dense integer which identifies the type EventType.
+ * \p
+ * Ids start from 0 and are assigned once per type, so they can be used
+ * as indexes in a vector instead of looking up a std::type_index in a map.
+ * Ids are not stable across executions.
+ */
+template<typename EventType>
+inline std::size_t eventTypeId() noexcept
+{
+    return detail::eventTypeIdImpl<std::remove_cv_t<EventType>>();
+}
+
+}   // namespace rmcommon
+
+#endif // EVENTTYPEID_H
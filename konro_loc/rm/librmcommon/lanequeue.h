@@ -0,0 +1,140 @@
+#ifndef LANEQUEUE_H
+#define LANEQUEUE_H
+
+#include "mpscqueue.h"
+#include "wakeup.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+
+namespace rmcommon {
+
+/*!
+ * \brief A multi-producer/single-consumer queue with priority lanes
+ *
+ * Each lane is an MpscQueue; lane 0 has the highest priority.
+ * Every call to waitAndDrain() takes up to quota[0] values from lane 0,
+ * then up to quota[1] values from lane 1 and so on, so that:
+ * - a value in a higher priority lane waits at most for the quotas
+ *   of the lower priority lanes, not for their whole backlog;
+ * - every lane is served at each round, so lower priority lanes
+ *   cannot starve.
+ * \p
+ * The consumer blocks on a single Wakeup shared by all the lanes.
+ * Only one thread may call the drain functions.
+ */
+template<typename T, std::size_t Lanes, std::size_t Capacity = 4096>
+class LaneQueue {
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    std::array<MpscQueue<T, Capacity>, Lanes> lanes_;
+    const std::array<std::size_t, Lanes> quotas_;
+    /*! true while the consumer is (about to be) blocked on wakeup_ */
+    alignas(CACHE_LINE_SIZE) std::atomic_bool sleeping_;
+    std::atomic_bool interrupted_;
+    Wakeup wakeup_;
+
+    bool anyReady() const {
+        for (const auto &lane: lanes_) {
+            if (!lane.empty())
+                return true;
+        }
+        return false;
+    }
+
+    /*! Waits without timeout for a value or for interrupt() */
+    bool waitReady() {
+        if (anyReady())
+            return true;
+        for (;;) {
+            sleeping_.store(true, std::memory_order_relaxed);
+            // pairs with the fence in push()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (anyReady() || interrupted_.load(std::memory_order_relaxed))
+                break;
+            wakeup_.wait();
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+        interrupted_.store(false, std::memory_order_relaxed);
+        return anyReady();
+    }
+
+public:
+    /*!
+     * \param quotas maximum number of values taken from each lane
+     *               at each round
+     */
+    explicit LaneQueue(const std::array<std::size_t, Lanes> &quotas) :
+        quotas_(quotas),
+        sleeping_(false),
+        interrupted_(false)
+    {
+    }
+
+    LaneQueue(const LaneQueue &) = delete;
+    LaneQueue &operator=(const LaneQueue &) = delete;
+
+    /*!
+     * Adds a value to a lane. Can be called concurrently by
+     * any number of threads.
+     *
+     * \param new_value the value to add
+     * \param lane the lane, 0 being the highest priority
+     */
+    void push(T new_value, std::size_t lane) {
+        lanes_[lane].push(std::move(new_value));
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed) &&
+                sleeping_.exchange(false, std::memory_order_relaxed)) {
+            wakeup_.notify();
+        }
+    }
+
+    /*!
+     * Moves the values of one round at the end of "batch",
+     * in priority order, without waiting.
+     *
+     * \param batch the vector receiving the values
+     * \return the number of values removed
+     */
+    std::size_t drain(std::vector<T> &batch) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < Lanes; ++i) {
+            n += lanes_[i].drain(batch, quotas_[i]);
+        }
+        return n;
+    }
+
+    /*!
+     * Waits without timeout for at least one value, then drains
+     * one round into "batch".
+     *
+     * \param batch the vector receiving the values
+     * \return the number of values removed (0 if interrupted)
+     */
+    std::size_t waitAndDrain(std::vector<T> &batch) {
+        if (!waitReady())
+            return 0;
+        return drain(batch);
+    }
+
+    /*!
+     * Makes the consumer return from a pending (or the next) wait
+     * even if the queue is empty. Can be called by any thread.
+     */
+    void interrupt() {
+        interrupted_.store(true, std::memory_order_relaxed);
+        wakeup_.notify();
+    }
+
+    /*! Can only be called by the consumer thread */
+    bool empty() const {
+        return !anyReady();
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // LANEQUEUE_H
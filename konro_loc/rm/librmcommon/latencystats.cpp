@@ -0,0 +1,124 @@
+#include "latencystats.h"
+#include <bit>
+#include <cmath>
+
+using namespace std;
+
+namespace rmcommon {
+
+LatencyHistogram::LatencyHistogram() :
+    count_(0),
+    sum_(0),
+    max_(0)
+{
+    for (auto &bucket: buckets_) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) noexcept
+{
+    if (value < 2 * SUB_BUCKETS) {
+        return value;
+    }
+    // keep the 5 most significant bits of the value
+    unsigned shift = bit_width(value) - SUB_BUCKET_BITS - 1;
+    return shift * SUB_BUCKETS + (value >> shift);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) noexcept
+{
+    if (index < 2 * SUB_BUCKETS) {
+        return index;
+    }
+    unsigned shift = index / SUB_BUCKETS - 1;
+    uint64_t mantissa = index % SUB_BUCKETS + SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t micros) noexcept
+{
+    buckets_[bucketIndex(micros)].fetch_add(1, memory_order_relaxed);
+    count_.fetch_add(1, memory_order_relaxed);
+    sum_.fetch_add(micros, memory_order_relaxed);
+    uint64_t max = max_.load(memory_order_relaxed);
+    while (micros > max && !max_.compare_exchange_weak(max, micros, memory_order_relaxed))
+        ;
+}
+
+double LatencyHistogram::mean() const noexcept
+{
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sum_.load(memory_order_relaxed)) / n;
+}
+
+uint64_t LatencyHistogram::percentile(double percentile) const noexcept
+{
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(ceil(percentile / 100.0 * n));
+    if (target == 0) {
+        target = 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets_[i].load(memory_order_relaxed);
+        if (seen >= target) {
+            // never report more than the maximum recorded value
+            return min(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+void LatencyHistogram::printOnOstream(ostream &os) const
+{
+    os << "{\"count\":" << count()
+       << ",\"mean_us\":" << static_cast<uint64_t>(mean())
+       << ",\"p50_us\":" << percentile(50.0)
+       << ",\"p90_us\":" << percentile(90.0)
+       << ",\"p99_us\":" << percentile(99.0)
+       << ",\"p999_us\":" << percentile(99.9)
+       << ",\"max_us\":" << max()
+       << "}";
+}
+
+LatencyStats &LatencyStats::instance()
+{
+    static LatencyStats stats;
+    return stats;
+}
+
+LatencyHistogram &LatencyStats::histogram(const string &component,
+                                          const string &item,
+                                          const char *stage)
+{
+    lock_guard<mutex> lck(mut_);
+    unique_ptr<LatencyHistogram> &h = histograms_[Key(component, item, stage)];
+    if (!h) {
+        h = make_unique<LatencyHistogram>();
+    }
+    return *h;
+}
+
+void LatencyStats::printOnOstream(ostream &os)
+{
+    lock_guard<mutex> lck(mut_);
+    os << "[";
+    const char *sep = "";
+    for (const auto &[key, h]: histograms_) {
+        os << sep
+           << "{\"component\":\"" << get<0>(key)
+           << "\",\"item\":\"" << get<1>(key)
+           << "\",\"stage\":\"" << get<2>(key)
+           << "\",\"latency\":";
+        h->printOnOstream(os);
+        os << "}";
+        sep = ",";
+    }
+    os << "]";
+}
+
+}   // namespace rmcommon
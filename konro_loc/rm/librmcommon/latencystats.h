@@ -0,0 +1,138 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include "timer.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <tuple>
+
+namespace rmcommon {
+
+/*!
+ * \brief A lock-free histogram of latencies in microseconds
+ *
+ * Buckets are log-linear (as in HdrHistogram): values below 32 have a
+ * bucket each, larger values are grouped in 16 buckets per power of two,
+ * so every value is recorded with a relative error below 6.25%.
+ * \p
+ * record() is a few relaxed atomic increments, so histograms can be
+ * always on and be updated and read by different threads at the same time.
+ */
+class LatencyHistogram {
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr std::uint64_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr std::size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::array<std::atomic<std::uint64_t>, NUM_BUCKETS> buckets_;
+    std::atomic<std::uint64_t> count_;
+    std::atomic<std::uint64_t> sum_;
+    std::atomic<std::uint64_t> max_;
+
+    static std::size_t bucketIndex(std::uint64_t value) noexcept;
+
+    /*! Returns the highest value recorded in the bucket */
+    static std::uint64_t bucketUpperBound(std::size_t index) noexcept;
+
+public:
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram &) = delete;
+    LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+    void record(std::uint64_t micros) noexcept;
+
+    void record(KonroTimer::TimeUnit elapsed) noexcept {
+        record(elapsed.count() < 0 ? 0 : static_cast<std::uint64_t>(elapsed.count()));
+    }
+
+    std::uint64_t count() const noexcept {
+        return count_.load(std::memory_order_relaxed);
+    }
+
+    std::uint64_t max() const noexcept {
+        return max_.load(std::memory_order_relaxed);
+    }
+
+    double mean() const noexcept;
+
+    /*!
+     * Returns the value below which "percentile" percent
+     * of the recorded values fall
+     *
+     * \param percentile a value between 0 and 100
+     */
+    std::uint64_t percentile(double percentile) const noexcept;
+
+    /*! Prints count, mean, percentiles and max as a JSON object */
+    void printOnOstream(std::ostream &os) const;
+};
+
+/*!
+ * \brief Registry of the latency histograms of all Konro components
+ *
+ * Histograms are identified by component (e.g. "POLICYMANAGER"), item
+ * (an event type or an operation) and stage:
+ * - "queue": from the creation of an event to its removal from the queue
+ * - "handle": from the removal from the queue to the end of the handler
+ * - "apply": time taken to apply a change to the platform (cgroup, DROM)
+ * - "error": time taken by the changes which failed; the count of the
+ *   histogram is the number of failures
+ * \p
+ * Histograms are created on first use and never destroyed, so callers
+ * may keep the returned reference and record into it without locking.
+ */
+class LatencyStats {
+    using Key = std::tuple<std::string, std::string, std::string>;
+
+    std::mutex mut_;
+    std::map<Key, std::unique_ptr<LatencyHistogram>> histograms_;
+
+    LatencyStats() = default;
+
+public:
+    static LatencyStats &instance();
+
+    /*!
+     * Returns the histogram for the specified component, item and stage,
+     * creating it if needed
+     */
+    LatencyHistogram &histogram(const std::string &component,
+                                const std::string &item,
+                                const char *stage);
+
+    /*! Prints all the histograms as a JSON array */
+    void printOnOstream(std::ostream &os);
+};
+
+/*!
+ * Records in a histogram the time elapsed between its construction
+ * and its destruction
+ */
+class ScopedLatency {
+    LatencyHistogram &histogram_;
+    KonroTimer::TimePoint start_;
+
+public:
+    explicit ScopedLatency(LatencyHistogram &histogram) :
+        histogram_(histogram),
+        start_(KonroTimer::now())
+    {
+    }
+
+    ~ScopedLatency() {
+        histogram_.record(KonroTimer::ElapsedFrom(start_));
+    }
+
+    ScopedLatency(const ScopedLatency &) = delete;
+    ScopedLatency &operator=(const ScopedLatency &) = delete;
+};
+
+}   // namespace rmcommon
+
+#endif // LATENCYSTATS_H
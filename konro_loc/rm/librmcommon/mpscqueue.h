@@ -0,0 +1,237 @@
+#ifndef MPSCQUEUE_H
+#define MPSCQUEUE_H
+
+#include "wakeup.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+namespace rmcommon {
+
+/*!
+ * \brief A bounded multi-producer/single-consumer queue
+ *
+ * The queue is a ring buffer of "Capacity" slots. Each slot carries a
+ * sequence number which tells producers and the consumer whether the
+ * slot is free or holds a value, so push() and pop never take a lock
+ * in the common case (D. Vyukov's bounded queue algorithm).
+ * \p
+ * The consumer can block waiting for new values on a Wakeup (eventfd).
+ * Only when the consumer is blocked does a producer make a system call
+ * to wake it up; a blocked consumer can also be released by interrupt().
+ * When the ring is full, producers yield until the consumer frees a slot.
+ * \p
+ * Only one thread may call the pop/drain functions.
+ */
+template<typename T, std::size_t Capacity = 4096>
+class MpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpscQueue capacity must be a power of two");
+
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    struct Slot {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    Slot slots_[Capacity];
+    alignas(CACHE_LINE_SIZE) std::atomic<std::size_t> enqueuePos_;
+    /*! touched by the consumer thread only */
+    alignas(CACHE_LINE_SIZE) std::size_t dequeuePos_;
+    /*! true while the consumer is (about to be) blocked on wakeup_ */
+    alignas(CACHE_LINE_SIZE) std::atomic_bool sleeping_;
+    std::atomic_bool interrupted_;
+    Wakeup wakeup_;
+
+    static constexpr std::chrono::milliseconds WAIT_FOREVER = std::chrono::milliseconds(-1);
+
+    /*! Returns true if the slot at the head of the queue holds a value */
+    bool headReady() const {
+        const Slot &slot = slots_[dequeuePos_ & (Capacity - 1)];
+        return slot.seq.load(std::memory_order_acquire) == dequeuePos_ + 1;
+    }
+
+    /*!
+     * Waits until the queue is not empty, the timeout expires
+     * or interrupt() is called. A negative timeout waits forever.
+     */
+    bool waitReady(std::chrono::milliseconds millis) {
+        using Clock = std::chrono::steady_clock;
+        if (headReady())
+            return true;
+        Clock::time_point deadline = Clock::now() + millis;
+        for (;;) {
+            sleeping_.store(true, std::memory_order_relaxed);
+            // pairs with the fence in wakeConsumer()
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (headReady() || interrupted_.load(std::memory_order_relaxed))
+                break;
+            if (millis < std::chrono::milliseconds::zero()) {
+                wakeup_.wait();
+            } else {
+                auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+                if (remaining <= std::chrono::milliseconds::zero())
+                    break;
+                wakeup_.wait(remaining);
+            }
+        }
+        sleeping_.store(false, std::memory_order_relaxed);
+        interrupted_.store(false, std::memory_order_relaxed);
+        return headReady();
+    }
+
+    void wakeConsumer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // only one producer pays for the system call
+        if (sleeping_.load(std::memory_order_relaxed) &&
+                sleeping_.exchange(false, std::memory_order_relaxed)) {
+            wakeup_.notify();
+        }
+    }
+
+public:
+    MpscQueue() : enqueuePos_(0), dequeuePos_(0), sleeping_(false), interrupted_(false) {
+        for (std::size_t i = 0; i < Capacity; ++i) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    /*!
+     * Adds a value to the queue. Can be called concurrently by
+     * any number of threads.
+     *
+     * \param new_value the value to add
+     */
+    void push(T new_value) {
+        std::size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &slots_[pos & (Capacity - 1)];
+            std::size_t seq = slot->seq.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                // the queue is full: let the consumer catch up
+                std::this_thread::yield();
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::move(new_value);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        wakeConsumer();
+    }
+
+    /*!
+     * Removes the value at the head of the queue without waiting.
+     *
+     * \param value the removed value
+     * \return true if a value was removed, false if the queue is empty
+     */
+    bool tryPop(T &value) {
+        Slot &slot = slots_[dequeuePos_ & (Capacity - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != dequeuePos_ + 1)
+            return false;
+        value = std::move(slot.value);
+        slot.value = T();
+        slot.seq.store(dequeuePos_ + Capacity, std::memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+
+    /*!
+     * Waits until a value is available, then removes it from the queue
+     *
+     * \param value the removed value
+     */
+    void waitAndPop(T &value) {
+        while (!waitAndPop(value, WAIT_FOREVER))
+            ;
+    }
+
+    /*!
+     * Waits for the specified number of milliseconds for a value.
+     * If a value is available, it is moved to "value" and true is
+     * returned.  Otherwise, false is returned.
+     *
+     * \param value the removed value
+     * \param millis number of milliseconds to wait for the value
+     * \return true if a value was removed
+     */
+    bool waitAndPop(T &value, std::chrono::milliseconds millis) {
+        return waitReady(millis) && tryPop(value);
+    }
+
+    /*!
+     * Moves all the values currently in the queue (at most "maxItems")
+     * at the end of "batch", without waiting.
+     *
+     * \param batch the vector receiving the values
+     * \param maxItems maximum number of values to remove
+     * \return the number of values removed
+     */
+    std::size_t drain(std::vector<T> &batch, std::size_t maxItems = Capacity) {
+        std::size_t n = 0;
+        T value;
+        while (n < maxItems && tryPop(value)) {
+            batch.push_back(std::move(value));
+            ++n;
+        }
+        return n;
+    }
+
+    /*!
+     * Waits for the specified number of milliseconds for at least one
+     * value, then drains the queue into "batch".
+     *
+     * \param batch the vector receiving the values
+     * \param millis number of milliseconds to wait for the first value
+     * \param maxItems maximum number of values to remove
+     * \return the number of values removed (0 on timeout or interrupt)
+     */
+    std::size_t waitAndDrain(std::vector<T> &batch, std::chrono::milliseconds millis,
+                             std::size_t maxItems = Capacity) {
+        if (!waitReady(millis))
+            return 0;
+        return drain(batch, maxItems);
+    }
+
+    /*!
+     * Waits without timeout for at least one value, then drains
+     * the queue into "batch".
+     *
+     * \param batch the vector receiving the values
+     * \param maxItems maximum number of values to remove
+     * \return the number of values removed (0 if interrupted)
+     */
+    std::size_t waitAndDrain(std::vector<T> &batch, std::size_t maxItems = Capacity) {
+        return waitAndDrain(batch, WAIT_FOREVER, maxItems);
+    }
+
+    /*!
+     * Makes the consumer return from a pending (or the next) wait
+     * even if the queue is empty. Can be called by any thread.
+     */
+    void interrupt() {
+        interrupted_.store(true, std::memory_order_relaxed);
+        wakeup_.notify();
+    }
+
+    /*! Can only be called by the consumer thread */
+    bool empty() const {
+        return !headReady();
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // MPSCQUEUE_H
@@ -1,6 +1,6 @@
 #include "namespaces.h"
 // #include "../platformcontrol/cgroup/cgrouputil.h"
-#include "dir.h"
+#include "nspidindex.h"
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
@@ -16,57 +16,6 @@
 
 namespace rmcommon {
 
-namespace {
-
-/*!
- * Parses the status file, searching for the line
- * that begins with "NSpid:"
- * \p
- * The first pid of the line is the PID in the current
- * namespace; the last PID on the line is the pid in the
- * original namespace
- *
- * \param filename Pathname of the "status" file
- * \param pidToSearch [in/out]
- * \return Outcome of the operation
- */
-bool getPidFromStatusFile(const char *filename, pid_t &pidToSearch) {
-
-  std::cout << "Parsing " << filename << std::endl;
-
-  std::ifstream ifs;
-  ifs.open(filename);
-  if (!ifs.is_open())
-    return false;
-  char line[1024];
-  pid_t rootpid = -1, last_pid = -1;
-  while (ifs.getline(line, sizeof(line))) {
-    if (strncmp(line, "NSpid:", 6) == 0) {
-      std::cout << "NSpid line found:";
-      char *tok = line + 6;
-      while ((tok = strtok(tok, " \t")) != nullptr) {
-        last_pid = strtol(tok, nullptr, 10);
-        std::cout << " " << last_pid;
-        if (rootpid == -1) {
-          rootpid = last_pid; // rootpid: first pid on the line
-        }
-        tok = nullptr;
-      }
-      std::cout << std::endl;
-      break;
-    }
-  }
-  // the search is successful if the last pid on the line is the
-  // pid that we are looking for
-  if (pidToSearch == last_pid) {
-    pidToSearch = rootpid;
-    return true;
-  } else {
-    return false;
-  }
-}
-} // namespace
-
 bool isKubPod(pid_t pid) {
   std::ostringstream os;
   os << "/proc/" << pid << "/cgroup";
@@ -123,34 +72,9 @@ namespace_t getPidNamespace(pid_t pid) {
 }
 
 pid_t mapPid(pid_t pid, namespace_t ns) {
-  /* The ns is invalid or is the same as the Konro's one */
-  /* In both cases the PID stays the same */
-  if (ns == 0 || ns == getSelfPidNamespace())
-    return pid;
-
-  Dir dir = Dir::localdir("/proc");
-
-  /* The only way to access the namespace fs is through
-     the proc pseudo-fs */
-  for (const auto &entry : dir) {
-    const std::string &name = entry.name();
-    if (name.empty() || !isdigit(name[0])) {
-      continue;
-    }
-    pid_t curPid = (pid_t)strtoul(name.c_str(), nullptr, 10);
-    namespace_t curNs = getPidNamespace(curPid);
-    if (curNs == ns) {
-      // the process belongs to the searched namespace
-      std::cout << "Namespace of " << curPid << " is " << curNs << std::endl;
-      char filename[64];
-      snprintf(filename, sizeof(filename), "/proc/%ld/status",
-               static_cast<long>(curPid));
-      if (getPidFromStatusFile(filename, pid)) {
-        break;
-      }
-    }
-  }
-  return pid;
+  /* The index returns the PID unchanged if the ns is invalid
+     or is the same as the Konro's one */
+  return NsPidIndex::instance().map(pid, ns);
 }
 
 #undef PID_FNAME
@@ -20,6 +20,9 @@ namespace_t getPidNamespace(pid_t pid);
 /*!
  * Returns the PID in the current namespace of the pid
  * in namespace "ns"
+ * \p
+ * The mapping is cached by NsPidIndex, a lazy index of /proc:
+ * /proc is scanned only when the pid is not in the cache.
  *
  * \param pid the PID in namespace "ns"
  * \param ns the namespace to which "pid" belongs
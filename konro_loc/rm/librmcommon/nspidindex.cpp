@@ -0,0 +1,204 @@
+#include "nspidindex.h"
+#include "dir.h"
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace rmcommon {
+
+namespace {
+
+/*! Returns the PID namespace of a process, or 0 if it does not exist */
+namespace_t readPidNamespace(pid_t pid)
+{
+    char path[48];
+    snprintf(path, sizeof(path), "/proc/%ld/ns/pid", (long)pid);
+    struct stat sb;
+    if (stat(path, &sb) != 0)
+        return 0;
+    return sb.st_ino;
+}
+
+/*!
+ * Reads the pid of a process in its own PID namespace, i.e. the last
+ * pid of the "NSpid:" line of /proc/<pid>/status
+ *
+ * \return false if the process does not exist
+ */
+bool readNsPid(pid_t pid, pid_t &nsPid)
+{
+    char path[48];
+    snprintf(path, sizeof(path), "/proc/%ld/status", (long)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    char buf[4096];
+    size_t len = 0;
+    ssize_t n;
+    while (len < sizeof(buf) - 1 && (n = read(fd, buf + len, sizeof(buf) - 1 - len)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        len += static_cast<size_t>(n);
+    }
+    close(fd);
+    buf[len] = '\0';
+    const char *line = strstr(buf, "\nNSpid:");
+    if (line == nullptr)
+        return false;
+    const char *p = line + 7;
+    long last = -1;
+    for (;;) {
+        char *end;
+        long value = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        last = value;
+        p = end;
+    }
+    if (last <= 0)
+        return false;
+    nsPid = static_cast<pid_t>(last);
+    return true;
+}
+
+}   // namespace
+
+NsPidIndex::NsPidIndex() :
+    selfNs_(readPidNamespace(getpid()))
+{
+}
+
+NsPidIndex &NsPidIndex::instance()
+{
+    static NsPidIndex index;
+    return index;
+}
+
+void NsPidIndex::insert(const Key &key, pid_t pid)
+{
+    erase(pid);
+    auto it = byNsPid_.find(key);
+    if (it != byNsPid_.end())
+        byPid_.erase(it->second);
+    byNsPid_[key] = pid;
+    byPid_[pid] = key;
+}
+
+void NsPidIndex::erase(pid_t pid)
+{
+    auto it = byPid_.find(pid);
+    if (it != byPid_.end()) {
+        byNsPid_.erase(it->second);
+        byPid_.erase(it);
+    }
+}
+
+bool NsPidIndex::find(const Key &key, pid_t &pid)
+{
+    {
+        lock_guard<mutex> lck(mut_);
+        auto it = byNsPid_.find(key);
+        if (it == byNsPid_.end())
+            return false;
+        pid = it->second;
+    }
+    // the process may have terminated and its pid may have been reused
+    pid_t nsPid;
+    if (readPidNamespace(pid) == key.first && readNsPid(pid, nsPid) && nsPid == key.second)
+        return true;
+    lock_guard<mutex> lck(mut_);
+    erase(pid);
+    return false;
+}
+
+void NsPidIndex::indexNamespace(namespace_t ns)
+{
+    vector<pair<Key, pid_t>> found;
+    try {
+        Dir dir = Dir::localdir("/proc");
+        for (const auto &entry: dir) {
+            const string &name = entry.name();
+            if (name.empty() || !isdigit(static_cast<unsigned char>(name[0])))
+                continue;
+            pid_t pid = static_cast<pid_t>(strtol(name.c_str(), nullptr, 10));
+            // only the status of the processes in the namespace is read
+            pid_t nsPid;
+            if (readPidNamespace(pid) != ns || !readNsPid(pid, nsPid))
+                continue;
+            found.emplace_back(Key(ns, nsPid), pid);
+        }
+    } catch (runtime_error &) {
+        // /proc not readable: the index stays as it is
+        return;
+    }
+    // the scan is done without the lock, so that the events of
+    // the WorkloadManager are not delayed
+    lock_guard<mutex> lck(mut_);
+    // the processes of the namespace which terminated are forgotten
+    for (auto it = byPid_.begin(); it != byPid_.end(); ) {
+        if (it->second.first == ns) {
+            byNsPid_.erase(it->second);
+            it = byPid_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (const auto &p: found) {
+        insert(p.first, p.second);
+    }
+}
+
+pid_t NsPidIndex::map(pid_t nsPid, namespace_t ns)
+{
+    if (ns == 0 || ns == selfNs_)
+        return nsPid;
+    Key key(ns, nsPid);
+    pid_t pid;
+    if (find(key, pid))
+        return pid;
+    indexNamespace(ns);
+    if (find(key, pid))
+        return pid;
+    return nsPid;
+}
+
+void NsPidIndex::processFork(pid_t parentPid, pid_t childPid)
+{
+    {
+        lock_guard<mutex> lck(mut_);
+        if (byPid_.find(parentPid) == byPid_.end())
+            return;
+    }
+    namespace_t ns = readPidNamespace(childPid);
+    pid_t nsPid;
+    if (ns == 0 || ns == selfNs_ || !readNsPid(childPid, nsPid))
+        return;
+    lock_guard<mutex> lck(mut_);
+    insert(Key(ns, nsPid), childPid);
+}
+
+void NsPidIndex::processExit(pid_t pid)
+{
+    lock_guard<mutex> lck(mut_);
+    erase(pid);
+}
+
+size_t NsPidIndex::size()
+{
+    lock_guard<mutex> lck(mut_);
+    return byNsPid_.size();
+}
+
+}   // namespace rmcommon
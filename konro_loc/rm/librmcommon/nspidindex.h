@@ -0,0 +1,95 @@
+#ifndef NSPIDINDEX_H
+#define NSPIDINDEX_H
+
+#include "namespaces.h"
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief A lazy /proc index which maps the pids of the processes in
+ *        other PID namespaces (e.g. containers) to pids in Konro's
+ *        namespace
+ *
+ * The index is filled per namespace: when a pid is not found, /proc is
+ * scanned and the processes of the requested namespace are indexed, so
+ * that the following requests for the same container cost one lookup.
+ * The scan reads the namespace of every process (a stat() of
+ * /proc/<pid>/ns/pid) but the status file only of the processes in the
+ * requested namespace. A hit is verified against /proc/<pid>, so a
+ * stale entry is never returned.
+ * \p
+ * The Proc Connector cannot keep the index complete: the kernel filter
+ * selects the events by pid, not by namespace, so with the pid filter
+ * enabled (the default) the forks of unmanaged container processes never
+ * reach Konro. processFork() and processExit() only keep up to date the
+ * children of the indexed processes whose events arrive, i.e. the managed
+ * ones; any other new process costs a scan of its namespace.
+ * \p
+ * The functions are threadsafe.
+ */
+class NsPidIndex {
+public:
+    using Key = std::pair<namespace_t, pid_t>;
+
+private:
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const noexcept {
+            return std::hash<namespace_t>()(key.first) * 31 + std::hash<pid_t>()(key.second);
+        }
+    };
+
+    using Index = std::unordered_map<Key, pid_t, KeyHash>;
+
+    std::mutex mut_;
+    /*! (namespace, pid in the namespace) -> pid in Konro's namespace */
+    Index byNsPid_;
+    /*! pid in Konro's namespace -> (namespace, pid in the namespace) */
+    std::unordered_map<pid_t, Key> byPid_;
+    namespace_t selfNs_;
+
+    NsPidIndex();
+
+    void insert(const Key &key, pid_t pid);
+    void erase(pid_t pid);
+    bool find(const Key &key, pid_t &pid);
+
+    /*!
+     * Scans /proc and replaces the entries of the namespace with its
+     * current processes
+     */
+    void indexNamespace(namespace_t ns);
+
+public:
+    static NsPidIndex &instance();
+
+    NsPidIndex(const NsPidIndex &) = delete;
+    NsPidIndex &operator=(const NsPidIndex &) = delete;
+
+    /*!
+     * Returns the pid in Konro's namespace of the process with pid
+     * "nsPid" in namespace "ns", or nsPid if not found
+     */
+    pid_t map(pid_t nsPid, namespace_t ns);
+
+    /*!
+     * Indexes a new process if its parent is in the index, i.e. if
+     * the parent runs in another PID namespace. Only called for the
+     * forks which reach Konro, so the index may still miss processes.
+     */
+    void processFork(pid_t parentPid, pid_t childPid);
+
+    /*! Removes a terminated process from the index */
+    void processExit(pid_t pid);
+
+    std::size_t size();
+};
+
+}   // namespace rmcommon
+
+#endif // NSPIDINDEX_H
@@ -0,0 +1,49 @@
+#include "placementwaiters.h"
+
+using namespace std;
+
+namespace rmcommon {
+
+PlacementWaiters &PlacementWaiters::instance()
+{
+    static PlacementWaiters waiters;
+    return waiters;
+}
+
+void PlacementWaiters::expect(pid_t pid)
+{
+    lock_guard<mutex> lck(mut_);
+    waiters_[pid] = State::PENDING;
+}
+
+void PlacementWaiters::complete(pid_t pid, bool placed)
+{
+    {
+        lock_guard<mutex> lck(mut_);
+        auto it = waiters_.find(pid);
+        if (it == waiters_.end() || it->second != State::PENDING)
+            return;
+        it->second = placed ? State::PLACED : State::FAILED;
+    }
+    cv_.notify_all();
+}
+
+bool PlacementWaiters::wait(pid_t pid, chrono::milliseconds timeout)
+{
+    unique_lock<mutex> lck(mut_);
+    if (waiters_.count(pid) == 0)
+        return false;
+    // another wait() for the same pid may remove the waiter
+    cv_.wait_for(lck, timeout, [this, pid] {
+        auto it = waiters_.find(pid);
+        return it == waiters_.end() || it->second != State::PENDING;
+    });
+    auto it = waiters_.find(pid);
+    if (it == waiters_.end())
+        return false;
+    bool placed = it->second == State::PLACED;
+    waiters_.erase(it);
+    return placed;
+}
+
+}   // namespace rmcommon
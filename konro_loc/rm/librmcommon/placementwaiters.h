@@ -0,0 +1,69 @@
+#ifndef PLACEMENTWAITERS_H
+#define PLACEMENTWAITERS_H
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief Lets a thread wait until a new application has been placed
+ *        by the policy
+ *
+ * A launcher which holds a child process until Konro has set its
+ * resources sends an add request and waits for the reply. The thread
+ * serving the request calls expect() before publishing the request and
+ * wait() after; the PolicyManager calls complete() when the policy has
+ * placed the application, and the WorkloadManager when the application
+ * could not be added.
+ * \p
+ * complete() costs a lookup when nobody waits for the application.
+ * \p
+ * The functions are threadsafe.
+ */
+class PlacementWaiters {
+    enum class State {
+        PENDING,
+        PLACED,
+        FAILED
+    };
+
+    std::mutex mut_;
+    std::condition_variable cv_;
+    std::unordered_map<pid_t, State> waiters_;
+
+    PlacementWaiters() = default;
+
+public:
+    static PlacementWaiters &instance();
+
+    PlacementWaiters(const PlacementWaiters &) = delete;
+    PlacementWaiters &operator=(const PlacementWaiters &) = delete;
+
+    /*! Registers a waiter for the application with the specified pid */
+    void expect(pid_t pid);
+
+    /*!
+     * Wakes up the waiter of the application, if any
+     *
+     * \param pid the pid of the application
+     * \param placed false if the application could not be added
+     */
+    void complete(pid_t pid, bool placed);
+
+    /*!
+     * Waits until complete() is called for the application or the timeout
+     * expires. The waiter is removed in any case.
+     *
+     * \return true if the application has been placed; false if the
+     *         waiter was removed by another wait() for the same pid
+     */
+    bool wait(pid_t pid, std::chrono::milliseconds timeout);
+};
+
+}   // namespace rmcommon
+
+#endif // PLACEMENTWAITERS_H
@@ -0,0 +1,92 @@
+#include "processnames.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace rmcommon {
+
+namespace {
+
+/*! when the cache grows beyond this size, unused names are evicted */
+constexpr size_t MAX_CACHED_NAMES = 1024;
+/*! longer command lines are truncated */
+constexpr size_t MAX_NAME_LENGTH = 4096;
+
+struct NameCache {
+    mutex mut;
+    /*! the keys point to the strings owned by the values */
+    unordered_map<string_view, ProcessNames::Name> names;
+};
+
+NameCache &nameCache()
+{
+    static NameCache cache;
+    return cache;
+}
+
+/*! Removes the names which are only referenced by the cache */
+void evictUnused(NameCache &cache)
+{
+    for (auto it = cache.names.begin(); it != cache.names.end(); ) {
+        if (it->second.use_count() == 1)
+            it = cache.names.erase(it);
+        else
+            ++it;
+    }
+}
+
+}   // namespace
+
+ProcessNames::Name ProcessNames::intern(string_view name)
+{
+    NameCache &cache = nameCache();
+    lock_guard<mutex> lck(cache.mut);
+    auto it = cache.names.find(name);
+    if (it != cache.names.end())
+        return it->second;
+    if (cache.names.size() >= MAX_CACHED_NAMES)
+        evictUnused(cache);
+    Name interned = make_shared<const string>(name);
+    cache.names.emplace(string_view(*interned), interned);
+    return interned;
+}
+
+ProcessNames::Name ProcessNames::read(pid_t pid)
+{
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%ld/cmdline", (long)pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return intern(string_view());
+    char buf[MAX_NAME_LENGTH];
+    size_t len = 0;
+    while (len < sizeof(buf)) {
+        ssize_t n = ::read(fd, buf + len, sizeof(buf) - len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += static_cast<size_t>(n);
+    }
+    close(fd);
+    // the arguments are terminated by '\0'
+    while (len > 0 && buf[len - 1] == '\0')
+        --len;
+    replace(buf, buf + len, '\0', ' ');
+    return intern(string_view(buf, len));
+}
+
+size_t ProcessNames::size()
+{
+    NameCache &cache = nameCache();
+    lock_guard<mutex> lck(cache.mut);
+    return cache.names.size();
+}
+
+}   // namespace rmcommon
@@ -0,0 +1,43 @@
+#ifndef PROCESSNAMES_H
+#define PROCESSNAMES_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief Interned process names
+ *
+ * Most of the processes managed by Konro share their name with many
+ * others (the children of a server, the threads of an application),
+ * so names are kept in a cache and shared: interning the same name
+ * twice returns the same string. Strings no longer used by any App
+ * are evicted when the cache grows.
+ * \p
+ * The functions are threadsafe.
+ */
+class ProcessNames {
+public:
+    using Name = std::shared_ptr<const std::string>;
+
+    /*! Returns the shared copy of "name" */
+    static Name intern(std::string_view name);
+
+    /*!
+     * Reads the name of a process from /proc/<pid>/cmdline and interns it.
+     * The arguments are separated by spaces.
+     *
+     * \return the name, or an empty name if the process does not exist
+     */
+    static Name read(pid_t pid);
+
+    /*! Returns the number of names in the cache */
+    static std::size_t size();
+};
+
+}   // namespace rmcommon
+
+#endif // PROCESSNAMES_H
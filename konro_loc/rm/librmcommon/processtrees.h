@@ -0,0 +1,109 @@
+#ifndef PROCESSTREES_H
+#define PROCESSTREES_H
+
+#include "app.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief The members of the process trees managed as one application
+ *
+ * The processes of a tree share the control group of the application,
+ * which is identified by the pid of its owner: initially the root of
+ * the tree. When the owner exits before the other processes, one of
+ * the surviving members becomes the owner, so the application is only
+ * released when the last process of its control group exits.
+ * \p
+ * The class is not threadsafe.
+ */
+class ProcessTrees {
+public:
+    using AppPtr = std::shared_ptr<App>;
+
+private:
+    /*! the members of each tree, the owner excluded */
+    std::unordered_map<pid_t, std::vector<AppPtr>> members_;
+    /*! the owner of the tree of each member */
+    std::unordered_map<pid_t, pid_t> owners_;
+
+public:
+    /*! Adds the members of the tree owned by the specified process */
+    void add(pid_t owner, const std::vector<AppPtr> &members) {
+        if (members.empty())
+            return;
+        std::vector<AppPtr> &tree = members_[owner];
+        for (const AppPtr &member: members) {
+            if (owners_.emplace(member->getPid(), owner).second)
+                tree.push_back(member);
+        }
+    }
+
+    /*!
+     * Returns the owner of the tree of a member, or 0 if the process
+     * is not a member of a tree
+     */
+    pid_t ownerOf(pid_t pid) const {
+        auto it = owners_.find(pid);
+        return it == owners_.end() ? 0 : it->second;
+    }
+
+    /*!
+     * Removes the owner of a tree and makes one of the members
+     * the new owner
+     * \returns the new owner, or nullptr if the tree has no members left
+     */
+    AppPtr promote(pid_t owner) {
+        auto it = members_.find(owner);
+        if (it == members_.end())
+            return nullptr;
+        std::vector<AppPtr> tree = std::move(it->second);
+        members_.erase(it);
+        AppPtr heir = std::move(tree.back());
+        tree.pop_back();
+        owners_.erase(heir->getPid());
+        if (!tree.empty()) {
+            for (const AppPtr &member: tree) {
+                owners_[member->getPid()] = heir->getPid();
+            }
+            members_.emplace(heir->getPid(), std::move(tree));
+        }
+        return heir;
+    }
+
+    /*!
+     * Removes a member of a tree
+     * \returns false if the process is not a member of a tree
+     */
+    bool removeMember(pid_t pid) {
+        auto it = owners_.find(pid);
+        if (it == owners_.end())
+            return false;
+        auto tree = members_.find(it->second);
+        owners_.erase(it);
+        std::vector<AppPtr> &members = tree->second;
+        for (auto m = members.begin(); m != members.end(); ++m) {
+            if ((*m)->getPid() == pid) {
+                *m = std::move(members.back());
+                members.pop_back();
+                break;
+            }
+        }
+        if (members.empty())
+            members_.erase(tree);
+        return true;
+    }
+
+    /*! Returns the number of members of the tree, the owner excluded */
+    std::size_t memberCount(pid_t owner) const {
+        auto it = members_.find(owner);
+        return it == members_.end() ? 0 : it->second.size();
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // PROCESSTREES_H
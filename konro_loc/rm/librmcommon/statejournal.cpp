@@ -0,0 +1,130 @@
+#include "statejournal.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace rmcommon {
+
+static int openForAppend(const string &path)
+{
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ostringstream os;
+        os << "StateJournal: could not open " << path << ": " << strerror(errno);
+        throw runtime_error(os.str());
+    }
+    return fd;
+}
+
+/*! Formats the journal line of an added application */
+static int formatAdd(char *buf, size_t size, pid_t pid, App::AppType appType, pid_t nsPid, namespace_t ns)
+{
+    return snprintf(buf, size, "+ %ld %s %ld %lu\n",
+                    (long)pid, App::getAppTypeString(appType).c_str(), (long)nsPid, ns);
+}
+
+StateJournal::StateJournal(const string &path) :
+    path_(path),
+    fd_(openForAppend(path)),
+    lines_(0)
+{
+}
+
+StateJournal::~StateJournal()
+{
+    close(fd_);
+}
+
+bool StateJournal::append(const char *line, int len)
+{
+    if (len <= 0)
+        return false;
+    ssize_t n;
+    do {
+        n = write(fd_, line, static_cast<size_t>(len));
+    } while (n < 0 && errno == EINTR);
+    if (n != len)
+        return false;
+    ++lines_;
+    return true;
+}
+
+map<pid_t, StateJournal::Entry> StateJournal::load() const
+{
+    map<pid_t, Entry> entries;
+    ifstream ifs(path_);
+    string content((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    // a line without '\n' at the end of the file was torn by a crash
+    size_t start = 0;
+    for (size_t end = content.find('\n'); end != string::npos; end = content.find('\n', start)) {
+        istringstream is(content.substr(start, end - start));
+        start = end + 1;
+        char op;
+        long pid;
+        if (!(is >> op >> pid) || pid <= 0)
+            continue;
+        if (op == '+') {
+            string type;
+            long nsPid;
+            namespace_t ns;
+            if (is >> type >> nsPid >> ns) {
+                entries[pid] = Entry { static_cast<pid_t>(pid), App::getTypeByName(type),
+                                       static_cast<pid_t>(nsPid), ns };
+            }
+        } else if (op == '-') {
+            entries.erase(pid);
+        }
+    }
+    return entries;
+}
+
+bool StateJournal::recordAdd(const App &app)
+{
+    char line[96];
+    int len = formatAdd(line, sizeof(line), app.getPid(), app.getAppType(),
+                        app.getNsPid(), app.getPidNamespace());
+    return append(line, len);
+}
+
+bool StateJournal::recordRemove(pid_t pid)
+{
+    char line[32];
+    int len = snprintf(line, sizeof(line), "- %ld\n", (long)pid);
+    return append(line, len);
+}
+
+void StateJournal::rewrite(const vector<Entry> &entries)
+{
+    string tmpPath = path_ + ".tmp";
+    {
+        ofstream ofs(tmpPath, ios::trunc);
+        char line[96];
+        for (const Entry &e: entries) {
+            int len = formatAdd(line, sizeof(line), e.pid, e.appType, e.nsPid, e.ns);
+            ofs.write(line, len);
+        }
+        if (!ofs.flush()) {
+            throw runtime_error("StateJournal: could not write " + tmpPath);
+        }
+    }
+    if (rename(tmpPath.c_str(), path_.c_str()) != 0) {
+        ostringstream os;
+        os << "StateJournal: could not rename " << tmpPath << ": " << strerror(errno);
+        throw runtime_error(os.str());
+    }
+    // the file opened before the rename is no longer the journal
+    int fd = openForAppend(path_);
+    close(fd_);
+    fd_ = fd;
+    lines_ = entries.size();
+}
+
+}   // namespace rmcommon
@@ -0,0 +1,101 @@
+#ifndef STATEJOURNAL_H
+#define STATEJOURNAL_H
+
+#include "app.h"
+#include "namespaces.h"
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * \brief A journal of the applications managed by Konro
+ *
+ * The cgroup hierarchy survives a restart of Konro, but it does not
+ * record what Konro knows about each application (type, namespace).
+ * The journal keeps that information: one line is appended for each
+ * addition and removal, so that a restarted Konro can rebuild its state
+ * instead of throwing away the placement of the running applications.
+ * \p
+ * Each line is written with a single write() on a file opened with
+ * O_APPEND. After a crash only the last line can be incomplete, and
+ * it is ignored by load().
+ * \p
+ * The journal is not threadsafe.
+ */
+class StateJournal {
+public:
+    struct Entry {
+        pid_t pid;
+        App::AppType appType;
+        pid_t nsPid;
+        namespace_t ns;
+    };
+
+private:
+    std::string path_;
+    int fd_;
+    /*! lines written since the journal was opened or rewritten */
+    std::size_t lines_;
+
+    bool append(const char *line, int len);
+
+public:
+    /*!
+     * Opens the journal, creating the file if it does not exist
+     * \throws std::runtime_error if the file cannot be opened
+     */
+    explicit StateJournal(const std::string &path);
+    ~StateJournal();
+
+    StateJournal(const StateJournal &) = delete;
+    StateJournal &operator=(const StateJournal &) = delete;
+
+    const std::string &path() const noexcept {
+        return path_;
+    }
+
+    /*!
+     * Returns the number of lines written since the journal was opened
+     * or rewritten: compared with the number of managed applications,
+     * it tells how much a rewrite would shrink the journal
+     */
+    std::size_t lines() const noexcept {
+        return lines_;
+    }
+
+    /*!
+     * Replays the journal
+     * \return the applications which were managed when the journal
+     *         was last written, indexed by pid
+     */
+    std::map<pid_t, Entry> load() const;
+
+    /*!
+     * Records the addition of an application
+     * \return false if the line could not be written
+     */
+    bool recordAdd(const App &app);
+
+    /*!
+     * Records the removal of an application
+     * \return false if the line could not be written
+     */
+    bool recordRemove(pid_t pid);
+
+    /*!
+     * Replaces the content of the journal with the specified applications,
+     * so that the journal does not grow without bounds. The new content
+     * is written to a temporary file which is renamed over the journal.
+     *
+     * \throws std::runtime_error if the journal cannot be rewritten
+     */
+    void rewrite(const std::vector<Entry> &entries);
+};
+
+}   // namespace rmcommon
+
+#endif // STATEJOURNAL_H
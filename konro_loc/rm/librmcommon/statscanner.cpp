@@ -0,0 +1,244 @@
+#include "statscanner.h"
+#include <cerrno>
+#include <charconv>
+#include <unistd.h>
+
+using namespace std;
+
+namespace rmcommon {
+
+namespace {
+
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+bool splitKeyValue(string_view tok, char sep, string_view &key, uint64_t &value)
+{
+    size_t pos = tok.find(sep);
+    if (pos == 0 || pos == string_view::npos) {
+        return false;
+    }
+    key = tok.substr(0, pos);
+    return parseNumber(tok.substr(pos + 1), value);
+}
+
+struct MemoryStatKey {
+    string_view key;
+    uint64_t CgroupMemoryStat::*field;
+};
+
+const MemoryStatKey memoryStatKeys[] = {
+    { "anon", &CgroupMemoryStat::anon },
+    { "file", &CgroupMemoryStat::file },
+    { "kernel", &CgroupMemoryStat::kernel },
+    { "kernel_stack", &CgroupMemoryStat::kernel_stack },
+    { "pagetables", &CgroupMemoryStat::pagetables },
+    { "sock", &CgroupMemoryStat::sock },
+    { "shmem", &CgroupMemoryStat::shmem },
+    { "file_mapped", &CgroupMemoryStat::file_mapped },
+    { "file_dirty", &CgroupMemoryStat::file_dirty },
+    { "file_writeback", &CgroupMemoryStat::file_writeback },
+    { "inactive_anon", &CgroupMemoryStat::inactive_anon },
+    { "active_anon", &CgroupMemoryStat::active_anon },
+    { "inactive_file", &CgroupMemoryStat::inactive_file },
+    { "active_file", &CgroupMemoryStat::active_file },
+    { "unevictable", &CgroupMemoryStat::unevictable },
+    { "slab", &CgroupMemoryStat::slab },
+    { "pgfault", &CgroupMemoryStat::pgfault },
+    { "pgmajfault", &CgroupMemoryStat::pgmajfault },
+    { "workingset_refault_anon", &CgroupMemoryStat::workingset_refault_anon },
+    { "workingset_refault_file", &CgroupMemoryStat::workingset_refault_file }
+};
+
+}   // namespace
+
+bool parseNumber(string_view s, uint64_t &value)
+{
+    if (s.empty()) {
+        return false;
+    }
+    const char *end = s.data() + s.size();
+    auto [ptr, ec] = from_chars(s.data(), end, value);
+    return ec == errc() && ptr == end;
+}
+
+ssize_t preadFull(int fd, char *buf, size_t size, off_t offset)
+{
+    size_t len = 0;
+    while (len < size) {
+        ssize_t n = pread(fd, buf + len, size - len, offset + len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        len += static_cast<size_t>(n);
+    }
+    return static_cast<ssize_t>(len);
+}
+
+bool StatScanner::nextLine()
+{
+    while (next_ < end_) {
+        ptr_ = next_;
+        lineEnd_ = ptr_;
+        while (lineEnd_ < end_ && *lineEnd_ != '\n') {
+            ++lineEnd_;
+        }
+        next_ = lineEnd_ < end_ ? lineEnd_ + 1 : end_;
+        if (lineEnd_ != ptr_) {
+            return true;
+        }
+        // skip empty lines
+    }
+    ptr_ = lineEnd_ = end_;
+    return false;
+}
+
+string_view StatScanner::token()
+{
+    while (ptr_ < lineEnd_ && isBlank(*ptr_)) {
+        ++ptr_;
+    }
+    const char *start = ptr_;
+    while (ptr_ < lineEnd_ && !isBlank(*ptr_)) {
+        ++ptr_;
+    }
+    return string_view(start, ptr_ - start);
+}
+
+bool StatScanner::keyValue(char sep, string_view &key, uint64_t &value)
+{
+    return splitKeyValue(token(), sep, key, value);
+}
+
+bool parseCpuStat(string_view text, CgroupCpuStat &stat)
+{
+    StatScanner sc(text);
+    while (sc.nextLine()) {
+        string_view key = sc.token();
+        uint64_t value;
+        if (!sc.number(value)) {
+            return false;
+        }
+        if (key == "usage_usec") {
+            stat.usage_usec = value;
+        } else if (key == "user_usec") {
+            stat.user_usec = value;
+        } else if (key == "system_usec") {
+            stat.system_usec = value;
+        } else if (key == "nice_usec") {
+            stat.nice_usec = value;
+        } else if (key == "nr_periods") {
+            stat.nr_periods = value;
+        } else if (key == "nr_throttled") {
+            stat.nr_throttled = value;
+        } else if (key == "throttled_usec") {
+            stat.throttled_usec = value;
+        } else if (key == "nr_bursts") {
+            stat.nr_bursts = value;
+        } else if (key == "burst_usec") {
+            stat.burst_usec = value;
+        }
+    }
+    return true;
+}
+
+bool parseMemoryStat(string_view text, CgroupMemoryStat &stat)
+{
+    StatScanner sc(text);
+    while (sc.nextLine()) {
+        string_view key = sc.token();
+        uint64_t value;
+        if (!sc.number(value)) {
+            return false;
+        }
+        for (const MemoryStatKey &mk: memoryStatKeys) {
+            if (mk.key == key) {
+                stat.*mk.field = value;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+bool parseIoStat(string_view text, int major, int minor, CgroupIoStat &stat)
+{
+    StatScanner sc(text);
+    while (sc.nextLine()) {
+        string_view dev = sc.token();
+        size_t pos = dev.find(':');
+        uint64_t devMajor, devMinor;
+        if (pos == string_view::npos ||
+                !parseNumber(dev.substr(0, pos), devMajor) ||
+                !parseNumber(dev.substr(pos + 1), devMinor)) {
+            return false;
+        }
+        if (devMajor != static_cast<uint64_t>(major) || devMinor != static_cast<uint64_t>(minor)) {
+            continue;
+        }
+        stat = CgroupIoStat();
+        stat.major = major;
+        stat.minor = minor;
+        string_view key;
+        uint64_t value;
+        for (string_view tok = sc.token(); !tok.empty(); tok = sc.token()) {
+            if (!splitKeyValue(tok, '=', key, value)) {
+                return false;
+            }
+            if (key == "rbytes") {
+                stat.rbytes = value;
+            } else if (key == "wbytes") {
+                stat.wbytes = value;
+            } else if (key == "rios") {
+                stat.rios = value;
+            } else if (key == "wios") {
+                stat.wios = value;
+            } else if (key == "dbytes") {
+                stat.dbytes = value;
+            } else if (key == "dios") {
+                stat.dios = value;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+size_t parseProcStatCpus(string_view text, ProcStatCpu *cpus, size_t maxCpus)
+{
+    StatScanner sc(text);
+    size_t n = 0;
+    while (n < maxCpus && sc.nextLine()) {
+        string_view name = sc.token();
+        if (name.size() < 3 || name.substr(0, 3) != "cpu") {
+            break;
+        }
+        ProcStatCpu &pc = cpus[n];
+        uint64_t cpu;
+        if (name.size() == 3) {
+            pc.cpu = -1;
+        } else if (parseNumber(name.substr(3), cpu)) {
+            pc.cpu = static_cast<int>(cpu);
+        } else {
+            break;
+        }
+        if (!sc.number(pc.user) || !sc.number(pc.nice) || !sc.number(pc.system) ||
+                !sc.number(pc.idle) || !sc.number(pc.iowait) || !sc.number(pc.irq) ||
+                !sc.number(pc.softirq) || !sc.number(pc.steal) || !sc.number(pc.guest) ||
+                !sc.number(pc.guest_nice)) {
+            break;
+        }
+        ++n;
+    }
+    return n;
+}
+
+}   // namespace rmcommon
@@ -0,0 +1,280 @@
+#ifndef STATSCANNER_H
+#define STATSCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <sys/types.h>
+
+namespace rmcommon {
+
+/*!
+ * Parses an unsigned decimal number with std::from_chars
+ *
+ * \param s the number, without leading or trailing characters
+ * \param value set to the number
+ * \returns false if s is not a valid number
+ */
+bool parseNumber(std::string_view s, uint64_t &value);
+
+/*!
+ * Reads a file with pread() into a fixed buffer, until the buffer
+ * is full or the end of the file
+ *
+ * \returns the number of bytes read, or -1 in case of error (errno is set)
+ */
+ssize_t preadFull(int fd, char *buf, std::size_t size, off_t offset = 0);
+
+/*!
+ * \class scans the text of a stat file without allocating memory
+ *
+ * The text is split in lines, and the current line in tokens separated
+ * by spaces. The scanner only keeps pointers into the text, which must
+ * outlive it. A typical loop is:
+ * \code
+ * StatScanner sc(text);
+ * while (sc.nextLine()) {
+ *     std::string_view key = sc.token();
+ *     uint64_t value;
+ *     if (sc.number(value)) ...
+ * }
+ * \endcode
+ */
+class StatScanner {
+    const char *next_;          // start of the next line
+    const char *end_;           // end of the text
+    const char *ptr_;           // current position in the line
+    const char *lineEnd_;       // end of the current line
+
+public:
+    explicit StatScanner(std::string_view text) :
+        next_(text.data()),
+        end_(text.data() + text.size()),
+        ptr_(next_),
+        lineEnd_(next_) {}
+
+    /*!
+     * Moves to the next line
+     * \returns false at the end of the text
+     */
+    bool nextLine();
+
+    /*! Returns the rest of the current line */
+    std::string_view rest() const {
+        return std::string_view(ptr_, lineEnd_ - ptr_);
+    }
+
+    /*!
+     * Returns the next token of the current line, or an empty view
+     * at the end of the line
+     */
+    std::string_view token();
+
+    /*!
+     * Parses the next token of the current line as a number
+     * \returns false if there are no more tokens or the token is not a number
+     */
+    bool number(uint64_t &value) {
+        return parseNumber(token(), value);
+    }
+
+    /*!
+     * Parses the next token of the current line as a pair "key<sep>value",
+     * such as "rbytes=1024"
+     * \returns false if there are no more tokens or the format is invalid
+     */
+    bool keyValue(char sep, std::string_view &key, uint64_t &value);
+};
+
+/*!
+ * \class a fixed size buffer for the content of a stat file
+ *
+ * The buffer is reused for every read, so that sampling a file does
+ * not allocate memory. The content of a file larger than the buffer
+ * is truncated at the last complete line.
+ */
+template <std::size_t Size>
+class StatBuffer {
+    char buf_[Size];
+    std::size_t len_ = 0;
+    bool truncated_ = false;
+
+public:
+    /*!
+     * Reads the file from offset 0
+     * \returns false in case of error (errno is set)
+     */
+    bool read(int fd) {
+        ssize_t n = preadFull(fd, buf_, Size);
+        len_ = n < 0 ? 0 : static_cast<std::size_t>(n);
+        truncated_ = len_ == Size;
+        if (truncated_) {
+            // drop the incomplete line
+            while (len_ > 0 && buf_[len_ - 1] != '\n') {
+                --len_;
+            }
+        }
+        return n >= 0;
+    }
+
+    /*! Returns the content read by the last read() */
+    std::string_view view() const {
+        return std::string_view(buf_, len_);
+    }
+
+    /*! Returns true if the last read did not reach the end of the file */
+    bool truncated() const {
+        return truncated_;
+    }
+};
+
+/*!
+ * Reads a file of any size in chunks of Size bytes and calls
+ * fn(std::string_view line) for each line, without the newline.
+ * The lines must be shorter than Size.
+ *
+ * \returns false in case of read error or if a line is too long
+ */
+template <std::size_t Size, typename LineFunction>
+bool scanLines(int fd, LineFunction fn)
+{
+    char buf[Size];
+    std::size_t len = 0;        // incomplete line kept from the previous chunk
+    off_t offset = 0;
+    for (;;) {
+        ssize_t n = preadFull(fd, buf + len, Size - len, offset);
+        if (n < 0) {
+            return false;
+        }
+        offset += n;
+        len += static_cast<std::size_t>(n);
+        std::size_t start = 0;
+        const char *nl;
+        while ((nl = static_cast<const char *>(std::memchr(buf + start, '\n', len - start))) != nullptr) {
+            std::size_t lineEnd = nl - buf;
+            fn(std::string_view(buf + start, lineEnd - start));
+            start = lineEnd + 1;
+        }
+        if (len < Size) {
+            // end of file
+            if (start < len) {
+                fn(std::string_view(buf + start, len - start));
+            }
+            return true;
+        }
+        if (start == 0) {
+            return false;
+        }
+        std::memmove(buf, buf + start, len - start);
+        len -= start;
+    }
+}
+
+/*!
+ * The content of the cgroup v2 file cpu.stat (times in microseconds)
+ */
+struct CgroupCpuStat {
+    uint64_t usage_usec = 0;
+    uint64_t user_usec = 0;
+    uint64_t system_usec = 0;
+    uint64_t nice_usec = 0;
+    uint64_t nr_periods = 0;
+    uint64_t nr_throttled = 0;
+    uint64_t throttled_usec = 0;
+    uint64_t nr_bursts = 0;
+    uint64_t burst_usec = 0;
+};
+
+/*!
+ * The most used entries of the cgroup v2 file memory.stat
+ * (amounts in bytes, events as counters). The other entries are ignored.
+ */
+struct CgroupMemoryStat {
+    uint64_t anon = 0;
+    uint64_t file = 0;
+    uint64_t kernel = 0;
+    uint64_t kernel_stack = 0;
+    uint64_t pagetables = 0;
+    uint64_t sock = 0;
+    uint64_t shmem = 0;
+    uint64_t file_mapped = 0;
+    uint64_t file_dirty = 0;
+    uint64_t file_writeback = 0;
+    uint64_t inactive_anon = 0;
+    uint64_t active_anon = 0;
+    uint64_t inactive_file = 0;
+    uint64_t active_file = 0;
+    uint64_t unevictable = 0;
+    uint64_t slab = 0;
+    uint64_t pgfault = 0;
+    uint64_t pgmajfault = 0;
+    uint64_t workingset_refault_anon = 0;
+    uint64_t workingset_refault_file = 0;
+};
+
+/*!
+ * A line of the cgroup v2 file io.stat, i.e. the statistics of a device
+ */
+struct CgroupIoStat {
+    int major = 0;
+    int minor = 0;
+    uint64_t rbytes = 0;
+    uint64_t wbytes = 0;
+    uint64_t rios = 0;
+    uint64_t wios = 0;
+    uint64_t dbytes = 0;
+    uint64_t dios = 0;
+};
+
+/*!
+ * A "cpu" line of /proc/stat (times in USER_HZ)
+ */
+struct ProcStatCpu {
+    /*! number of the processing unit, or -1 for the line of all the CPUs */
+    int cpu = -1;
+    uint64_t user = 0;
+    uint64_t nice = 0;
+    uint64_t system = 0;
+    uint64_t idle = 0;
+    uint64_t iowait = 0;
+    uint64_t irq = 0;
+    uint64_t softirq = 0;
+    uint64_t steal = 0;
+    uint64_t guest = 0;
+    uint64_t guest_nice = 0;
+};
+
+/*!
+ * Parses the content of cpu.stat
+ * \returns false if a line has an invalid format
+ */
+bool parseCpuStat(std::string_view text, CgroupCpuStat &stat);
+
+/*!
+ * Parses the content of memory.stat
+ * \returns false if a line has an invalid format
+ */
+bool parseMemoryStat(std::string_view text, CgroupMemoryStat &stat);
+
+/*!
+ * Looks for the line of a device in the content of io.stat
+ * \returns false if the device is not found or its line has an invalid format
+ */
+bool parseIoStat(std::string_view text, int major, int minor, CgroupIoStat &stat);
+
+/*!
+ * Parses the "cpu" lines at the beginning of /proc/stat
+ *
+ * \param text the content of /proc/stat
+ * \param cpus the array which receives the lines, the line of
+ *        all the CPUs first
+ * \param maxCpus the size of the array
+ * \returns the number of lines parsed; the parsing stops at the first
+ *          line which is not a valid "cpu" line
+ */
+std::size_t parseProcStatCpus(std::string_view text, ProcStatCpu *cpus, std::size_t maxCpus);
+
+}   // namespace rmcommon
+
+#endif // STATSCANNER_H
@@ -0,0 +1,54 @@
+#include "wakeup.h"
+#include <system_error>
+#include <cerrno>
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+using namespace std;
+
+namespace rmcommon {
+
+Wakeup::Wakeup()
+{
+    fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (fd_ < 0) {
+        throw system_error(errno, generic_category(), "Wakeup: could not create eventfd");
+    }
+}
+
+Wakeup::~Wakeup()
+{
+    close(fd_);
+}
+
+void Wakeup::notify() noexcept
+{
+    uint64_t one = 1;
+    // can only fail if the counter overflows, in which case
+    // the eventfd is readable anyway
+    [[maybe_unused]] ssize_t n = write(fd_, &one, sizeof(one));
+}
+
+bool Wakeup::wait(chrono::milliseconds millis)
+{
+    struct pollfd pfd;
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    int timeout = -1;
+    if (millis.count() >= 0) {
+        timeout = static_cast<int>(min<chrono::milliseconds::rep>(millis.count(), INT_MAX));
+    }
+    if (poll(&pfd, 1, timeout) <= 0) {
+        // timeout or signal
+        return false;
+    }
+    uint64_t count;
+    // resets the counter; fails with EAGAIN if another thread got there first
+    return read(fd_, &count, sizeof(count)) == sizeof(count);
+}
+
+}   // namespace rmcommon
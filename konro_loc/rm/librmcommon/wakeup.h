@@ -0,0 +1,60 @@
+#ifndef WAKEUP_H
+#define WAKEUP_H
+
+#include <chrono>
+
+namespace rmcommon {
+
+/*!
+ * \brief Wakes up a thread blocked waiting for something to happen
+ *
+ * Wakeup wraps a Linux eventfd: notify() increments the counter of the
+ * eventfd and wait() blocks in poll() until the counter is not zero,
+ * then resets it. A blocked thread costs no wakeups until it is
+ * notified or its timeout expires.
+ * \p
+ * Notifications are not lost: if notify() is called before wait(),
+ * wait() returns immediately. Several notifications may be merged
+ * into one, so the waiting thread must always check its condition
+ * again after waking up.
+ * \p
+ * The file descriptor can also be added to an epoll set together
+ * with other file descriptors.
+ */
+class Wakeup {
+    int fd_;
+
+public:
+    /*!
+     * \throws std::system_error if the eventfd cannot be created
+     */
+    Wakeup();
+    ~Wakeup();
+
+    Wakeup(const Wakeup &) = delete;
+    Wakeup &operator=(const Wakeup &) = delete;
+
+    /*! Wakes up the waiting thread. Can be called by any thread */
+    void notify() noexcept;
+
+    /*!
+     * Waits until notify() is called or the timeout expires.
+     *
+     * \param millis the timeout; a negative value waits forever
+     * \return true if the thread was notified
+     */
+    bool wait(std::chrono::milliseconds millis);
+
+    /*! Waits until notify() is called */
+    void wait() {
+        wait(std::chrono::milliseconds(-1));
+    }
+
+    int fd() const noexcept {
+        return fd_;
+    }
+};
+
+}   // namespace rmcommon
+
+#endif // WAKEUP_H
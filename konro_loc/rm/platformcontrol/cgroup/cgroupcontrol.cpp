@@ -2,6 +2,8 @@
 #include "tsplit.h"
 #include "pcexception.h"
 #include "dir.h"
+#include <algorithm>
+#include <cstdlib>
 #include <string>
 #include <sstream>
 #include <fstream>
@@ -15,6 +17,12 @@ using namespace std;
 
 namespace pc {
 
+/*! The controllers enabled for the cgroups of the apps when they are created */
+static const char *const appControllers[] = { "cpu", "cpuset", "memory", "io", "pids" };
+
+/*! Reserved cgroups not used within this time are removed */
+static constexpr std::chrono::seconds reservationTimeout(60);
+
 /*static*/ std::atomic_bool CGroupControl::changeContainerCgroup_(false);
 /*static*/ std::atomic_bool CGroupControl::changeKubernetesCgroup_(false);
 
@@ -25,6 +33,20 @@ CGroupControl::CGroupControl() :
 
 CGroupControl::~CGroupControl()
 {
+    setScopePoolSize(0);
+}
+
+void CGroupControl::setScopePoolSize(size_t size)
+{
+    if (scopePool_) {
+        scopePool_->stop();
+        scopePool_->join();
+        scopePool_.reset();
+    }
+    if (size > 0) {
+        scopePool_ = make_unique<ScopePool>(size, [this] { return makeScope("pool"); });
+        scopePool_->start();
+    }
 }
 
 void CGroupControl::cleanup()
@@ -58,16 +80,127 @@ void CGroupControl::cleanup()
         }
         cat_.info("CGROUPCONTROL removing directory %s", konroBaseDir.c_str());
         Dir::rmdir(konroBaseDir.c_str());
+        util::forgetControllers(konroBaseDir);
     } catch (runtime_error &e) {
         cat_.error(e.what());
     }
 }
 
-void CGroupControl::checkActivateController(const char *controllerName, const char *fileName, const std::string &cgroupPath) const
+/*!
+ * Returns the pid in the name of an app-<pid>.scope directory, or 0
+ */
+static pid_t parseAppDirName(const string &name)
+{
+    static const string prefix = "app-";
+    static const string suffix = ".scope";
+    if (name.size() <= prefix.size() + suffix.size()
+            || name.compare(0, prefix.size(), prefix) != 0
+            || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+        return 0;
+    char *end;
+    long pid = strtol(name.c_str() + prefix.size(), &end, 10);
+    return end == name.c_str() + name.size() - suffix.size() ? static_cast<pid_t>(pid) : 0;
+}
+
+/*!
+ * Returns true if "name" is the name of a launch-<pid>-<n>.scope or
+ * pool-<pid>-<n>.scope directory, whose name does not contain the pid
+ * of the application
+ */
+static bool isAnonymousDirName(const string &name)
+{
+    static const string prefixes[] = { "launch-", "pool-" };
+    static const string suffix = ".scope";
+    for (const string &prefix: prefixes) {
+        if (name.size() > prefix.size() + suffix.size()
+                && name.compare(0, prefix.size(), prefix) == 0
+                && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*!
+ * Returns true if "name" is an anonymous directory created by this
+ * Konro process (e.g. by the scope pool), which is not left over from
+ * a previous run
+ */
+static bool isOwnAnonymousDirName(const string &name)
+{
+    if (!isAnonymousDirName(name))
+        return false;
+    string pidPart = "-" + to_string(getpid()) + "-";
+    size_t dash = name.find('-');
+    return name.compare(dash, pidPart.size(), pidPart) == 0;
+}
+
+std::vector<IPlatformControl::RecoveredGroup> CGroupControl::recoverApplications()
+{
+    using namespace rmcommon;
+
+    vector<RecoveredGroup> groups;
+    try {
+        string konroBaseDir = util::getCgroupKonroBaseDir();
+        if (!Dir::dir_exists(konroBaseDir.c_str())) {
+            cat_.info("CGROUPCONTROL recover: %s does not exist", konroBaseDir.c_str());
+            return groups;
+        }
+        Dir dir = Dir::localdir(konroBaseDir.c_str());
+        for (Dir::DirIterator it = dir.begin(); it != dir.end(); ++it) {
+            if (!it->is_dir())
+                continue;
+            pid_t pid = parseAppDirName(it->name());
+            // in a launch or pool directory, the first process is the application
+            if (pid <= 0 && !isAnonymousDirName(it->name()))
+                continue;
+            // the empty cgroups of the scope pool are still in use
+            if (isOwnAnonymousDirName(it->name()))
+                continue;
+            RecoveredGroup group;
+            group.cgroupDir = make_path(konroBaseDir, it->name());
+            group.pid = pid;
+            group.pids = util::getPids(group.cgroupDir);
+            if (group.pids.empty()) {
+                cat_.info("CGROUPCONTROL recover: removing directory %s", group.cgroupDir.c_str());
+                try {
+                    Dir::rmdir(group.cgroupDir.c_str());
+                } catch (runtime_error &e) {
+                    cat_.error(e.what());
+                }
+                continue;
+            }
+            groups.push_back(std::move(group));
+        }
+    } catch (runtime_error &e) {
+        cat_.error("CGROUPCONTROL recover: %s", e.what());
+    }
+    return groups;
+}
+
+std::shared_ptr<CgroupHandle> CGroupControl::getHandle(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app) const
+{
+    std::shared_ptr<CgroupHandle> handle = CgroupHandle::get(getCgroupAppDir(app));
+    if (!util::isControllerActive(controllerName, handle->path())) {
+        if (handle->exists(fileName)) {
+            // enabled outside Konro, e.g. by the container runtime
+            util::setControllerActive(controllerName, handle->path());
+        } else {
+            util::activateController(controllerName, handle->path());
+        }
+    }
+    return handle;
+}
+
+void CGroupControl::activateControllers(const string &cgroupDir)
 {
-    std::string filePath = rmcommon::make_path(cgroupPath, fileName);
-    if (!rmcommon::Dir::file_exists(filePath.c_str())) {
-        util::activateController(controllerName, cgroupPath);
+    for (const char *controllerName: appControllers) {
+        if (util::isControllerActive(controllerName, cgroupDir))
+            continue;
+        try {
+            util::activateController(controllerName, cgroupDir);
+        } catch (PcException &e) {
+            cat_.warn("CGROUPCONTROL activateControllers: %s", e.what());
+        }
     }
 }
 
@@ -81,6 +214,11 @@ string CGroupControl::getCgroupAppDir(std::shared_ptr<rmcommon::App> app) const
 {
     if (doNotMoveApp(app)) {
         return util::findCgroupPath(app->getPid());
+    }
+    // the members of a process tree are in the cgroup of the root
+    string cgroupDir = app->getCgroupDir();
+    if (!cgroupDir.empty()) {
+        return cgroupDir;
     } else {
         return util::getCgroupKonroAppDir(app->getPid());
     }
@@ -88,26 +226,24 @@ string CGroupControl::getCgroupAppDir(std::shared_ptr<rmcommon::App> app) const
 
 std::string CGroupControl::getLine(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app) const
 {
-    // 1 - Find cgroup path
-    string cgroupPath = getCgroupAppDir(app);
-
-    // 2 - If the controller interface file doesn't exist, activate the controller
-    checkActivateController(controllerName, fileName, cgroupPath);
-
-    // 3 - Get line from the file
-    return util::getLine(fileName, cgroupPath);
+    string content = getHandle(controllerName, fileName, app)->read(fileName);
+    return content.substr(0, content.find('\n'));
 }
 
 std::vector<string> CGroupControl::getContent(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app) const
 {
-    // 1 - Find cgroup path
-    string cgroupPath = getCgroupAppDir(app);
-
-    // 2 - If the controller interface file doesn't exist, activate the controller
-    checkActivateController(controllerName, fileName, cgroupPath);
-
-    // 3 - Get content from the file
-    return util::getContent(fileName, cgroupPath);
+    string content = getHandle(controllerName, fileName, app)->read(fileName);
+    vector<string> lines;
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t end = content.find('\n', start);
+        if (end == string::npos) {
+            end = content.size();
+        }
+        lines.push_back(content.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
 }
 
 int CGroupControl::getValueAsInt(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app) const
@@ -119,48 +255,148 @@ int CGroupControl::getValueAsInt(const char *controllerName, const char *fileNam
 
 std::map<string, uint64_t> CGroupControl::getContentAsMap(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app)
 {
-    string cgroupPath = getCgroupAppDir(app);
-    checkActivateController(controllerName, fileName, cgroupPath);
-
     std::map<std::string, uint64_t> tags;
-    std::vector<std::string> fileContent = getContent(controllerName, fileName, app);
-    for (auto &line: fileContent) {
-        std::string tag;
+    rmcommon::StatBuffer<8192> buf;
+    rmcommon::StatScanner sc(readContent(controllerName, fileName, app, buf));
+    while (sc.nextLine()) {
+        std::string_view tag = sc.token();
         uint64_t value;
-        std::istringstream is(line);
-        is >> tag >> value;
-        if (is.fail())
+        if (!sc.number(value))
             break;
         tags.emplace(tag, value);
     }
     return tags;
 }
 
+std::string CGroupControl::makeScope(const char *prefix)
+{
+    static std::atomic_uint seq(0);
+
+    ostringstream os;
+    os << prefix << "-" << getpid() << "-" << ++seq << ".scope";
+    string cgroupDir = rmcommon::make_path(util::getCgroupKonroBaseDir(), os.str());
+    try {
+        rmcommon::Dir::mkdir_r(cgroupDir.c_str());
+    } catch (runtime_error &e) {
+        cat_.error("CGROUPCONTROL makeScope: could not create directory %s: %s",
+                   cgroupDir.c_str(),
+                   e.what());
+        return string();
+    }
+    activateControllers(cgroupDir);
+    return cgroupDir;
+}
+
+std::string CGroupControl::newAppGroup(pid_t pid)
+{
+    if (scopePool_) {
+        string cgroupDir = scopePool_->take();
+        if (!cgroupDir.empty()) {
+            return cgroupDir;
+        }
+        cat_.debug("CGROUPCONTROL newAppGroup: scope pool empty");
+    }
+    string cgroupDir = util::getCgroupKonroAppDir(pid);
+    rmcommon::Dir::mkdir_r(cgroupDir.c_str());
+    activateControllers(cgroupDir);
+    return cgroupDir;
+}
+
+std::string CGroupControl::reserveApplicationGroup()
+{
+    pruneReservedGroups();
+    string cgroupDir = makeScope("launch");
+    if (cgroupDir.empty()) {
+        return cgroupDir;
+    }
+    {
+        lock_guard<mutex> lck(reservedMutex_);
+        reserved_[cgroupDir] = chrono::steady_clock::now();
+    }
+    cat_.info("CGROUPCONTROL reserveApplicationGroup: reserved cgroup directory %s", cgroupDir.c_str());
+    return cgroupDir;
+}
+
+void CGroupControl::pruneReservedGroups()
+{
+    vector<string> expired;
+    {
+        lock_guard<mutex> lck(reservedMutex_);
+        auto now = chrono::steady_clock::now();
+        for (const auto &p: reserved_) {
+            if (now - p.second > reservationTimeout) {
+                expired.push_back(p.first);
+            }
+        }
+    }
+    for (const string &cgroupDir: expired) {
+        try {
+            // fails if the launcher has created the application
+            // but the add request has not arrived yet
+            rmcommon::Dir::rmdir(cgroupDir.c_str());
+        } catch (runtime_error &e) {
+            continue;
+        }
+        cat_.info("CGROUPCONTROL removed unused reserved cgroup directory %s", cgroupDir.c_str());
+        lock_guard<mutex> lck(reservedMutex_);
+        reserved_.erase(cgroupDir);
+    }
+}
+
+bool CGroupControl::adoptReservedGroup(std::shared_ptr<rmcommon::App> app)
+{
+    lock_guard<mutex> lck(reservedMutex_);
+    if (reserved_.empty()) {
+        return false;
+    }
+    string cgroupDir;
+    try {
+        cgroupDir = util::findCgroupPath(app->getPid());
+    } catch (PcException &e) {
+        return false;
+    }
+    auto it = reserved_.find(cgroupDir);
+    if (it == reserved_.end()) {
+        return false;
+    }
+    reserved_.erase(it);
+    app->setCgroupDir(cgroupDir);
+    cat_.info("CGROUPCONTROL addApplication: PID %ld started in reserved cgroup directory %s",
+              (long)app->getPid(), cgroupDir.c_str());
+    return true;
+}
+
 bool CGroupControl::addApplication(std::shared_ptr<rmcommon::App> app)
 {
+    static rmcommon::LatencyHistogram &histogram =
+            rmcommon::LatencyStats::instance().histogram("CGROUPCONTROL", "addApplication", "apply");
+    rmcommon::ScopedLatency latency(histogram);
 #ifdef TIMING
     rmcommon::KonroTimer detailTimer;
     rmcommon::KonroTimer timer;
 #endif
-    string cgroupAppBaseDir = getCgroupAppDir(app);
     if (doNotMoveApp(app)) {
-        app->setCgroupDir(cgroupAppBaseDir);
+        app->setCgroupDir(getCgroupAppDir(app));
+        return true;
+    }
+    if (adoptReservedGroup(app)) {
         return true;
     }
 
+    string cgroupAppBaseDir;
     try {
 #ifdef TIMING
         detailTimer.Restart();
 #endif
-        rmcommon::Dir::mkdir_r(cgroupAppBaseDir.c_str());
+        cgroupAppBaseDir = newAppGroup(app->getPid());
 #ifdef TIMING
-        cat_.debug("CGROUPCONTROL timing: addApplication mkdir_r = %ld microseconds",
+        cat_.debug("CGROUPCONTROL timing: addApplication newAppGroup = %ld microseconds",
                    (long)detailTimer.Elapsed().count());
 #endif
 
     } catch (runtime_error &e) {
-        cat_.error("CGROUPCONTROL addApplication: could not create directory %s: %s",
-                   cgroupAppBaseDir.c_str(),
+        cat_.error("CGROUPCONTROL addApplication: could not create directory for PID %ld: %s",
+                   (long)app->getPid(),
                    e.what());
         return false;
     }
@@ -198,16 +434,85 @@ bool CGroupControl::addApplication(std::shared_ptr<rmcommon::App> app)
     return true;
 }
 
+bool CGroupControl::addApplicationTree(std::shared_ptr<rmcommon::App> app,
+                                       std::vector<std::shared_ptr<rmcommon::App>> &members)
+{
+    static rmcommon::LatencyHistogram &histogram =
+            rmcommon::LatencyStats::instance().histogram("CGROUPCONTROL", "addApplicationTree", "apply");
+    rmcommon::ScopedLatency latency(histogram);
+    if (doNotMoveApp(app)) {
+        string cgroupDir = getCgroupAppDir(app);
+        app->setCgroupDir(cgroupDir);
+        for (auto &member: members) {
+            member->setCgroupDir(cgroupDir);
+        }
+        return true;
+    }
+
+    // the whole tree is moved to the cgroup of the root
+    string cgroupAppBaseDir;
+    try {
+        cgroupAppBaseDir = newAppGroup(app->getPid());
+    } catch (runtime_error &e) {
+        cat_.error("CGROUPCONTROL addApplicationTree: could not create directory for PID %ld: %s",
+                   (long)app->getPid(),
+                   e.what());
+        return false;
+    }
+
+    cat_.info("CGROUPCONTROL addApplicationTree: move PID %ld and %lu descendants to cgroup directory %s",
+              (long)app->getPid(), (unsigned long)members.size(), cgroupAppBaseDir.c_str());
+
+    vector<pid_t> pids;
+    pids.reserve(members.size() + 1);
+    pids.push_back(app->getPid());
+    for (const auto &member: members) {
+        pids.push_back(member->getPid());
+    }
+    vector<pid_t> notMoved;
+    try {
+        notMoved = util::moveToCgroup(cgroupAppBaseDir, pids);
+    } catch (runtime_error &e) {
+        cat_.error("CGROUPCONTROL addApplicationTree: could not move to cgroup %s: %s",
+                   cgroupAppBaseDir.c_str(),
+                   e.what());
+        return false;
+    }
+    if (find(notMoved.begin(), notMoved.end(), app->getPid()) != notMoved.end()) {
+        cat_.error("CGROUPCONTROL addApplicationTree: could not move PID %ld to cgroup %s",
+                   (long)app->getPid(), cgroupAppBaseDir.c_str());
+        return false;
+    }
+
+    app->setCgroupDir(cgroupAppBaseDir);
+    vector<shared_ptr<rmcommon::App>> moved;
+    moved.reserve(members.size());
+    for (auto &member: members) {
+        if (find(notMoved.begin(), notMoved.end(), member->getPid()) == notMoved.end()) {
+            member->setCgroupDir(cgroupAppBaseDir);
+            moved.push_back(member);
+        }
+    }
+    members.swap(moved);
+    return true;
+}
+
 bool CGroupControl::removeApplication(std::shared_ptr<rmcommon::App> app)
 {
+    static rmcommon::LatencyHistogram &histogram =
+            rmcommon::LatencyStats::instance().histogram("CGROUPCONTROL", "removeApplication", "apply");
+    rmcommon::ScopedLatency latency(histogram);
 #ifdef TIMING
     rmcommon::KonroTimer timer;
 #endif
     if (doNotMoveApp(app)) {
+        // the cgroup is not removed, but the application may have been
+        // the last one using it
+        CgroupHandle::invalidate(app->getCgroupDir());
         return true;
     }
 
-    string cgroupAppBaseDir = util::getCgroupKonroAppDir(app->getPid());
+    string cgroupAppBaseDir = getCgroupAppDir(app);
 
     cat_.info("CGROUPCONTROL removeApplication PID %ld: remove cgroup directory %s",
               (long)app->getPid(), cgroupAppBaseDir.c_str());
@@ -216,10 +521,17 @@ bool CGroupControl::removeApplication(std::shared_ptr<rmcommon::App> app)
     try {
         rmcommon::Dir::rmdir(cgroupAppBaseDir.c_str());
     } catch (runtime_error &e) {
+        if (!getApplicationPids(app).empty()) {
+            // other processes of the same tree are still in the cgroup
+            cat_.debug("CGROUPCONTROL removeApplication PID %ld: cgroup directory %s still in use",
+                       (long)app->getPid(), cgroupAppBaseDir.c_str());
+            return true;
+        }
         cat_.error("CGROUPCONTROL removeApplication PID %ld: could not remove cgroup directory %s",
                   (long)app->getPid(), cgroupAppBaseDir.c_str());
         return false;
     }
+    CgroupHandle::invalidate(cgroupAppBaseDir);
 
 #ifdef TIMING
     rmcommon::KonroTimer::TimeUnit micros = timer.Elapsed(rmcommon::KonroTimer::TIMER_RESTART);
@@ -228,5 +540,19 @@ bool CGroupControl::removeApplication(std::shared_ptr<rmcommon::App> app)
     return true;
 }
 
+std::vector<pid_t> CGroupControl::getApplicationPids(std::shared_ptr<rmcommon::App> app)
+{
+    vector<pid_t> pids;
+    if (doNotMoveApp(app)) {
+        return pids;
+    }
+    try {
+        pids = util::getPids(getCgroupAppDir(app));
+    } catch (PcException &e) {
+        // the directory has already been removed
+        cat_.debug("CGROUPCONTROL getApplicationPids: %s", e.what());
+    }
+    return pids;
 }
 
+}
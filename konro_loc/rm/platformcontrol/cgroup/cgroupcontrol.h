@@ -3,13 +3,20 @@
 
 #include "app.h"
 #include "cgrouputil.h"
+#include "cgrouphandle.h"
+#include "scopepool.h"
 #include "dir.h"
+#include "latencystats.h"
 #include "../iplatformcontrol.h"
 
 #include <string>
+#include <string_view>
+#include <sstream>
 #include <vector>
 #include <map>
 #include <atomic>
+#include <chrono>
+#include <mutex>
 #include <unistd.h>
 #include <log4cpp/Category.hh>
 
@@ -30,15 +37,59 @@ class CGroupControl : public IPlatformControl {
     static std::atomic_bool changeContainerCgroup_;
     static std::atomic_bool changeKubernetesCgroup_;
 
+    /*! cgroups reserved for applications not started yet, with the time of the reservation */
+    std::mutex reservedMutex_;
+    std::map<std::string, std::chrono::steady_clock::time_point> reserved_;
+
+    /*! empty cgroups created in advance for the apps, if enabled */
+    std::unique_ptr<ScopePool> scopePool_;
+
     /*!
-     * Checks if the specified controller interface file exists in a folder.
-     * If it doesn't, the function activates the proper cgroup controller in order
-     * to spawn the file.
+     * Returns the handle of the cgroup of the app. If the controller is
+     * not known to be enabled and the interface file doesn't exist, the
+     * function activates the proper cgroup controller in order to spawn
+     * the file.
      * \param controllerName the type of resource of interest
-     * \param fileName the file we want to check the existence of
-     * \param cgroupPath the location of the file
+     * \param fileName the file we want to access
+     * \param app the application of interest
+     * \throws PcException if the cgroup cannot be opened
+     */
+    std::shared_ptr<CgroupHandle> getHandle(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app) const;
+
+    /*!
+     * Enables the controllers used by Konro for a new app cgroup, so that
+     * the accesses to the interface files do not need to do it.
+     * The levels already enabled are skipped without accessing the
+     * file system.
+     */
+    void activateControllers(const std::string &cgroupDir);
+
+    /*!
+     * Creates a new empty cgroup named <prefix>-<Konro PID>-<n>.scope
+     * in the Konro hierarchy and enables its controllers
+     * \returns the path of the cgroup, or an empty string in case of error
+     */
+    std::string makeScope(const char *prefix);
+
+    /*!
+     * Returns a new empty cgroup for the app, taken from the pool if
+     * possible, otherwise created as app-<pid>.scope
+     * \throws runtime_error if the cgroup cannot be created
+     */
+    std::string newAppGroup(pid_t pid);
+
+    /*!
+     * If the app has been started in a reserved cgroup, the cgroup
+     * becomes the cgroup of the app.
+     * \returns true if the app is in a reserved cgroup
+     */
+    bool adoptReservedGroup(std::shared_ptr<rmcommon::App> app);
+
+    /*!
+     * Removes the reserved cgroups which have not been used by
+     * a launcher within a minute
      */
-    void checkActivateController(const char *controllerName, const char *fileName, const std::string &cgroupPath) const;
+    void pruneReservedGroups();
 
     /*!
      * Returns true if the app must not be moved to the Konro cgroup hierarchy
@@ -64,6 +115,36 @@ public:
      */
     void cleanup();
 
+    /*!
+     * Alternative to cleanup(): the Konro cgroup hierarchy is left as it
+     * is, so that the processes keep their resources across a restart.
+     * Only the directories without live processes are removed.
+     *
+     * \returns the app-<pid>.scope, launch-*.scope and pool-*.scope
+     *          directories which contain live processes
+     */
+    std::vector<RecoveredGroup> recoverApplications() override;
+
+    /*!
+     * \brief Creates an empty cgroup for an application not started yet.
+     *
+     * The name of the new directory is launch-<Konro PID>-<n>.scope and
+     * is located at /sys/fs/cgroup/konro.slice. The controllers are
+     * enabled, so the application can be created directly inside the
+     * cgroup with clone3(CLONE_INTO_CGROUP). The launcher needs write
+     * access to the cgroup.procs file of the new directory.
+     *
+     * \returns the path of the directory, or an empty string in case of error
+     */
+    std::string reserveApplicationGroup() override;
+
+    /*!
+     * Keeps "size" empty cgroups ready for the new apps, refilled by
+     * a separate thread. Must be called after cleanup().
+     * A size of 0 disables the pool.
+     */
+    void setScopePoolSize(std::size_t size);
+
     void setChangeContainerCgroup(bool val) {
         changeContainerCgroup_ = val;
     }
@@ -72,31 +153,54 @@ public:
         changeKubernetesCgroup_ = val;
     }
 
+    /*!
+     * \brief The latency histograms of the writes to a controller
+     *        interface file.
+     *
+     * Looking up a histogram takes the lock of LatencyStats, so each
+     * caller of setValue resolves them once, in a function-local static.
+     */
+    struct WriteLatency {
+        rmcommon::LatencyHistogram &apply;
+        rmcommon::LatencyHistogram &error;
+
+        explicit WriteLatency(const char *fileName) :
+            apply(rmcommon::LatencyStats::instance().histogram("CGROUPCONTROL", fileName, "apply")),
+            error(rmcommon::LatencyStats::instance().histogram("CGROUPCONTROL", fileName, "error")) {}
+    };
+
     /*!
      * \brief Enforces a resource constraint on the specified application.
      *
      * This is done by writing a value to the specified
      * controller interface file.
      *
-     * \example setValue("cpuset", "cpuset.cpus", "2", app1)
+     * \example static const WriteLatency latency("cpuset.cpus");
+     *          setValue("cpuset", "cpuset.cpus", "2", app1, latency)
      *          Limits app1 to use CPU number 2 only
      *
      * \param controllerName the type of resource to limit
      * \param fileName the file to write to
      * \param value the value to write
      * \param app the application to limit
+     * \param latency the histograms of the writes to fileName
      * \throws PcException in case of error
      */
     template<typename T>
-    void setValue(const char *controllerName, const char *fileName, T value, std::shared_ptr<rmcommon::App> app) const {
-        // 1 - Find cgroup path
-        std::string cgroupPath = getCgroupAppDir(app);
+    void setValue(const char *controllerName, const char *fileName, T value,
+                  std::shared_ptr<rmcommon::App> app, const WriteLatency &latency) const {
+        rmcommon::ScopedLatency scoped(latency.apply);
+        rmcommon::KonroTimer::TimePoint start = rmcommon::KonroTimer::now();
 
-        // 2 - If the controller interface file doesn't exist, activate the controller
-        checkActivateController(controllerName, fileName, cgroupPath);
-
-        // 3 - Write value in the correct cgroup
-        util::writeValue(fileName, value, cgroupPath);
+        std::ostringstream os;
+        os << value;
+        try {
+            getHandle(controllerName, fileName, app)->write(fileName, os.str());
+        } catch (...) {
+            // the count of the "error" histogram is the number of failed writes
+            latency.error.record(rmcommon::KonroTimer::ElapsedFrom(start));
+            throw;
+        }
     }
 
     /*!
@@ -128,6 +232,25 @@ public:
      */
     std::vector<std::string> getContent(const char *controllerName, const char *fileName, std::shared_ptr<rmcommon::App> app) const;
 
+    /*!
+     * \brief Reads a controller interface file into a fixed buffer.
+     *
+     * This function should be used to sample statistics files, such as
+     * cpu.stat, without allocating memory. Parse the content with
+     * rmcommon::StatScanner or one of the parsers in statscanner.h.
+     *
+     * \param fileName the file to read
+     * \param app the application of interest
+     * \param buf the buffer which receives the content
+     * \returns the content of the file, valid until the next read into buf
+     * \throws PcException in case of error
+     */
+    template <std::size_t Size>
+    std::string_view readContent(const char *controllerName, const char *fileName,
+                                 std::shared_ptr<rmcommon::App> app, rmcommon::StatBuffer<Size> &buf) const {
+        return getHandle(controllerName, fileName, app)->read(fileName, buf);
+    }
+
     /*!
      * \brief Returns the current limit applied to an application for a specific resource
      *        as an integer.
@@ -156,12 +279,27 @@ public:
      *
      * The PID of the application is moved to a new direcotry of the cgroup hieararchy.
      * The name name of the new directory is app-<PID>.scope and is located at
-     * /sys/fs/cgroup/konro.slice.
+     * /sys/fs/cgroup/konro.slice. If the scope pool is enabled, the directory
+     * is taken from the pool and its name is pool-<Konro PID>-<n>.scope.
+     * An application started in a reserved cgroup is not moved: the reserved
+     * cgroup becomes its cgroup.
      *
      * \param app the application to manage
      */
     bool addApplication(std::shared_ptr<rmcommon::App> app) override;
 
+    /*!
+     * \brief Adds an application and the processes of its tree.
+     *
+     * The root and the members are moved to the same cgroup, the
+     * cgroup of the root, with one open of cgroup.procs.
+     *
+     * \param app the root of the tree
+     * \param members the other processes of the tree
+     */
+    bool addApplicationTree(std::shared_ptr<rmcommon::App> app,
+                            std::vector<std::shared_ptr<rmcommon::App>> &members) override;
+
     /*!
      * \brief Removes an application from the management of Konro.
      *
@@ -172,6 +310,18 @@ public:
      * \param app the application to remove from Konro's management
      */
     bool removeApplication(std::shared_ptr<rmcommon::App> app) override;
+
+    /*!
+     * \brief Returns the pids listed in the cgroup.procs file of the
+     *        application's directory in the Konro hierarchy.
+     *
+     * Applications which are not moved to the Konro hierarchy (e.g.
+     * containers) share their cgroup with unrelated processes, so
+     * an empty vector is returned for them.
+     *
+     * \param app the application of interest
+     */
+    std::vector<pid_t> getApplicationPids(std::shared_ptr<rmcommon::App> app) override;
 };
 
 }
@@ -0,0 +1,207 @@
+#include "cgrouphandle.h"
+#include "pcexception.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace pc {
+
+namespace {
+
+/*! the budget of the cache when RLIMIT_NOFILE is very low */
+const size_t MIN_FD_BUDGET = 64;
+
+/*! the descriptors open in all the handles, the evicted ones included */
+atomic<size_t> openFds(0);
+
+size_t computeFdBudget()
+{
+    struct rlimit rlim;
+    if (getrlimit(RLIMIT_NOFILE, &rlim) < 0 || rlim.rlim_cur == RLIM_INFINITY) {
+        return 1024;
+    }
+    return max(static_cast<size_t>(rlim.rlim_cur / 2), MIN_FD_BUDGET);
+}
+
+struct HandleCache {
+    mutex mut;
+    /*! the handles, the most recently used first */
+    list<shared_ptr<CgroupHandle>> lru;
+    unordered_map<string, list<shared_ptr<CgroupHandle>>::iterator> handles;
+    size_t fdBudget = computeFdBudget();
+
+    /*! Moves a handle to the front of the LRU list and returns it */
+    shared_ptr<CgroupHandle> touch(list<shared_ptr<CgroupHandle>>::iterator it) {
+        lru.splice(lru.begin(), lru, it);
+        return *it;
+    }
+
+    /*! Removes the least recently used handles until the budget is met */
+    void evict() {
+        // the most recently used handle is always kept
+        while (openFds.load() > fdBudget && lru.size() > 1) {
+            handles.erase(lru.back()->path());
+            lru.pop_back();
+        }
+    }
+};
+
+HandleCache &handleCache()
+{
+    static HandleCache cache;
+    return cache;
+}
+
+[[noreturn]] void throwError(const char *funcName, const char *what, const string &path, const char *fileName)
+{
+    ostringstream os;
+    os << funcName << ": could not " << what << " " << path;
+    if (fileName) {
+        os << "/" << fileName;
+    }
+    os << ": " << strerror(errno);
+    throw PcException(os.str());
+}
+
+}   // namespace
+
+CgroupHandle::CgroupHandle(const string &path) :
+    path_(path)
+{
+    dirFd_ = open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (dirFd_ < 0) {
+        throwError(__func__, "open directory", path_, nullptr);
+    }
+    ++openFds;
+}
+
+CgroupHandle::~CgroupHandle()
+{
+    for (const auto &p: fds_) {
+        close(p.second);
+    }
+    close(dirFd_);
+    openFds -= fds_.size() + 1;
+}
+
+int CgroupHandle::fd(const char *fileName)
+{
+    lock_guard<mutex> lck(mut_);
+    auto it = fds_.find(fileName);
+    if (it != fds_.end()) {
+        return it->second;
+    }
+    int fd = openat(dirFd_, fileName, O_RDWR | O_CLOEXEC);
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+        // read-only interface file
+        fd = openat(dirFd_, fileName, O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        throwError("CgroupHandle::fd", "open file", path_, fileName);
+    }
+    fds_.emplace(fileName, fd);
+    ++openFds;
+    return fd;
+}
+
+void CgroupHandle::throwReadError(const char *fileName) const
+{
+    throwError("CgroupHandle::read", "read file", path_, fileName);
+}
+
+bool CgroupHandle::exists(const char *fileName)
+{
+    {
+        lock_guard<mutex> lck(mut_);
+        if (fds_.find(fileName) != fds_.end()) {
+            return true;
+        }
+    }
+    return faccessat(dirFd_, fileName, F_OK, 0) == 0;
+}
+
+void CgroupHandle::write(const char *fileName, const string &value)
+{
+    int fd = this->fd(fileName);
+    ssize_t n;
+    do {
+        // the kernel handles each write as a whole: no partial writes
+        n = pwrite(fd, value.data(), value.size(), 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        throwError("CgroupHandle::write", "write to file", path_, fileName);
+    }
+}
+
+string CgroupHandle::read(const char *fileName)
+{
+    int fd = this->fd(fileName);
+    string content;
+    char buf[4096];
+    off_t offset = 0;
+    for (;;) {
+        ssize_t n = pread(fd, buf, sizeof(buf), offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throwError("CgroupHandle::read", "read file", path_, fileName);
+        }
+        if (n == 0) {
+            break;
+        }
+        content.append(buf, static_cast<size_t>(n));
+        offset += n;
+    }
+    return content;
+}
+
+shared_ptr<CgroupHandle> CgroupHandle::get(const string &path)
+{
+    HandleCache &cache = handleCache();
+    {
+        lock_guard<mutex> lck(cache.mut);
+        auto it = cache.handles.find(path);
+        if (it != cache.handles.end()) {
+            return cache.touch(it->second);
+        }
+    }
+    // the directory is opened without holding the lock
+    auto handle = make_shared<CgroupHandle>(path);
+    lock_guard<mutex> lck(cache.mut);
+    auto it = cache.handles.find(path);
+    if (it != cache.handles.end()) {
+        // opened concurrently by another thread
+        return cache.touch(it->second);
+    }
+    cache.lru.push_front(handle);
+    cache.handles.emplace(path, cache.lru.begin());
+    cache.evict();
+    return handle;
+}
+
+void CgroupHandle::invalidate(const string &path)
+{
+    HandleCache &cache = handleCache();
+    lock_guard<mutex> lck(cache.mut);
+    auto it = cache.handles.find(path);
+    if (it != cache.handles.end()) {
+        cache.lru.erase(it->second);
+        cache.handles.erase(it);
+    }
+}
+
+size_t CgroupHandle::fdBudget()
+{
+    return handleCache().fdBudget;
+}
+
+}   // namespace pc
@@ -0,0 +1,113 @@
+#ifndef CGROUPHANDLE_H
+#define CGROUPHANDLE_H
+
+#include "statscanner.h"
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace pc {
+
+/*!
+ * \class an open cgroup directory
+ *
+ * The directory and the controller interface files used through the
+ * handle are opened once and kept open: each read or write is a single
+ * pread()/pwrite() at offset 0 instead of an open/close pair.
+ * \p
+ * Handles are shared through a cache indexed by the path of the cgroup,
+ * so that the processes in the same cgroup use the same descriptors.
+ * The handle of a cgroup must be invalidated when the cgroup is removed.
+ * \p
+ * The descriptors kept open by all the handles are bounded by fdBudget():
+ * when the budget is exceeded, the least recently used handles are
+ * removed from the cache and their descriptors are closed as soon as
+ * their last user releases them.
+ * \p
+ * The functions are threadsafe.
+ */
+class CgroupHandle {
+    std::string path_;
+    int dirFd_;
+    std::mutex mut_;
+    /*! open interface files, closed by the destructor only */
+    std::unordered_map<std::string, int> fds_;
+
+    /*!
+     * Returns the descriptor of an interface file, opening it on first use
+     * \throws PcException if the file cannot be opened
+     */
+    int fd(const char *fileName);
+
+    [[noreturn]] void throwReadError(const char *fileName) const;
+
+public:
+    /*!
+     * Opens the cgroup directory
+     * \throws PcException if the directory cannot be opened
+     */
+    explicit CgroupHandle(const std::string &path);
+    ~CgroupHandle();
+
+    CgroupHandle(const CgroupHandle &) = delete;
+    CgroupHandle &operator=(const CgroupHandle &) = delete;
+
+    const std::string &path() const noexcept {
+        return path_;
+    }
+
+    /*! Returns true if the interface file exists in the cgroup */
+    bool exists(const char *fileName);
+
+    /*!
+     * Writes a value to an interface file
+     * \throws PcException in case of error
+     */
+    void write(const char *fileName, const std::string &value);
+
+    /*!
+     * Reads the whole content of an interface file
+     * \throws PcException in case of error
+     */
+    std::string read(const char *fileName);
+
+    /*!
+     * Reads an interface file into a fixed buffer, without allocating memory.
+     * The content is truncated at the last line which fits in the buffer.
+     * \returns the content of the file, valid until the next read into buf
+     * \throws PcException in case of error
+     */
+    template <std::size_t Size>
+    std::string_view read(const char *fileName, rmcommon::StatBuffer<Size> &buf) {
+        if (!buf.read(fd(fileName))) {
+            throwReadError(fileName);
+        }
+        return buf.view();
+    }
+
+    /*!
+     * Returns the handle of the cgroup, from the cache if possible
+     * \throws PcException if the directory cannot be opened
+     */
+    static std::shared_ptr<CgroupHandle> get(const std::string &path);
+
+    /*!
+     * Removes the handle of the cgroup from the cache. The descriptors
+     * are closed when the last user of the handle releases it.
+     */
+    static void invalidate(const std::string &path);
+
+    /*!
+     * Returns the number of descriptors the cached handles may keep open:
+     * half of the RLIMIT_NOFILE soft limit when the cache is first used.
+     * The other half is left to the rest of Konro.
+     */
+    static std::size_t fdBudget();
+};
+
+}   // namespace pc
+
+#endif // CGROUPHANDLE_H
@@ -1,12 +1,20 @@
 #include "cgrouputil.h"
 #include "dir.h"
 #include "pcexception.h"
+#include "statscanner.h"
 #include "tsplit.h"
 #include <cstddef>
 #include <cstring>
 #include <log4cpp/Category.hh>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
@@ -17,6 +25,46 @@ using namespace std;
 namespace pc {
 namespace util {
 
+namespace {
+
+/*!
+ * The controllers enabled in the cgroup.subtree_control file of each
+ * directory of the hierarchy, as written or found by Konro
+ */
+struct ActiveControllers {
+  mutex mut;
+  unordered_map<string, set<string>> byDir;
+};
+
+ActiveControllers &activeControllers() {
+  static ActiveControllers active;
+  return active;
+}
+
+bool isRecorded(const char *controllerName, const string &dir) {
+  ActiveControllers &active = activeControllers();
+  lock_guard<mutex> lck(active.mut);
+  auto it = active.byDir.find(dir);
+  return it != active.byDir.end() && it->second.count(controllerName) != 0;
+}
+
+void record(const char *controllerName, const string &dir) {
+  ActiveControllers &active = activeControllers();
+  lock_guard<mutex> lck(active.mut);
+  active.byDir[dir].insert(controllerName);
+}
+
+/*! Returns the parent of a cgroup directory */
+string parentDir(const string &cgroupPath) {
+  size_t end = cgroupPath.find_last_not_of('/');
+  if (end == string::npos)
+    return string();
+  size_t pos = cgroupPath.rfind('/', end);
+  return pos == string::npos ? string() : cgroupPath.substr(0, pos);
+}
+
+} // namespace
+
 std::string getCgroupBaseDir() {
   // return "/sys/fs/cgroup";
   return CGROUPBASEDIR;
@@ -47,6 +95,39 @@ void throwCouldNotWriteToFile(const char *funcName, const string &fileName) {
   throw PcException(os.str());
 }
 
+namespace {
+
+/*!
+ * Calls fn(std::string_view line) for each line of a cgroup file,
+ * reading the file in chunks into a fixed buffer
+ */
+template <typename LineFunction>
+void scanFile(const char *funcName, const char *fileName,
+              const string &cgroupPath, LineFunction fn) {
+  string filePath = rmcommon::make_path(cgroupPath, fileName);
+  int fd = open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throwCouldNotOpenFile(funcName, filePath);
+  }
+  bool ok;
+  try {
+    ok = rmcommon::scanLines<4096>(fd, fn);
+  } catch (...) {
+    close(fd);
+    throw;
+  }
+  int err = errno;
+  close(fd);
+  if (!ok) {
+    ostringstream os;
+    os << funcName << ": could not read file " << filePath << ": "
+       << strerror(err);
+    throw PcException(os.str());
+  }
+}
+
+} // namespace
+
 string findCgroupPath(pid_t pid) {
   ostringstream os;
   os << "/proc/" << pid << "/cgroup";
@@ -70,6 +151,8 @@ string findCgroupPath(pid_t pid) {
  * Hence, to activate control and spawn the desired controller-interface files
  * in the target directory, we must enable the controller of interest up to its
  * parent folder.
+ * The levels where the controller has been enabled are remembered, so each
+ * cgroup.subtree_control file is written at most once per controller.
  */
 void activateController(const char *controllerName, const string &cgroupPath) {
   // For example: cgroupPath = "/sys/fs/cgroup/konro.slice/app-420186.scope/"
@@ -118,6 +201,10 @@ void activateController(const char *controllerName, const string &cgroupPath) {
     } else {
       currentFolder += "/" + subPath[i];
     }
+    if (isRecorded(controllerName, currentFolder)) {
+      // already enabled at this level
+      continue;
+    }
     cat.debug("CGROUPUTIL activateController: currentFolder='%s'",
               currentFolder.c_str());
     string currentFile =
@@ -140,6 +227,7 @@ void activateController(const char *controllerName, const string &cgroupPath) {
       throwCouldNotWriteToFile(__func__, currentFile);
     }
     fileStream.close();
+    record(controllerName, currentFolder);
 #ifdef TIMING
     rmcommon::KonroTimer::TimeUnit usd = timerDetail.Elapsed();
     cat.debug("CGROUPUTIL timing: activateController write in "
@@ -154,6 +242,27 @@ void activateController(const char *controllerName, const string &cgroupPath) {
 #endif
 }
 
+bool isControllerActive(const char *controllerName, const string &cgroupPath) {
+  return isRecorded(controllerName, parentDir(cgroupPath));
+}
+
+void setControllerActive(const char *controllerName, const string &cgroupPath) {
+  record(controllerName, parentDir(cgroupPath));
+}
+
+void forgetControllers(const string &cgroupPath) {
+  ActiveControllers &active = activeControllers();
+  lock_guard<mutex> lck(active.mut);
+  for (auto it = active.byDir.begin(); it != active.byDir.end();) {
+    const string &dir = it->first;
+    if (dir.compare(0, cgroupPath.size(), cgroupPath) == 0 &&
+        (dir.size() == cgroupPath.size() || dir[cgroupPath.size()] == '/'))
+      it = active.byDir.erase(it);
+    else
+      ++it;
+  }
+}
+
 std::string getLine(const char *fileName, const string &cgroupPath) {
   string filePath = rmcommon::make_path(cgroupPath, fileName);
   ifstream in(filePath.c_str());
@@ -167,18 +276,22 @@ std::string getLine(const char *fileName, const string &cgroupPath) {
 
 std::vector<string> getContent(const char *fileName,
                                const std::string &cgroupPath) {
-  string filePath = rmcommon::make_path(cgroupPath, fileName);
-  ifstream in(filePath.c_str());
-  if (!in.is_open()) {
-    throwCouldNotOpenFile(__func__, filePath);
-  }
   vector<string> content;
-  string line;
-  while (getline(in, line))
-    content.push_back(line);
+  scanFile(__func__, fileName, cgroupPath,
+           [&content](string_view line) { content.emplace_back(line); });
   return content;
 }
 
+std::vector<pid_t> getPids(const std::string &cgroupPath) {
+  vector<pid_t> pids;
+  scanFile(__func__, "cgroup.procs", cgroupPath, [&pids](string_view line) {
+    uint64_t pid;
+    if (rmcommon::parseNumber(line, pid) && pid > 0)
+      pids.push_back(static_cast<pid_t>(pid));
+  });
+  return pids;
+}
+
 string createCgroup(string cgroupPath, const std::string &name) {
 #ifdef TIMING
   rmcommon::KonroTimer timer;
@@ -216,5 +329,43 @@ void moveToCgroup(const string &cgroupPath, pid_t pid) {
 #endif
 }
 
+vector<pid_t> moveToCgroup(const string &cgroupPath, const vector<pid_t> &pids) {
+#ifdef TIMING
+  rmcommon::KonroTimer timer;
+#endif
+
+  string filePath = rmcommon::make_path(cgroupPath, "cgroup.procs");
+  int fd = open(filePath.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throwCouldNotOpenFile(__func__, filePath);
+  }
+  vector<pid_t> notMoved;
+  char buf[16];
+  for (pid_t pid : pids) {
+    int len = snprintf(buf, sizeof(buf), "%ld", (long)pid);
+    ssize_t n;
+    do {
+      n = write(fd, buf, static_cast<size_t>(len));
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+      if (errno != ESRCH) {
+        log4cpp::Category::getRoot().warn(
+            "CGROUPUTIL moveToCgroup: could not move PID %ld to %s: %s",
+            (long)pid, cgroupPath.c_str(), strerror(errno));
+      }
+      notMoved.push_back(pid);
+    }
+  }
+  close(fd);
+
+#ifdef TIMING
+  rmcommon::KonroTimer::TimeUnit us = timer.Elapsed();
+  log4cpp::Category::getRoot().debug(
+      "CGROUPUTIL timing: moveToCgroup (%d pids) = %d microseconds",
+      (int)pids.size(), (int)us.count());
+#endif
+  return notMoved;
+}
+
 } // namespace util
 } // namespace pc
@@ -54,6 +54,32 @@ std::string findCgroupPath(pid_t pid);
  */
 void activateController(const char *controllerName, const std::string &cgroupPath);
 
+/*!
+ * Returns true if the controller is known to be enabled for the processes
+ * inside the target directory, without accessing the file system
+ *
+ * \param controllerName the type of controller
+ * \param cgroupPath the target directory
+ */
+bool isControllerActive(const char *controllerName, const std::string &cgroupPath);
+
+/*!
+ * Records that the controller is enabled for the processes inside the
+ * target directory (e.g. by the container runtime)
+ *
+ * \param controllerName the type of controller
+ * \param cgroupPath the target directory
+ */
+void setControllerActive(const char *controllerName, const std::string &cgroupPath);
+
+/*!
+ * Forgets the controllers enabled in a directory and in its descendants,
+ * which must be called when the directory is removed
+ *
+ * \param cgroupPath the removed directory
+ */
+void forgetControllers(const std::string &cgroupPath);
+
 /*!
  * \brief Writes a value to the specified cgroup interface file
  * \param fileName the file to write
@@ -93,6 +119,14 @@ std::string getLine(const char *fileName, const std::string &cgroupPath);
  */
 std::vector<std::string> getContent(const char *fileName, const std::string &cgroupPath);
 
+/*!
+ * \brief Gets the pids of the processes in a cgroup
+ * \note The file cgroup.procs is parsed without building a string per line.
+ * \param cgroupPath the directory of the cgroup
+ * \returns the pids listed in cgroup.procs
+ */
+std::vector<pid_t> getPids(const std::string &cgroupPath);
+
 /*!
  * \brief Creates a new cgroup
  * \param cgroupPath the parent directory to the new cgroup
@@ -108,6 +142,20 @@ std::string createCgroup(std::string cgroupPath, const std::string &name);
  */
 void moveToCgroup(const std::string &cgroupPath, pid_t pid);
 
+/*!
+ * \brief Moves a group of processes to the specified cgroup directory
+ *
+ * cgroup.procs is opened once and each pid is written with its own
+ * write(), as the kernel accepts only one pid per write.
+ * Processes which have already terminated are skipped.
+ *
+ * \param cgroupPath the cgroup directory where to move the processes
+ * \param pids the pids of the processes to move
+ * \returns the pids of the processes which were not moved
+ */
+std::vector<pid_t> moveToCgroup(const std::string &cgroupPath,
+                                const std::vector<pid_t> &pids);
+
 }   // namespace util
 }   // namespace pc
 
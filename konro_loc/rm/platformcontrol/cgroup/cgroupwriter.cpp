@@ -0,0 +1,113 @@
+#include "cgroupwriter.h"
+#include <exception>
+#include <log4cpp/Category.hh>
+
+using namespace std;
+
+namespace pc {
+
+namespace {
+
+struct Histograms {
+    rmcommon::LatencyHistogram &queue;
+    rmcommon::LatencyHistogram &apply;
+    rmcommon::LatencyHistogram &error;
+};
+
+Histograms &histograms()
+{
+    static Histograms h {
+        rmcommon::LatencyStats::instance().histogram("CGROUPWRITER", "job", "queue"),
+        rmcommon::LatencyStats::instance().histogram("CGROUPWRITER", "job", "apply"),
+        rmcommon::LatencyStats::instance().histogram("CGROUPWRITER", "job", "error")
+    };
+    return h;
+}
+
+}   // namespace
+
+void CgroupWriter::Worker::apply(Job &job)
+{
+    Histograms &h = histograms();
+    rmcommon::KonroTimer::TimePoint start = rmcommon::KonroTimer::now();
+    h.queue.record(rmcommon::KonroTimer::ElapsedFrom(job.submitted));
+    try {
+        job.run();
+        h.apply.record(rmcommon::KonroTimer::ElapsedFrom(start));
+        job.done.set_value();
+    } catch (exception &e) {
+        h.error.record(rmcommon::KonroTimer::ElapsedFrom(start));
+        log4cpp::Category::getRoot().warn("CGROUPWRITER %s", e.what());
+        job.done.set_exception(current_exception());
+    } catch (...) {
+        h.error.record(rmcommon::KonroTimer::ElapsedFrom(start));
+        job.done.set_exception(current_exception());
+    }
+}
+
+void CgroupWriter::Worker::run()
+{
+    setThreadName("CGROUPWRITER");
+    vector<Job> batch;
+    while (!stopped()) {
+        queue_.waitAndDrain(batch);
+        for (Job &job: batch) {
+            apply(job);
+        }
+        batch.clear();
+    }
+    // the jobs submitted before stop() are run anyway
+    queue_.drain(batch);
+    for (Job &job: batch) {
+        apply(job);
+    }
+}
+
+void CgroupWriter::Worker::stop()
+{
+    BaseThread::stop();
+    queue_.interrupt();
+}
+
+CgroupWriter::CgroupWriter()
+{
+    // the histograms must outlive the workers
+    histograms();
+    for (size_t i = 0; i < NUM_WORKERS; ++i) {
+        workers_.push_back(make_unique<Worker>());
+        workers_.back()->start();
+    }
+}
+
+CgroupWriter::~CgroupWriter()
+{
+    stop();
+}
+
+CgroupWriter &CgroupWriter::instance()
+{
+    static CgroupWriter writer;
+    return writer;
+}
+
+future<void> CgroupWriter::submit(const string &cgroupDir, function<void()> job)
+{
+    Job j;
+    j.run = std::move(job);
+    j.submitted = rmcommon::KonroTimer::now();
+    future<void> result = j.done.get_future();
+    workers_[hash<string>()(cgroupDir) % workers_.size()]->push(std::move(j));
+    return result;
+}
+
+void CgroupWriter::stop()
+{
+    for (auto &worker: workers_) {
+        worker->stop();
+    }
+    for (auto &worker: workers_) {
+        worker->join();
+    }
+}
+
+}   // namespace pc
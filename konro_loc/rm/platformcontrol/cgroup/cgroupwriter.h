@@ -0,0 +1,91 @@
+#ifndef CGROUPWRITER_H
+#define CGROUPWRITER_H
+
+#include "basethread.h"
+#include "latencystats.h"
+#include "mpscqueue.h"
+#include "timer.h"
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pc {
+
+/*!
+ * \class applies cgroup writes outside the thread which decides them
+ *
+ * A write to a cgroup file may take long, e.g. a change of cpuset.cpus
+ * makes the kernel migrate all the tasks of the cgroup. The PolicyManager
+ * submits its writes to the CgroupWriter, which applies them in a small
+ * pool of worker threads, and receives a future which is ready when the
+ * writes have been applied (or holds the exception if one of them failed).
+ * \p
+ * A job is a batch of writes to the same cgroup, e.g. the commit of an
+ * AppMapping::Transaction. The jobs for the same cgroup are always run by
+ * the same worker, in the order they were submitted, so the writes of a
+ * cgroup are never reordered. A worker drains all its pending jobs at once.
+ * \p
+ * The latencies are in LatencyStats under the component "CGROUPWRITER":
+ * time spent in the queue ("queue"), time to run the job ("apply") and
+ * time of the jobs which failed ("error"). The latency and the errors of
+ * each write are recorded by CGroupControl::setValue.
+ */
+class CgroupWriter {
+    struct Job {
+        std::function<void()> run;
+        std::promise<void> done;
+        rmcommon::KonroTimer::TimePoint submitted;
+    };
+
+    class Worker : public rmcommon::BaseThread {
+        rmcommon::MpscQueue<Job, 256> queue_;
+
+        void apply(Job &job);
+
+        /*! The thread function */
+        virtual void run() override;
+
+    public:
+        void push(Job job) {
+            queue_.push(std::move(job));
+        }
+
+        virtual void stop() override;
+    };
+
+    static constexpr std::size_t NUM_WORKERS = 2;
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    CgroupWriter();
+
+public:
+    static CgroupWriter &instance();
+
+    ~CgroupWriter();
+
+    CgroupWriter(const CgroupWriter &) = delete;
+    CgroupWriter &operator=(const CgroupWriter &) = delete;
+
+    /*!
+     * Runs a job in the worker of a cgroup. Threadsafe.
+     *
+     * \param cgroupDir the cgroup written by the job
+     * \param job the function which writes the cgroup files
+     * \returns a future which is ready when the job has been run
+     */
+    std::future<void> submit(const std::string &cgroupDir, std::function<void()> job);
+
+    /*!
+     * Stops the workers after they have run the pending jobs.
+     * The jobs submitted afterwards are never run.
+     */
+    void stop();
+};
+
+}   // namespace pc
+
+#endif // CGROUPWRITER_H
@@ -31,7 +31,8 @@ void CpuControl::setMax(rmcommon::NumericValue percentage, std::shared_ptr<rmcom
     } else {
         os << ((percentage * period_) / 100) << ' ' << period_;
     }
-    setValue(controllerName_, fileNamesMap_.at(MAX), os.str(), app);
+    static const WriteLatency latency(fileNamesMap_.at(MAX));
+    setValue(controllerName_, fileNamesMap_.at(MAX), os.str(), app, latency);
 }
 
 rmcommon::NumericValue CpuControl::getMax(std::shared_ptr<rmcommon::App> app)
@@ -56,9 +57,16 @@ std::map<std::string, uint64_t> CpuControl::getStat(std::shared_ptr<rmcommon::Ap
     return getContentAsMap(controllerName_, fileNamesMap_.at(STAT), app);
 }
 
+bool CpuControl::getStat(std::shared_ptr<rmcommon::App> app, rmcommon::CgroupCpuStat &stat)
+{
+    rmcommon::StatBuffer<1024> buf;
+    return rmcommon::parseCpuStat(readContent(controllerName_, fileNamesMap_.at(STAT), app, buf), stat);
+}
+
 void CpuControl::setWeight(int weight, std::shared_ptr<rmcommon::App> app)
 {
-    setValue(controllerName_, fileNamesMap_.at(WEIGHT), weight, app);
+    static const WriteLatency latency(fileNamesMap_.at(WEIGHT));
+    setValue(controllerName_, fileNamesMap_.at(WEIGHT), weight, app, latency);
 }
 
 
@@ -2,6 +2,7 @@
 #define CPUCONTROL_H
 
 #include "numericvalue.h"
+#include "statscanner.h"
 #include "../cgroupcontrol.h"
 #include "../icpucontrol.h"
 #include <string>
@@ -58,6 +59,17 @@ public:
      */
     std::map<std::string, uint64_t> getStat(std::shared_ptr<rmcommon::App> app);
 
+    /*!
+     * Gets the cpu time statistics for the specified application
+     * without allocating memory.
+     *
+     * \param app the application of interest
+     * \param stat receives the statistics
+     * \returns false if the format of cpu.stat is invalid
+     * \throws PcException if cpu.stat cannot be read
+     */
+    bool getStat(std::shared_ptr<rmcommon::App> app, rmcommon::CgroupCpuStat &stat);
+
     /*!
      * Sets a proportional cpu bandwidth limit for the specified application.
      *
@@ -67,7 +67,8 @@ void CpusetControl::setCpus(const std::vector<std::pair<short, short>> &cpus, st
         if (cpus[i].second != cpus[i].first)
             os << '-' << cpus[i].second;
     }
-    setValue(controllerName_, fileNamesMap_.at(CPUS), os.str(), app);
+    static const WriteLatency latency(fileNamesMap_.at(CPUS));
+    setValue(controllerName_, fileNamesMap_.at(CPUS), os.str(), app, latency);
 }
 
 std::vector<std::pair<short, short>> CpusetControl::getCpus(std::shared_ptr<rmcommon::App> app)
@@ -92,7 +93,8 @@ void CpusetControl::setMems(const std::vector<std::pair<short, short> > &memNode
         if (memNodes[i].second != memNodes[i].first)
             os << '-' << memNodes[i].second;
     }
-    setValue(controllerName_, fileNamesMap_.at(MEMS), os.str(), app);
+    static const WriteLatency latency(fileNamesMap_.at(MEMS));
+    setValue(controllerName_, fileNamesMap_.at(MEMS), os.str(), app, latency);
 }
 
 std::vector<std::pair<short, short> > CpusetControl::getMems(std::shared_ptr<rmcommon::App> app)
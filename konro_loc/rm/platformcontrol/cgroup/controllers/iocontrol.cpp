@@ -1,7 +1,5 @@
 #include "iocontrol.h"
-#include "tsplit.h"
 #include "../utilities/keyvalueparser.h"
-#include <vector>
 #include <sstream>
 #include <iostream>
 
@@ -28,16 +26,23 @@ const map<IOControl::IoMax, const char *> IOControl::keyNames_ = {
 
 std::map<string, rmcommon::NumericValue> IOControl::getIOHelper(ControllerFile cf, int major, int minor, std::shared_ptr<rmcommon::App> app)
 {
-    vector<string> lines = getContent(controllerName_, fileNamesMap_.at(cf), app);
+    rmcommon::StatBuffer<8192> buf;
+    rmcommon::StatScanner sc(readContent(controllerName_, fileNamesMap_.at(cf), app, buf));
     map<string, rmcommon::NumericValue> tags;
-    for (auto &line: lines) {
-        tags = KeyValueParser().parseLineNv(line, major, minor);
+    while (sc.nextLine()) {
+        tags = KeyValueParser().parseLineNv(sc.rest(), major, minor);
         if (!tags.empty())
             break;
     }
     return tags;
 }
 
+bool IOControl::getStat(int major, int minor, std::shared_ptr<rmcommon::App> app, rmcommon::CgroupIoStat &stat)
+{
+    rmcommon::StatBuffer<8192> buf;
+    return rmcommon::parseIoStat(readContent(controllerName_, fileNamesMap_.at(STAT), app, buf), major, minor, stat);
+}
+
 IOControl &IOControl::instance()
 {
     static IOControl ioc;
@@ -48,7 +53,8 @@ void IOControl::setMax(int major, int minor, IoMax ioMax, rmcommon::NumericValue
 {
     ostringstream os;
     os << major << ':' << minor << ' ' << keyNames_.at(ioMax) << '=' << value;;
-    setValue(controllerName_, fileNamesMap_.at(MAX), os.str(), app);
+    static const WriteLatency latency(fileNamesMap_.at(MAX));
+    setValue(controllerName_, fileNamesMap_.at(MAX), os.str(), app, latency);
 }
 
 }   // namespace pc
@@ -2,6 +2,7 @@
 #define IOCONTROL_H
 
 #include "numericvalue.h"
+#include "statscanner.h"
 #include "../cgroupcontrol.h"
 #include "../iiocontrol.h"
 #include <string>
@@ -60,6 +61,19 @@ public:
         return getIOHelper(STAT, major, minor, app);
     }
 
+    /*!
+     * Gets the IO usage statistics of a device for the specified application
+     * without allocating memory.
+     *
+     * \param major the device major number
+     * \param minor the device minor number
+     * \param app the application of interest
+     * \param stat receives the statistics
+     * \returns false if io.stat has no valid line for the device
+     * \throws PcException if io.stat cannot be read
+     */
+    bool getStat(int major, int minor, std::shared_ptr<rmcommon::App> app, rmcommon::CgroupIoStat &stat);
+
     /*!
      * Sets an IO limit for the specified device and application.
      *
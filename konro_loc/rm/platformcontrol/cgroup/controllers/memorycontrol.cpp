@@ -27,7 +27,8 @@ int MemoryControl::getCurrent(std::shared_ptr<rmcommon::App> app)
 
 void MemoryControl::setMin(int minMem, std::shared_ptr<rmcommon::App> app)
 {
-    setValue(controllerName_, fileNamesMap_.at(MIN), minMem, app);
+    static const WriteLatency latency(fileNamesMap_.at(MIN));
+    setValue(controllerName_, fileNamesMap_.at(MIN), minMem, app, latency);
 }
 
 int MemoryControl::getMin(std::shared_ptr<rmcommon::App> app)
@@ -37,7 +38,8 @@ int MemoryControl::getMin(std::shared_ptr<rmcommon::App> app)
 
 void MemoryControl::setMax(rmcommon::NumericValue maxMem, std::shared_ptr<rmcommon::App> app)
 {
-    setValue(controllerName_, fileNamesMap_.at(MAX), maxMem, app);
+    static const WriteLatency latency(fileNamesMap_.at(MAX));
+    setValue(controllerName_, fileNamesMap_.at(MAX), maxMem, app, latency);
 }
 
 rmcommon::NumericValue MemoryControl::getMax(std::shared_ptr<rmcommon::App> app)
@@ -55,4 +57,10 @@ std::map<std::string, uint64_t> MemoryControl::getStat(std::shared_ptr<rmcommon:
     return getContentAsMap(controllerName_, fileNamesMap_.at(STAT), app);
 }
 
+bool MemoryControl::getStat(std::shared_ptr<rmcommon::App> app, rmcommon::CgroupMemoryStat &stat)
+{
+    rmcommon::StatBuffer<8192> buf;
+    return rmcommon::parseMemoryStat(readContent(controllerName_, fileNamesMap_.at(STAT), app, buf), stat);
+}
+
 }   // namespace pc
@@ -2,6 +2,7 @@
 #define MEMORYCONTROL_H
 
 #include "numericvalue.h"
+#include "statscanner.h"
 #include "../cgroupcontrol.h"
 #include "../imemorycontrol.h"
 #include <string>
@@ -109,6 +110,17 @@ public:
      */
     std::map<std::string, uint64_t> getStat(std::shared_ptr<rmcommon::App> app);
 
+    /*!
+     * Gets the main memory statistics for the specified application
+     * without allocating memory.
+     *
+     * \param app the application of interest
+     * \param stat receives the statistics
+     * \returns false if the format of memory.stat is invalid
+     * \throws PcException if memory.stat cannot be read
+     */
+    bool getStat(std::shared_ptr<rmcommon::App> app, rmcommon::CgroupMemoryStat &stat);
+
 };
 
 }   // namespace pc
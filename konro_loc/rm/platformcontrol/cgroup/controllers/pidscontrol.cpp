@@ -20,7 +20,8 @@ PidsControl &PidsControl::instance()
 
 void PidsControl::setMax(rmcommon::NumericValue numPids, std::shared_ptr<rmcommon::App> app)
 {
-    setValue(controllerName_, fileNamesMap_.at(MAX), numPids, app);
+    static const WriteLatency latency(fileNamesMap_.at(MAX));
+    setValue(controllerName_, fileNamesMap_.at(MAX), numPids, app, latency);
 }
 
 rmcommon::NumericValue PidsControl::getMax(std::shared_ptr<rmcommon::App> app)
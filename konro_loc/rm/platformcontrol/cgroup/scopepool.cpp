@@ -0,0 +1,85 @@
+#include "scopepool.h"
+#include "dir.h"
+#include <stdexcept>
+
+using namespace std;
+
+namespace pc {
+
+ScopePool::ScopePool(size_t size, function<string()> makeScope) :
+    cat_(log4cpp::Category::getRoot()),
+    size_(size),
+    makeScope_(std::move(makeScope))
+{
+}
+
+void ScopePool::stop()
+{
+    BaseThread::stop();
+    refillWakeup_.notify();
+}
+
+string ScopePool::take()
+{
+    string scope;
+    {
+        lock_guard<mutex> lck(mut_);
+        if (scopes_.empty()) {
+            return scope;
+        }
+        scope = std::move(scopes_.front());
+        scopes_.pop_front();
+    }
+    refillWakeup_.notify();
+    return scope;
+}
+
+void ScopePool::fill()
+{
+    for (;;) {
+        {
+            lock_guard<mutex> lck(mut_);
+            if (scopes_.size() >= size_) {
+                return;
+            }
+        }
+        // the cgroup is created without holding the lock
+        string scope = makeScope_();
+        if (scope.empty()) {
+            // retried when the next cgroup is taken
+            return;
+        }
+        lock_guard<mutex> lck(mut_);
+        scopes_.push_back(std::move(scope));
+    }
+}
+
+void ScopePool::drain()
+{
+    deque<string> scopes;
+    {
+        lock_guard<mutex> lck(mut_);
+        scopes.swap(scopes_);
+    }
+    for (const string &scope: scopes) {
+        try {
+            rmcommon::Dir::rmdir(scope.c_str());
+        } catch (runtime_error &e) {
+            cat_.error("SCOPEPOOL %s", e.what());
+        }
+    }
+}
+
+void ScopePool::run()
+{
+    setThreadName("SCOPEPOOL");
+    cat_.info("SCOPEPOOL thread starting (size %lu)", (unsigned long)size_);
+    while (!stopped()) {
+        fill();
+        refillWakeup_.wait();
+    }
+    drain();
+    cat_.info("SCOPEPOOL thread exiting");
+}
+
+}   // namespace pc
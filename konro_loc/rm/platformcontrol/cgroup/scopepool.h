@@ -0,0 +1,66 @@
+#ifndef SCOPEPOOL_H
+#define SCOPEPOOL_H
+
+#include "basethread.h"
+#include "wakeup.h"
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <log4cpp/Category.hh>
+
+namespace pc {
+
+/*!
+ * \class a pool of empty cgroups ready to receive an application
+ *
+ * Creating a cgroup and enabling its controllers takes most of the time
+ * needed to add an application. The pool keeps a few cgroups created in
+ * advance by its own thread, so that adding an application only needs
+ * the write of its pid to cgroup.procs. The thread creates a new cgroup
+ * each time one is taken.
+ * \p
+ * cgroup v2 directories cannot be renamed, so a cgroup keeps its pool
+ * name after it has been assigned to an application.
+ * \p
+ * The cgroups still in the pool are removed when the thread stops.
+ */
+class ScopePool : public rmcommon::BaseThread {
+    log4cpp::Category &cat_;
+    std::size_t size_;
+    /*! creates a new cgroup and returns its path, or an empty string */
+    std::function<std::string()> makeScope_;
+    std::mutex mut_;
+    std::deque<std::string> scopes_;
+    rmcommon::Wakeup refillWakeup_;
+
+    /*! Creates cgroups until the pool is full */
+    void fill();
+
+    /*! Removes the cgroups left in the pool */
+    void drain();
+
+    /*! The thread function */
+    virtual void run() override;
+
+public:
+    /*!
+     * \param size the number of cgroups kept in the pool
+     * \param makeScope the function which creates a cgroup
+     */
+    ScopePool(std::size_t size, std::function<std::string()> makeScope);
+
+    virtual void stop() override;
+
+    /*!
+     * Takes a cgroup from the pool. Threadsafe.
+     *
+     * \returns the path of the cgroup, or an empty string if the pool is empty
+     */
+    std::string take();
+};
+
+}   // namespace pc
+
+#endif // SCOPEPOOL_H
@@ -1,6 +1,7 @@
 #include "cpusetcontrol.h"
 #include "app.h"
 #include "cpuguard.h"
+#include "latencystats.h"
 #include <dlb.h>
 #include <dlb_drom.h>
 #include <dlb_errors.h>
@@ -70,6 +71,10 @@ CPUGuard DromCpusetControl::reserveCpus(std::shared_ptr<rmcommon::App> app,
 void DromCpusetControl::DromCpusetControl::setCpus(
     const std::vector<std::pair<short, short>> &cpus,
     std::shared_ptr<rmcommon::App> app) {
+  static rmcommon::LatencyHistogram &histogram =
+      rmcommon::LatencyStats::instance().histogram("DROMCONTROL", "setCpus",
+                                                   "apply");
+  rmcommon::ScopedLatency latency(histogram);
   cat_.debug("Calling %s with cpus size %i", __FUNCTION__, cpus.size());
   auto pid = app->getPid();
   cpu_set_t cpusetp;
@@ -2,6 +2,10 @@
 #define IPLATFORMCONTROL_H
 
 #include "app.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
 
 namespace pc {
 
@@ -11,17 +15,97 @@ namespace pc {
 class IPlatformControl {
 public:
 
+    /*!
+     * \brief A group of processes left under the management of Konro
+     *        by a previous execution
+     */
+    struct RecoveredGroup {
+        /*! the control group of the processes */
+        std::string cgroupDir;
+        /*! the pid of the application for which the group was created */
+        pid_t pid;
+        /*! the live processes in the group */
+        std::vector<pid_t> pids;
+    };
+
     /*!
      * \brief Adds an application under the management of Konro.
      * \param app the application to manage
      */
     virtual bool addApplication(std::shared_ptr<rmcommon::App> app) = 0;
 
+    /*!
+     * \brief Adds an application and the processes of its tree, which
+     *        are managed together with it.
+     *
+     * The default implementation adds each process on its own.
+     *
+     * \param app the root of the tree
+     * \param members the other processes of the tree
+     * \return false if the root could not be added; members which
+     *         could not be added are removed from "members"
+     */
+    virtual bool addApplicationTree(std::shared_ptr<rmcommon::App> app,
+                                    std::vector<std::shared_ptr<rmcommon::App>> &members) {
+        if (!addApplication(app))
+            return false;
+        std::vector<std::shared_ptr<rmcommon::App>> added;
+        for (auto &member: members) {
+            if (addApplication(member))
+                added.push_back(member);
+        }
+        members.swap(added);
+        return true;
+    }
+
     /*!
      * \brief Removes an application from the management of Konro.
      * \param app the application to remove from Konro's management
      */
     virtual bool removeApplication(std::shared_ptr<rmcommon::App> app) = 0;
+
+    /*!
+     * \brief Returns the pids of the processes which share the control
+     *        group of the application (e.g. children forked while Konro
+     *        was not receiving events).
+     *
+     * The default implementation returns an empty vector, meaning that
+     * the platform does not group the processes of an application.
+     *
+     * \param app the application of interest
+     */
+    virtual std::vector<pid_t> getApplicationPids([[maybe_unused]] std::shared_ptr<rmcommon::App> app) {
+        return {};
+    }
+
+    /*!
+     * \brief Prepares an empty control group for an application which
+     *        has not been started yet.
+     *
+     * A launcher creates the application directly inside the group
+     * (e.g. with clone3() and CLONE_INTO_CGROUP), then sends an add
+     * request: addApplication() finds the process in the reserved group
+     * and adopts the group instead of creating a new one.
+     *
+     * The default implementation returns an empty string, meaning that
+     * reservations are not supported.
+     *
+     * \return the path of the group
+     */
+    virtual std::string reserveApplicationGroup() {
+        return std::string();
+    }
+
+    /*!
+     * \brief Returns the groups of processes which were managed by a
+     *        previous execution of Konro and are still alive, so that
+     *        they can be managed again without changing their resources.
+     *
+     * The default implementation returns an empty vector.
+     */
+    virtual std::vector<RecoveredGroup> recoverApplications() {
+        return {};
+    }
 };
 
 }
@@ -1,29 +1,36 @@
 #include "keyvalueparser.h"
+#include "statscanner.h"
 #include <stdexcept>
 #include <cctype>
-#include <cstdlib>
+#include <charconv>
 
 using namespace std;
 
-static inline const char *findTokenEnd(const char *pStart)
+static inline const char *findTokenEnd(const char *pStart, const char *pEnd)
 {
-    while (isalnum(*pStart)) {
+    while (pStart < pEnd && isalnum(static_cast<unsigned char>(*pStart))) {
         ++pStart;
     }
     return pStart;
 }
 
+static inline bool isDigit(const char *ptr, const char *end)
+{
+    return ptr < end && isdigit(static_cast<unsigned char>(*ptr));
+}
+
 namespace pc {
 
 bool KeyValueParser::parseMajorMinor(int major, int minor)
 {
-    if (!isdigit(*ptr_))
+    if (!isDigit(ptr_, end_))
         throw runtime_error("Invalid line: digit expected for major");
 
     // Parse major device number
 
-    int devMajor = strtol(ptr_, (char **)&endptr_, 10);
-    if (*endptr_ != ':')
+    int devMajor = 0;
+    endptr_ = from_chars(ptr_, end_, devMajor).ptr;
+    if (endptr_ == end_ || *endptr_ != ':')
         throw runtime_error("Invalid line: ':' expected after major");
     if (devMajor != major)
         return false;         // not the device we are looking for
@@ -31,10 +38,11 @@ bool KeyValueParser::parseMajorMinor(int major, int minor)
     // Parse minor device number
 
     ptr_ = endptr_ + 1;
-    if (!isdigit(*ptr_))
+    if (!isDigit(ptr_, end_))
         throw runtime_error("Invalid line: digit expected for minor");
 
-    int devMinor = strtol(ptr_, (char **)&endptr_, 10);
+    int devMinor = 0;
+    endptr_ = from_chars(ptr_, end_, devMinor).ptr;
     if (devMinor != minor)
         return false;
 
@@ -45,11 +53,11 @@ pair<string, rmcommon::NumericValue> KeyValueParser::parseKeyValue()
 {
     // parse the tag
 
-    endptr_ = findTokenEnd(ptr_);
+    endptr_ = findTokenEnd(ptr_, end_);
     if (endptr_ == ptr_) {
         throw runtime_error("Invalid line: alpha character expected for tag");
     }
-    if (*endptr_ != '=' && *endptr_ != ':') {
+    if (endptr_ == end_ || (*endptr_ != '=' && *endptr_ != ':')) {
         throw runtime_error("Invalid line: '=' or ':' expected after tag");
     }
     string tag(ptr_, endptr_);
@@ -57,42 +65,51 @@ pair<string, rmcommon::NumericValue> KeyValueParser::parseKeyValue()
 
     // parse the value
 
-    endptr_ = findTokenEnd(ptr_);
+    endptr_ = findTokenEnd(ptr_, end_);
     if (endptr_ == ptr_) {
         throw runtime_error("Invalid line: alphanumeric character expected for value");
     }
 
-    rmcommon::NumericValue val(ptr_, endptr_);
+    string_view sval(ptr_, endptr_ - ptr_);
+    rmcommon::NumericValue val;
+    uint64_t n;
+    if (sval == "max") {
+        val.setMax();
+    } else if (rmcommon::parseNumber(sval, n)) {
+        val.set(n);
+    }
     if (val.isInvalid())
         throw runtime_error("Invalid line: invalid numeric value");
     return make_pair<>(tag, val);
 }
 
-map<string, rmcommon::NumericValue> KeyValueParser::parseLineNv(const char *line, int major, int minor)
+map<string, rmcommon::NumericValue> KeyValueParser::parseLineNv(string_view line, int major, int minor)
 {
-    ptr_ = line;
-    if (!parseMajorMinor(major, minor) || *endptr_ == '\0')
+    ptr_ = line.data();
+    end_ = ptr_ + line.size();
+    if (!parseMajorMinor(major, minor) || endptr_ == end_)
         return map<string, rmcommon::NumericValue>();         // not the device we are looking for or no tags
 
     if (*endptr_ != ' ')
         throw runtime_error("Invalid line: space expected after minor");
 
-    return parseLineNv(endptr_ + 1);
+    return parseLineNv(string_view(endptr_ + 1, end_ - endptr_ - 1));
 }
 
-map<string, rmcommon::NumericValue> KeyValueParser::parseLineNv(const char *line)
+map<string, rmcommon::NumericValue> KeyValueParser::parseLineNv(string_view line)
 {
     map<string, rmcommon::NumericValue> tags;
 
-    ptr_ = line;
-    while (*ptr_) {
+    ptr_ = line.data();
+    end_ = ptr_ + line.size();
+    while (ptr_ < end_) {
         tags.insert(parseKeyValue());
         ptr_ = endptr_;
-        if (*ptr_) {
+        if (ptr_ < end_) {
             if (*ptr_ != ' ')
                 throw runtime_error("Invalid line: expected space character after value");
             ++ptr_;
-            if (!*ptr_)
+            if (ptr_ == end_)
                 throw runtime_error("Invalid line: expected new tag after last value");
         }
     }
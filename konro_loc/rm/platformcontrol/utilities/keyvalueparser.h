@@ -3,6 +3,7 @@
 
 #include "numericvalue.h"
 #include <string>
+#include <string_view>
 #include <map>
 #include <utility>
 
@@ -24,7 +25,7 @@ namespace pc {
  * \endcode
  */
 class KeyValueParser {
-    const char *ptr_, *endptr_;
+    const char *ptr_, *endptr_, *end_;
 
     /*!
      * \brief Parses a line in the format "major:minor ..."
@@ -57,10 +58,7 @@ public:
      * \return map of key and values
      * \exception PcException if the format of the line is invalid
      */
-    std::map<std::string, rmcommon::NumericValue> parseLineNv(const char *line);
-    std::map<std::string, rmcommon::NumericValue> parseLineNv(const std::string &line) {
-        return parseLineNv(line.c_str());
-    }
+    std::map<std::string, rmcommon::NumericValue> parseLineNv(std::string_view line);
 
     /*!
      * Parses a line in the format
@@ -77,10 +75,7 @@ public:
      *         numbers, the map is empty
      * \throws PcException if the format of the line is invalid
      */
-    std::map<std::string, rmcommon::NumericValue> parseLineNv(const char *line, int major, int minor);
-    std::map<std::string, rmcommon::NumericValue> parseLineNv(const std::string &line, int major, int minor) {
-        return parseLineNv(line.c_str(), major, minor);
-    }
+    std::map<std::string, rmcommon::NumericValue> parseLineNv(std::string_view line, int major, int minor);
 
     /*!
      * Parses a single key-value pair, such as key=value or key:value
@@ -88,13 +83,11 @@ public:
      * \returns the key-value pair
      * \throws PcException in case of format error
      */
-    std::pair<std::string, rmcommon::NumericValue> parseKeyValue(const char *line) {
-        ptr_ = line;
+    std::pair<std::string, rmcommon::NumericValue> parseKeyValue(std::string_view line) {
+        ptr_ = line.data();
+        end_ = ptr_ + line.size();
         return parseKeyValue();
     }
-    std::pair<std::string, rmcommon::NumericValue> parseKeyValue(const std::string &line) {
-        return parseKeyValue(line.c_str());
-    }
 };
 
 }   // namespace pc
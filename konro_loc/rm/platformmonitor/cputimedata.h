@@ -1,6 +1,7 @@
 #ifndef CPUTIMEDATA_H
 #define CPUTIMEDATA_H
 
+#include "statscanner.h"
 #include <iostream>
 #include <string>
 #include <cinttypes>
@@ -74,6 +75,28 @@ struct CPUTimeData {
         totaltime = usertime + nicetime + systemtime + irq + softIrq + idletime + ioWait + steal + guest + guestnice;
     }
 
+    explicit CPUTimeData(const rmcommon::ProcStatCpu &pc) :
+        name(pc.cpu < 0 ? std::string("cpu") : "cpu" + std::to_string(pc.cpu)) {
+        update(pc);
+    }
+
+    /*!
+     * Sets the times to those of a new sample of the same CPU
+     */
+    void update(const rmcommon::ProcStatCpu &pc) {
+        usertime = pc.user - pc.guest;
+        nicetime = pc.nice - pc.guest_nice;
+        systemtime = pc.system;
+        idletime = pc.idle;
+        ioWait = pc.iowait;
+        irq = pc.irq;
+        softIrq = pc.softirq;
+        steal = pc.steal;
+        guest = pc.guest;
+        guestnice = pc.guest_nice;
+        totaltime = usertime + nicetime + systemtime + irq + softIrq + idletime + ioWait + steal + guest + guestnice;
+    }
+
     friend std::ostream &operator <<(std::ostream &os, const CPUTimeData &ctd) {
         os << '{'
            << "\"name\":" << '"' << ctd.name << '"'
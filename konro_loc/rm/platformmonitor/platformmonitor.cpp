@@ -2,10 +2,12 @@
 #include <chrono>
 #include <vector>
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <cstring>
 #include <algorithm>
+#include <memory>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 #include <sensors.h>
 #include "componenttemperature.h"
 #include "monitorevent.h"
@@ -15,22 +17,34 @@
 #include "threadname.h"
 #include "tsplit.h"
 #include "cputimedata.h"
+#include "statscanner.h"
 
 using namespace std;
 
 struct PlatformMonitor::PlatformMonitorImpl {
+    /*! enough for the "cpu" lines of about 1500 processing units */
+    static constexpr size_t PROC_STAT_BUFFER_SIZE = 128 * 1024;
+
     PlatformDescription pd_;
     bool initialized = false;
     vector<string> cpuChips;
     vector<string> batteryChips;
     vector<CPUTimeData> cpuTimeData;
+    // /proc/stat is kept open and read into the same buffer at each sample
+    int procStatFd = -1;
+    unique_ptr<rmcommon::StatBuffer<PROC_STAT_BUFFER_SIZE>> procStat;
+    vector<rmcommon::ProcStatCpu> procStatCpus;
 
-    PlatformMonitorImpl(PlatformDescription pd) : pd_(pd) {
+    PlatformMonitorImpl(PlatformDescription pd) :
+        pd_(pd),
+        procStat(make_unique<rmcommon::StatBuffer<PROC_STAT_BUFFER_SIZE>>()) {
         init();
     }
 
     ~PlatformMonitorImpl() {
         fini();
+        if (procStatFd >= 0)
+            close(procStatFd);
     }
 
     void init() {
@@ -195,63 +209,52 @@ struct PlatformMonitor::PlatformMonitorImpl {
     }
 
     void handleCpuTimes(rmcommon::PlatformLoad &platLoad) {
-        ifstream ifs("/proc/stat");
-        bool firstRead = cpuTimeData.empty();
-        int numPu = pd_.getNumProcessingUnits();
-        log4cpp::Category::getRoot().debug("PLATFORMMONITOR reading CPU time data for %d processing units", numPu);
-        for (int n = 0; n <= numPu; ++n) {
-            string line;
-            if (!getline(ifs, line)) {
-                log4cpp::Category::getRoot().error("PLATFORMMONITOR Could not read line");
-                break;
-            }
-            if (line.size() < 4 || line[0] != 'c' || line[1] !='p' || line[2] != 'u') {
-                log4cpp::Category::getRoot().error("PLATFORMMONITOR Unexpected line '%s' (expected \"cpu\")", line.c_str());
-                break;
-            }
-
-            {
-                istringstream is(line);
-                string name;
-                uint64_t usertime, nicetime, systemtime, idletime, ioWait, irq, softIrq, steal, guest, guestnice;
-                is >> name >> usertime >> nicetime >> systemtime >> idletime >> ioWait >> irq >> softIrq >> steal >> guest >> guestnice;
-                if (is.fail()) {
-                    log4cpp::Category::getRoot().error("PLATFORMMONITOR Could not parse line");
-                    break;
-                }
-
-                CPUTimeData ctd(name, usertime, nicetime, systemtime, idletime, ioWait, irq, softIrq, steal, guest, guestnice);
-                if (firstRead) {
-                    // first time we read
-                    // we only have one snapshot of the cpu status, so we can't compute usage yet
-                    cpuTimeData.push_back(ctd);
-                } else {
-                    // time elapsed between the last two snapshots, measured in USER_HZ
-                    int delta = ctd.totaltime - cpuTimeData[n].totaltime;
-                    // time spent in idle between the last two snapshots, measured in USER_HZ
-                    int idletime = ctd.idletime - cpuTimeData[n].idletime;
-                    // percentage of use of the current processing unit
-                    int usage = ((delta - idletime) * 100) / delta;
-                    //log4cpp::Category::getRoot().debug("PLATFORMMONITOR result for %s is %d", ctd.name.c_str(), usage);
-                    if (n == 0)
-                        platLoad.addCpuLoad(usage);
-                    else
-                        platLoad.addPULoad(usage);
-                    cpuTimeData[n] = ctd;
-                }
+        log4cpp::Category &cat = log4cpp::Category::getRoot();
+        if (procStatFd < 0) {
+            procStatFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+            if (procStatFd < 0) {
+                cat.error("PLATFORMMONITOR Could not open /proc/stat: %s", strerror(errno));
+                return;
             }
         }
+        int numPu = pd_.getNumProcessingUnits();
+        cat.debug("PLATFORMMONITOR reading CPU time data for %d processing units", numPu);
+        // the line of all the CPUs, then one line per processing unit
+        procStatCpus.resize(numPu + 1);
+        if (!procStat->read(procStatFd)) {
+            cat.error("PLATFORMMONITOR Could not read /proc/stat: %s", strerror(errno));
+            return;
+        }
+        size_t numLines = rmcommon::parseProcStatCpus(procStat->view(), procStatCpus.data(), procStatCpus.size());
+        if (numLines < procStatCpus.size()) {
+            cat.error("PLATFORMMONITOR Could not parse /proc/stat: %d \"cpu\" lines found, %d expected",
+                      (int)numLines, numPu + 1);
+        }
 
-        ostringstream os;
-        os << "{\"cpu\":[";
-        for (int n = 0; n <= numPu; ++n) {
-            if (n > 0) {
-                os << ',';
+        for (size_t n = 0; n < numLines; ++n) {
+            const rmcommon::ProcStatCpu &pc = procStatCpus[n];
+            if (n >= cpuTimeData.size()) {
+                // first time we read
+                // we only have one snapshot of the cpu status, so we can't compute usage yet
+                cpuTimeData.emplace_back(pc);
+                continue;
             }
-            os << cpuTimeData[n];
+            CPUTimeData &ctd = cpuTimeData[n];
+            uint64_t lastTotaltime = ctd.totaltime;
+            uint64_t lastIdletime = ctd.idletime;
+            ctd.update(pc);
+            // time elapsed between the last two snapshots, measured in USER_HZ
+            int delta = ctd.totaltime - lastTotaltime;
+            // time spent in idle between the last two snapshots, measured in USER_HZ
+            int idletime = ctd.idletime - lastIdletime;
+            // percentage of use of the current processing unit
+            int usage = delta > 0 ? ((delta - idletime) * 100) / delta : 0;
+            //log4cpp::Category::getRoot().debug("PLATFORMMONITOR result for %s is %d", ctd.name.c_str(), usage);
+            if (n == 0)
+                platLoad.addCpuLoad(usage);
+            else
+                platLoad.addPULoad(usage);
         }
-        os << "]}";
-        //log4cpp::Category::getRoot().debug("PLATFORMMONITOR read CPU times %s", os.str().c_str());
     }
 };
 
@@ -281,18 +284,13 @@ void PlatformMonitor::run()
 {
     setThreadName("PLATFORMMONITOR");
     cat_.info("PLATFORMMONITOR running");
-    while (!stopped()) {
-        for (int i = 0; i < monitorPeriod_ && !stopped() ; ++i) {
-            this_thread::sleep_for(chrono::seconds(1));
-        }
-        if (!stopped()) {
-            rmcommon::PlatformTemperature platTemp;
-            rmcommon::PlatformPower platPower;
-            rmcommon::PlatformLoad platLoad;
-            pimpl_->handleSensors(platTemp, platPower);
-            pimpl_->handleCpuTimes(platLoad);
-            bus_.publish(new rmcommon::MonitorEvent(platTemp, platPower, platLoad));
-        }
+    while (sleepFor(chrono::seconds(monitorPeriod_))) {
+        rmcommon::PlatformTemperature platTemp;
+        rmcommon::PlatformPower platPower;
+        rmcommon::PlatformLoad platLoad;
+        pimpl_->handleSensors(platTemp, platPower);
+        pimpl_->handleCpuTimes(platLoad);
+        bus_.publish(new rmcommon::MonitorEvent(platTemp, platPower, platLoad));
     }
     cat_.info("PLATFORMMONITOR exiting");
 }
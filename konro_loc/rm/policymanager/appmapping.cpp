@@ -0,0 +1,141 @@
+#include "appmapping.h"
+#include "cgroupwriter.h"
+#include "latencystats.h"
+#include <algorithm>
+#include <set>
+
+using namespace std;
+
+namespace rp {
+
+namespace {
+
+/*! Returns true if "newVec" contains all the elements of "oldVec" */
+bool isWider(const rmcommon::CpusetVector &newVec, const rmcommon::CpusetVector &oldVec)
+{
+    set<short> newSet = rmcommon::toSet(newVec);
+    set<short> oldSet = rmcommon::toSet(oldVec);
+    return includes(newSet.begin(), newSet.end(), oldSet.begin(), oldSet.end());
+}
+
+/*! Returns true if "newVal" is greater than "oldVal" ("max" is the greatest value) */
+bool isWider(rmcommon::NumericValue newVal, rmcommon::NumericValue oldVal)
+{
+    return oldVal.isInvalid() || static_cast<uint64_t>(newVal) > static_cast<uint64_t>(oldVal);
+}
+
+/*! Returns true if two values differ */
+bool differ(rmcommon::NumericValue newVal, rmcommon::NumericValue oldVal)
+{
+    return !newVal.isInvalid() && static_cast<uint64_t>(newVal) != static_cast<uint64_t>(oldVal);
+}
+
+}   // namespace
+
+void AppMapping::begin()
+{
+    settle();
+    committed_ = Committed { puVec_, cpuMax_, memNodes_, minMemory_, maxMemory_ };
+    inTransaction_ = true;
+}
+
+void AppMapping::rollback()
+{
+    puVec_ = committed_.puVec;
+    cpuMax_ = committed_.cpuMax;
+    memNodes_ = committed_.memNodes;
+    minMemory_ = committed_.minMemory;
+    maxMemory_ = committed_.maxMemory;
+    inTransaction_ = false;
+}
+
+std::function<void()> AppMapping::prepareCommit()
+{
+    inTransaction_ = false;
+
+    bool puVecChanged = !puVec_.empty() && puVec_ != committed_.puVec;
+    bool puVecWider = puVecChanged && isWider(puVec_, committed_.puVec);
+    bool memNodesChanged = !memNodes_.empty() && memNodes_ != committed_.memNodes;
+    bool memNodesWider = memNodesChanged && isWider(memNodes_, committed_.memNodes);
+    bool cpuMaxChanged = differ(cpuMax_, committed_.cpuMax);
+    bool cpuMaxWider = cpuMaxChanged && isWider(cpuMax_, committed_.cpuMax);
+    bool minMemoryChanged = minMemory_ != -1 && minMemory_ != committed_.minMemory;
+    bool minMemoryWider = minMemoryChanged && minMemory_ > committed_.minMemory;
+    bool maxMemoryChanged = differ(maxMemory_, committed_.maxMemory);
+    bool maxMemoryWider = maxMemoryChanged && isWider(maxMemory_, committed_.maxMemory);
+
+    return [=, app = app_, puVec = puVec_, cpuMax = cpuMax_, memNodes = memNodes_,
+            minMemory = minMemory_, maxMemory = maxMemory_]() {
+        static rmcommon::LatencyHistogram &histogram =
+                rmcommon::LatencyStats::instance().histogram("APPMAPPING", "transaction", "apply");
+        rmcommon::ScopedLatency latency(histogram);
+
+        // 1 - Resources which grow: the limits are raised before the
+        //     guarantees (memory.max before memory.min) and the PUs are
+        //     added before the bandwidth is raised
+        if (maxMemoryWider)
+            pc::MemoryControl::instance().setMax(maxMemory, app);
+        if (minMemoryWider)
+            pc::MemoryControl::instance().setMin(minMemory, app);
+        if (memNodesWider)
+            pc::CpusetControl::instance().setMems(memNodes, app);
+        if (puVecWider)
+            pc::CpusetControl::instance().setCpus(puVec, app);
+        if (cpuMaxWider)
+            pc::CpuControl::instance().setMax(cpuMax, app);
+
+        // 2 - Resources which shrink, in the reverse order
+        if (cpuMaxChanged && !cpuMaxWider)
+            pc::CpuControl::instance().setMax(cpuMax, app);
+        if (puVecChanged && !puVecWider)
+            pc::CpusetControl::instance().setCpus(puVec, app);
+        if (memNodesChanged && !memNodesWider)
+            pc::CpusetControl::instance().setMems(memNodes, app);
+        if (minMemoryChanged && !minMemoryWider)
+            pc::MemoryControl::instance().setMin(minMemory, app);
+        if (maxMemoryChanged && !maxMemoryWider)
+            pc::MemoryControl::instance().setMax(maxMemory, app);
+    };
+}
+
+void AppMapping::commit()
+{
+    std::function<void()> writes = prepareCommit();
+    try {
+        writes();
+    } catch (...) {
+        // the content of the cgroup files is not known: read it on next use
+        invalidate();
+        throw;
+    }
+}
+
+std::shared_future<void> AppMapping::commitAsync()
+{
+    pending_ = pc::CgroupWriter::instance().submit(app_->getCgroupDir(), prepareCommit()).share();
+    return pending_;
+}
+
+void AppMapping::invalidate()
+{
+    puVec_.clear();
+    cpuMax_.setInvalid();
+    memNodes_.clear();
+    minMemory_ = -1;
+    maxMemory_.setInvalid();
+}
+
+void AppMapping::settle()
+{
+    if (!pending_.valid())
+        return;
+    try {
+        pending_.get();
+    } catch (...) {
+        // logged by the CgroupWriter
+        invalidate();
+    }
+    pending_ = std::shared_future<void>();
+}
+
+}   // namespace rp
@@ -2,8 +2,10 @@
 #define APPMAPPING_H
 
 #include <app.h>
+#include <appregistry.h>
+#include <functional>
+#include <future>
 #include <memory>
-#include <set>
 #include "cpucontrol.h"
 #include "cpusetcontrol.h"
 #include "numericvalue.h"
@@ -25,6 +27,10 @@ namespace rp {
  * instead of reading the file.
  * The setter methods of this class can be used to simultaneosuly write
  * the desired value to a cgroup file and store it in a variable.
+ * \p
+ * Inside a Transaction the setters only update the variables: the
+ * changes are written when the transaction is committed, skipping the
+ * values which did not change.
  */
 class AppMapping {
     std::shared_ptr<rmcommon::App> app_;
@@ -37,16 +43,111 @@ class AppMapping {
     /*! minimum amount of memory the app must always retain */
     int minMemory_;
     /*! memory usage hard limit for the app */
-    int maxMemory_;
+    rmcommon::NumericValue maxMemory_;
     /*! last feedback value received from the app */
     int lastFeedback_;
 
+    /*! The values in the cgroup files when the transaction began */
+    struct Committed {
+        rmcommon::CpusetVector puVec;
+        rmcommon::NumericValue cpuMax;
+        rmcommon::CpusetVector memNodes;
+        int minMemory;
+        rmcommon::NumericValue maxMemory;
+    };
+    bool inTransaction_;
+    Committed committed_;
+    /*! the transaction being applied by the CgroupWriter, if any */
+    std::shared_future<void> pending_;
+
+    void begin();
+    void commit();
+    std::shared_future<void> commitAsync();
+    void rollback();
+
+    /*!
+     * Returns the function which writes the changes of the transaction,
+     * in the order they must be applied. The function only uses copies
+     * of the values, so it can be run by another thread.
+     */
+    std::function<void()> prepareCommit();
+
+    /*! Forgets the cached values: they are read again on next use */
+    void invalidate();
+
+    /*!
+     * Waits for the transaction being applied by the CgroupWriter;
+     * if it failed, the cached values are invalidated
+     */
+    void settle();
+
 public:
+    /*!
+     * \class collects the changes made to an AppMapping and writes them
+     *        all at once.
+     *
+     * Unchanged values are not written. The resources which grow are
+     * written before the ones which shrink (e.g. a PU is added before
+     * the CPU bandwidth is raised, the bandwidth is lowered before a PU
+     * is removed), so the cgroup never goes through a state which is
+     * not allowed or which is more restrictive than the final one.
+     * \p
+     * If the transaction is destroyed without being committed, the
+     * changes are discarded.
+     *
+     * \example AppMapping::Transaction tx(*appMapping);
+     *          appMapping->setPuVector(vec);
+     *          appMapping->setCpuMax(200);
+     *          tx.commit();
+     */
+    class Transaction {
+        AppMapping &appMapping_;
+        bool done_;
+    public:
+        explicit Transaction(AppMapping &appMapping) :
+            appMapping_(appMapping),
+            done_(false)
+        {
+            appMapping_.begin();
+        }
+
+        ~Transaction() {
+            if (!done_)
+                appMapping_.rollback();
+        }
+
+        Transaction(const Transaction &) = delete;
+        Transaction &operator=(const Transaction &) = delete;
+
+        /*!
+         * Writes the changes to the cgroup files
+         * \throws PcException in case of error; the changes not yet
+         *         written are discarded
+         */
+        void commit() {
+            done_ = true;
+            appMapping_.commit();
+        }
+
+        /*!
+         * Submits the changes to the CgroupWriter and returns without
+         * waiting for them to be written. The cached values are the new
+         * ones; if the writes fail, they are read again from the cgroup
+         * files at the beginning of the next transaction on the app.
+         * \returns a future which is ready when the changes have been
+         *          written, holding the exception in case of error
+         */
+        std::shared_future<void> commitAsync() {
+            done_ = true;
+            return appMapping_.commitAsync();
+        }
+    };
+
     AppMapping(std::shared_ptr<rmcommon::App> app) :
         app_(app),
         minMemory_(-1),
-        maxMemory_(-1),
-        lastFeedback_(-1)
+        lastFeedback_(-1),
+        inTransaction_(false)
     {
     }
     ~AppMapping() = default;
@@ -59,10 +160,27 @@ public:
         return app_->getPid();
     }
 
+    pid_t getNsPid() const {
+        return app_->getNsPid();
+    }
+
+    rmcommon::namespace_t getPidNamespace() const {
+        return app_->getPidNamespace();
+    }
+
     std::shared_ptr<rmcommon::App> getApp() const {
         return app_;
     }
 
+    /*!
+     * Replaces the application with another process of the same
+     * control group, e.g. when the root of a process tree exits
+     * before the other processes
+     */
+    void setApp(std::shared_ptr<rmcommon::App> app) {
+        app_ = app;
+    }
+
     const std::string getCgroupDir() const noexcept {
         return app_->getCgroupDir();
     }
@@ -70,11 +188,18 @@ public:
     rmcommon::CpusetVector getPuVector() {
         if (puVec_.empty()) {
             puVec_ = pc::CpusetControl::instance().getCpusEffective(app_);
+            if (inTransaction_)
+                committed_.puVec = puVec_;
         }
         return puVec_;
     }
 
     void setPuVector(rmcommon::CpusetVector puVec) {
+        if (inTransaction_) {
+            puVec_ = puVec;
+            return;
+        }
+        settle();
 #ifdef TIMING
         rmcommon::KonroTimer timer;
 #endif
@@ -89,6 +214,20 @@ public:
         puVec_ = puVec;
     }
 
+    /*!
+     * \brief Loads the resources assigned to the application from its
+     *        cgroup (cpuset.cpus, cpu.max, memory.max) without changing them.
+     *
+     * Used for the applications recovered after a restart of Konro.
+     * If no PUs were assigned, the PU vector stays empty.
+     * \throws PcException in case of error
+     */
+    void restore() {
+        puVec_ = pc::CpusetControl::instance().getCpus(app_);
+        cpuMax_ = pc::CpuControl::instance().getMax(app_);
+        maxMemory_ = pc::MemoryControl::instance().getMax(app_);
+    }
+
     /*! Returns the number of PUs used */
     int countPUs() const {
         return rmcommon::countPUs(puVec_);
@@ -97,24 +236,34 @@ public:
     rmcommon::NumericValue getCpuMax() {
         if (cpuMax_.isInvalid()) {
             cpuMax_ = pc::CpuControl::instance().getMax(app_);
+            if (inTransaction_)
+                committed_.cpuMax = cpuMax_;
         }
         return cpuMax_;
     }
 
     void setCpuMax(rmcommon::NumericValue cpuMax) {
-        pc::CpuControl::instance().setMax(cpuMax, app_);
+        if (!inTransaction_) {
+            settle();
+            pc::CpuControl::instance().setMax(cpuMax, app_);
+        }
         cpuMax_ = cpuMax;
     }
 
     rmcommon::CpusetVector getMemNodes() {
         if (memNodes_.empty()) {
             memNodes_ = pc::CpusetControl::instance().getMemsEffective(app_);
+            if (inTransaction_)
+                committed_.memNodes = memNodes_;
         }
         return memNodes_;
     }
 
     void setMemNodes(rmcommon::CpusetVector memNodes) {
-        pc::CpusetControl::instance().setMems(memNodes, app_);
+        if (!inTransaction_) {
+            settle();
+            pc::CpusetControl::instance().setMems(memNodes, app_);
+        }
         memNodes_ = memNodes;
     }
 
@@ -126,24 +275,34 @@ public:
     int getMinMemory() {
         if (minMemory_ == -1) {
             minMemory_ = pc::MemoryControl::instance().getMin(app_);
+            if (inTransaction_)
+                committed_.minMemory = minMemory_;
         }
         return minMemory_;
     }
 
     void setMinMemory(int minMemory) {
-        pc::MemoryControl::instance().setMin(minMemory, app_);
+        if (!inTransaction_) {
+            settle();
+            pc::MemoryControl::instance().setMin(minMemory, app_);
+        }
         minMemory_ = minMemory;
     }
 
     rmcommon::NumericValue getMaxMemory() {
-        if (maxMemory_ == -1) {
+        if (maxMemory_.isInvalid()) {
             maxMemory_ = pc::MemoryControl::instance().getMax(app_);
+            if (inTransaction_)
+                committed_.maxMemory = maxMemory_;
         }
         return maxMemory_;
     }
 
     void setMaxMemory(rmcommon::NumericValue maxMemory) {
-        pc::MemoryControl::instance().setMax(maxMemory, app_);
+        if (!inTransaction_) {
+            settle();
+            pc::MemoryControl::instance().setMax(maxMemory, app_);
+        }
         maxMemory_ = maxMemory;
     }
 
@@ -158,11 +317,8 @@ public:
 
 using AppMappingPtr = std::shared_ptr<AppMapping>;
 
-/*! Comparison function for the set */
-using AppMappingComparator = bool (*)(const AppMappingPtr &lhs,
-                                      const AppMappingPtr &rhs);
-
-using AppMappingSet = std::set<AppMappingPtr, AppMappingComparator>;
+/*! The applications handled by the PolicyManager, indexed by pid */
+using AppMappingSet = rmcommon::AppRegistry<AppMapping>;
 
 }   // namespace rp
 
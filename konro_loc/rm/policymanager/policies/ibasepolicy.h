@@ -27,6 +27,15 @@ public:
      */
     virtual void addApp(AppMappingPtr appMapping) = 0;
 
+    /*!
+     * Handles an app which was managed before Konro restarted.
+     * The resources of the app, already loaded in the AppMapping, are
+     * still assigned: the policy only rebuilds its own bookkeeping.
+     * The default implementation does nothing.
+     */
+    virtual void restoreApp([[maybe_unused]] AppMappingPtr appMapping) {
+    }
+
     /*!
      * Handles the removal of an app from the system.
      */
@@ -1,4 +1,5 @@
 #include "mincorespolicy.h"
+#include "policyutil.h"
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
@@ -14,18 +15,6 @@ MinCoresPolicy::MinCoresPolicy(const AppMappingSet &apps,
     : apps_(apps), platformDescription_(pd), hasLastPlatformLoad_(false),
       appsOnPu_(pd.getNumProcessingUnits(), 0) {}
 
-/*! Counts the number of apps in the same cgroup of the specified one */
-static int countAppsWithSameCgroup(const AppMappingSet &apps,
-                                   AppMappingPtr appMapping) {
-  int n = 0;
-  for (const auto &am : apps) {
-    if (am->getCgroupDir() == appMapping->getCgroupDir()) {
-      ++n;
-    }
-  }
-  return n;
-}
-
 /*!
  * Returns the PU that currently has lower usage.
  *
@@ -339,6 +328,13 @@ void MinCoresPolicy::addApp(AppMappingPtr appMapping) {
   }
 }
 
+void MinCoresPolicy::restoreApp(AppMappingPtr appMapping) {
+  // the app was never assigned PUs: handle it as a new app
+  if (!restoreAppsOnPu(apps_, appMapping, appsOnPu_, "MINCORESPOLICY")) {
+    addApp(appMapping);
+  }
+}
+
 void MinCoresPolicy::removeApp(AppMappingPtr appMapping) {
   rmcommon::CpusetVector vec = appMapping->getPuVector();
   std::vector<short> vecPu = rmcommon::toVector(vec);
@@ -39,6 +39,7 @@ public:
         return "MinCoresPolicy";
     }
     virtual void addApp(AppMappingPtr appMapping) override;
+    virtual void restoreApp(AppMappingPtr appMapping) override;
     virtual void removeApp(AppMappingPtr appMapping) override;
     virtual void timer() override;
     virtual void monitor(std::shared_ptr<const rmcommon::MonitorEvent> event) override;
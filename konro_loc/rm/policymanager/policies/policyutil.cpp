@@ -0,0 +1,39 @@
+#include "policyutil.h"
+#include "cpusetvector.h"
+#include <cstddef>
+#include <log4cpp/Category.hh>
+
+namespace rp {
+
+int countAppsWithSameCgroup(const AppMappingSet &apps,
+                            AppMappingPtr appMapping) {
+  int n = 0;
+  for (const auto &am : apps) {
+    if (am->getCgroupDir() == appMapping->getCgroupDir()) {
+      ++n;
+    }
+  }
+  return n;
+}
+
+bool restoreAppsOnPu(const AppMappingSet &apps, AppMappingPtr appMapping,
+                     std::vector<int> &appsOnPu, const char *policyName) {
+  if (countAppsWithSameCgroup(apps, appMapping) > 1) {
+    return true;
+  }
+  if (appMapping->countPUs() == 0) {
+    return false;
+  }
+  rmcommon::CpusetVector vec = appMapping->getPuVector();
+  for (short pu : rmcommon::toVector(vec)) {
+    if (pu >= 0 && static_cast<size_t>(pu) < appsOnPu.size()) {
+      ++appsOnPu[pu];
+    }
+  }
+  log4cpp::Category::getRoot().info("%s restoreApp PID %ld on PUs %s",
+                                    policyName, (long)appMapping->getPid(),
+                                    rmcommon::toString(vec).c_str());
+  return true;
+}
+
+} // namespace rp
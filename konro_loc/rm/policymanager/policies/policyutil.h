@@ -0,0 +1,29 @@
+#ifndef POLICYUTIL_H
+#define POLICYUTIL_H
+
+#include "../appmapping.h"
+#include <vector>
+
+namespace rp {
+
+/*! Counts the number of apps in the same cgroup of the specified one */
+int countAppsWithSameCgroup(const AppMappingSet &apps, AppMappingPtr appMapping);
+
+/*!
+ * Rebuilds the number of apps scheduled on each PU for an app which was
+ * managed before Konro restarted. Nothing is counted if the app shares
+ * its cgroup with another app, which was already counted.
+ *
+ * \param apps the apps managed by the policy
+ * \param appMapping the restored app
+ * \param appsOnPu the number of apps scheduled on each PU
+ * \param policyName the prefix of the log message
+ * \returns false if the app was never assigned PUs: the policy must
+ *          handle it as a new app
+ */
+bool restoreAppsOnPu(const AppMappingSet &apps, AppMappingPtr appMapping,
+                     std::vector<int> &appsOnPu, const char *policyName);
+
+} // namespace rp
+
+#endif // POLICYUTIL_H
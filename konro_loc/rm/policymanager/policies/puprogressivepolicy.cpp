@@ -1,4 +1,5 @@
 #include "puprogressivepolicy.h"
+#include "policyutil.h"
 #include <algorithm>
 #include <cstddef>
 #include <ranges>
@@ -11,19 +12,6 @@ PuProgressivePolicy::PuProgressivePolicy(const AppMappingSet &apps,
     : apps_(apps), platformDescription_(pd),
       appsOnPu_(pd.getNumProcessingUnits(), 0) {}
 
-/*!
- * Counts the number of apps in the same cgroup of the specified one.
- * appMapping does not (yet) belong to apps.
- */
-static int countAppsWithSameCgroup(const AppMappingSet &apps,
-                                   AppMappingPtr appMapping) {
-  int n =
-      std::count_if(apps.begin(), apps.end(), [appMapping](AppMappingPtr am) {
-        return am->getCgroupDir() == appMapping->getCgroupDir();
-      });
-  return n;
-}
-
 /*!
  * Returns the PU that currently has lower usage.
  *
@@ -378,9 +366,11 @@ void PuProgressivePolicy::addApp(AppMappingPtr appMapping) {
   try {
     int cpuMax = 100;
     short initialPU = pickInitialPU();
+    AppMapping::Transaction tx(*appMapping);
     appMapping->setPuVector({{initialPU, initialPU}});
-    ++appsOnPu_[initialPU];
     appMapping->setCpuMax(cpuMax);
+    tx.commit();
+    ++appsOnPu_[initialPU];
     log4cpp::Category::getRoot().info(
         "PUPROGRESSIVEPOLICY addApp PID %ld to PU %d with CPU max=%d",
         (long)pid, initialPU, cpuMax);
@@ -396,6 +386,13 @@ void PuProgressivePolicy::addApp(AppMappingPtr appMapping) {
   }
 }
 
+void PuProgressivePolicy::restoreApp(AppMappingPtr appMapping) {
+  // the app was never assigned PUs: handle it as a new app
+  if (!restoreAppsOnPu(apps_, appMapping, appsOnPu_, "PUPROGRESSIVEPOLICY")) {
+    addApp(appMapping);
+  }
+}
+
 void PuProgressivePolicy::removeApp(AppMappingPtr appMapping) {
   rmcommon::CpusetVector vec = appMapping->getPuVector();
   std::vector<short> vecPu = rmcommon::toVector(vec);
@@ -435,10 +432,15 @@ void PuProgressivePolicy::feedback(AppMappingPtr appMapping, int feedback) {
       log4cpp::Category::getRoot().info("PUPROGRESSIVEPOLICY adding PU %d",
                                         newPU);
       rmcommon::addPU(vec, newPU);
+      // the new PU is written before the higher bandwidth
+      AppMapping::Transaction tx(*appMapping);
       appMapping->setPuVector(vec);
+      increaseCPUquota(appMapping, scalePercentage);
+      // applied by the CgroupWriter, so that the migration of the tasks
+      // does not delay the next decisions
+      tx.commitAsync();
       ++appsOnPu_[newPU];
       logCpuSetVector("newPUs: ", vec);
-      increaseCPUquota(appMapping, scalePercentage);
     } else {
       log4cpp::Category::getRoot().info(
           "PUPROGRESSIVEPOLICY no new PU available for proc %d",
@@ -458,10 +460,13 @@ void PuProgressivePolicy::feedback(AppMappingPtr appMapping, int feedback) {
       log4cpp::Category::getRoot().info("PUPROGRESSIVEPOLICY removing PU %d",
                                         remPU);
       rmcommon::removePU(vec, remPU);
+      // the lower bandwidth is written before the PU is removed
+      AppMapping::Transaction tx(*appMapping);
       appMapping->setPuVector(vec);
+      decreaseCPUquota(appMapping, scalePercentage);
+      tx.commitAsync();
       --appsOnPu_[remPU];
       logCpuSetVector("newPUs: ", vec);
-      decreaseCPUquota(appMapping, scalePercentage);
     } else {
       log4cpp::Category::getRoot().info(
           "PUPROGRESSIVEPOLICY no PU to remove for proc %d",
@@ -1,4 +1,5 @@
 #include "randpolicy.h"
+#include "policyutil.h"
 #include "cpusetvector.h"
 #include <random>
 #include <log4cpp/Category.hh>
@@ -7,20 +8,6 @@ using namespace std;
 
 namespace rp {
 
-namespace rputil {
-
-    int countAppsWithSameCgroup(const AppMappingSet &apps, AppMappingPtr appMapping) {
-        int n = 0;
-        for (const auto &am: apps) {
-            if (am->getCgroupDir() == appMapping->getCgroupDir()) {
-                ++n;
-            }
-        }
-        return n;
-    }
-
-}   // namespace rputil
-
 /*!
  * Extracts a random CPU number
  *
@@ -45,7 +32,7 @@ void RandPolicy::addApp(AppMappingPtr appMapping)
 {
     // If there are already other Apps in the same cgroup folder,
     // handle them as a group and do nothing here
-    if (rputil::countAppsWithSameCgroup(apps_, appMapping) > 1) {
+    if (countAppsWithSameCgroup(apps_, appMapping) > 1) {
         log4cpp::Category::getRoot().debug("RANDPOLICY addApp to an already initialized cgroup");
         return;
     }
@@ -5,6 +5,7 @@
 #include "policies/mincorespolicy.h"
 #include "policies/dromrandpolicy.h"
 #include "eventbus.h"
+#include "placementwaiters.h"
 #include <iostream>
 #include <sstream>
 
@@ -12,25 +13,11 @@ using namespace std;
 
 namespace rp {
 
-/*!
- * Compares two AppMapping ("less" function) handled
- * by shared pointers
- *
- * \param lhs the first app to compare
- * \param rhs the second app to compare
- * \return true if pid of lsh is < than pid of rhs
- */
-static bool appMappingComp(const AppMappingPtr &lhs, const AppMappingPtr &rhs)
-{
-    return lhs->getPid() < rhs->getPid();
-}
-
 PolicyManager::PolicyManager(rmcommon::EventBus &bus, PlatformDescription pd, Policy policy) :
     rmcommon::BaseEventReceiver("POLICYMANAGER"),
     cat_(log4cpp::Category::getRoot()),
     bus_(bus),
-    platformDescription_(pd),
-    apps_(appMappingComp)
+    platformDescription_(pd)
 {
     subscribeToEvents();
     policy_ = makePolicy(policy);
@@ -74,58 +61,68 @@ PolicyManager::Policy PolicyManager::getPolicyByName(const std::string &policyNa
 
 void PolicyManager::subscribeToEvents()
 {
-    using namespace rmcommon;
-
-    bus_.subscribe<PolicyManager, AddEvent, BaseEvent>(this, &PolicyManager::addEvent);
-    bus_.subscribe<PolicyManager, RemoveEvent, BaseEvent>(this, &PolicyManager::addEvent);
-    bus_.subscribe<PolicyManager, TimerEvent, BaseEvent>(this, &PolicyManager::addEvent);
-    bus_.subscribe<PolicyManager, FeedbackEvent, BaseEvent>(this, &PolicyManager::addEvent);
-    bus_.subscribe<PolicyManager, MonitorEvent, BaseEvent>(this, &PolicyManager::addEvent);
-}
-
-bool PolicyManager::processEvent(std::shared_ptr<const rmcommon::BaseEvent> event)
-{
-    using namespace rmcommon;
-
-#if 0
-    ostringstream os;
-    os << "POLICYMANAGER received message => " << *event;
-    cat_.debug(os.str());
-#endif
-    if (const AddEvent *e = dynamic_cast<const AddEvent *>(event.get())) {
-        processAddEvent(static_pointer_cast<const AddEvent>(event));
-    } else if (const RemoveEvent *e = dynamic_cast<const RemoveEvent *>(event.get())) {
-        processRemoveEvent(static_pointer_cast<const RemoveEvent>(event));
-    } else if (const TimerEvent *e = dynamic_cast<const TimerEvent *>(event.get())) {
-        processTimerEvent(static_pointer_cast<const TimerEvent>(event));
-    } else if (const MonitorEvent *e = dynamic_cast<const MonitorEvent *>(event.get())) {
-        processMonitorEvent(static_pointer_cast<const MonitorEvent>(event));
-    } else if (const FeedbackEvent *e = dynamic_cast<const FeedbackEvent *>(event.get())) {
-        processFeedbackEvent(static_pointer_cast<const FeedbackEvent>(event));
-    }
-    return true;        // continue processing
+    // applying a stale feedback would only cause a useless cpuset change
+    coalesce<rmcommon::FeedbackEvent>([](const rmcommon::FeedbackEvent &event) {
+        return make_pair(event.getApp()->getPid(), event.getApp()->getPidNamespace());
+    });
+    subscribe(bus_, &PolicyManager::processAddEvent, LIFECYCLE_LANE);
+    subscribe(bus_, &PolicyManager::processRemoveEvent, LIFECYCLE_LANE);
+    subscribe(bus_, &PolicyManager::processTimerEvent);
+    subscribe(bus_, &PolicyManager::processFeedbackEvent);
+    subscribe(bus_, &PolicyManager::processMonitorEvent);
 }
 
 void PolicyManager::processAddEvent(std::shared_ptr<const rmcommon::AddEvent> event)
 {
     cat_.debug("POLICYMANAGER AddEvent received");
+    // the members of a process tree share the control group of the
+    // application, so the policy manages them through the application
     AppMappingPtr appMapping = make_shared<AppMapping>(event->getApp());
-    apps_.insert(appMapping);
-    dumpApps();
-    policy_->addApp(appMapping);
+    if (!apps_.insert(appMapping)) {
+        cat_.error("POLICYMANAGER AddEvent: pid %d already handled", event->getApp()->getPid());
+        rmcommon::PlacementWaiters::instance().complete(event->getApp()->getPid(), false);
+        return;
+    }
+    trees_.add(appMapping->getPid(), event->getMembers());
+    logChange('+', appMapping->getPid());
+    if (event->isRecovered()) {
+        try {
+            appMapping->restore();
+        } catch (exception &e) {
+            cat_.error("POLICYMANAGER AddEvent: could not restore pid %d: %s",
+                       appMapping->getPid(), e.what());
+        }
+        policy_->restoreApp(appMapping);
+    } else {
+        policy_->addApp(appMapping);
+    }
+    // a launcher may be holding the application until it is placed
+    rmcommon::PlacementWaiters::instance().complete(appMapping->getPid(), true);
 }
 
 void PolicyManager::processRemoveEvent(std::shared_ptr<const rmcommon::RemoveEvent> event)
 {
     cat_.debug("POLICYMANAGER RemoveProc event received");
-    // search target
-    AppMappingPtr appMapping = make_shared<AppMapping>(event->getApp());
-    auto it = apps_.find(appMapping);
-    if (it != end(apps_)) {
-        policy_->removeApp(*it);
-        apps_.erase(it);
+    pid_t pid = event->getApp()->getPid();
+    AppMappingPtr appMapping = apps_.find(pid);
+    if (!appMapping) {
+        trees_.removeMember(pid);
+        return;
+    }
+    // the other processes of the tree keep running in the cgroup,
+    // so they keep its resources
+    shared_ptr<rmcommon::App> heir = trees_.promote(pid);
+    if (heir) {
+        apps_.erase(pid);
+        appMapping->setApp(heir);
+        apps_.insert(appMapping);
+        cat_.info("POLICYMANAGER pid %ld exited, its application is now owned by pid %ld",
+                  (long)pid, (long)heir->getPid());
+        return;
     }
-    dumpApps();
+    policy_->removeApp(appMapping);
+    apps_.erase(pid);
+    logChange('-', pid);
 }
 
 void PolicyManager::processTimerEvent([[maybe_unused]] std::shared_ptr<const rmcommon::TimerEvent> event)
@@ -151,30 +148,30 @@ void PolicyManager::processFeedbackEvent(std::shared_ptr<const rmcommon::Feedbac
                event->getApp()->getPid(),
                (long)micros.count());
 
-    AppMappingPtr appMapping = make_shared<AppMapping>(event->getApp());
-    auto it = apps_.find(appMapping);
-    if (it != end(apps_)) {
-        policy_->feedback(*it, event->getFeedback());
+    AppMappingPtr appMapping = findMapping(event->getApp()->getPid());
+    if (appMapping) {
+        policy_->feedback(appMapping, event->getFeedback());
     } else {
         cat_.error("POLICYMANAGER feedback event: AppMapping not found for pid %d",
                    event->getApp()->getPid());
     }
 }
 
-void PolicyManager::dumpApps() const
+AppMappingPtr PolicyManager::findMapping(pid_t pid) const
 {
-    std::ostringstream os;
-    os << "POLICYMANAGER handling PIDS [";
-    bool first = true;
-    for (auto &app: apps_) {
-        if (first)
-            first = false;
-        else
-            os << ",";
-        os << app->getPid();
+    AppMappingPtr appMapping = apps_.find(pid);
+    if (!appMapping) {
+        pid_t owner = trees_.ownerOf(pid);
+        if (owner != 0)
+            appMapping = apps_.find(owner);
     }
-    os << "]";
-    cat_.info(os.str());
+    return appMapping;
+}
+
+void PolicyManager::logChange(char op, pid_t pid) const
+{
+    cat_.info(R"(POLICYMANAGER handling %c%ld {"apps":%lu})",
+              op, (long)pid, (unsigned long)apps_.size());
 }
 
 }   // namespace rp
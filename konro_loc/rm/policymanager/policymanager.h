@@ -13,6 +13,7 @@
 #include "appmapping.h"
 #include "policies/ibasepolicy.h"
 #include "platformdescription.h"
+#include "processtrees.h"
 #include <log4cpp/Category.hh>
 #include <set>
 #include <memory>
@@ -47,15 +48,11 @@ private:
     std::unique_ptr<IBasePolicy> policy_;
     PlatformDescription platformDescription_;
     AppMappingSet apps_;
+    /*! the other processes of the applications added as a process tree */
+    rmcommon::ProcessTrees trees_;
 
     void subscribeToEvents();
 
-    /*!
-     * Processes a generic event by calling the appropriate handler function.
-     * \param event the event to process
-     */
-    bool processEvent(std::shared_ptr<const rmcommon::BaseEvent> event) override;
-
     /*!
      * Processes an AddEvent.
      * \param event the event to process
@@ -86,8 +83,17 @@ private:
      */
     void processFeedbackEvent(std::shared_ptr<const rmcommon::FeedbackEvent> event);
 
-    /* for debugging */
-    void dumpApps() const;
+    /*!
+     * Returns the AppMapping of a process: the processes of a tree
+     * are managed through the AppMapping of the owner of the tree
+     */
+    AppMappingPtr findMapping(pid_t pid) const;
+
+    /*!
+     * Logs the addition ('+') or removal ('-') of an application;
+     * the whole set is not logged, to keep the cost constant
+     */
+    void logChange(char op, pid_t pid) const;
 
     /*! Factory method */
     std::unique_ptr<IBasePolicy> makePolicy(Policy policy);
@@ -1,7 +1,7 @@
 #include "policytimer.h"
 #include "timerevent.h"
 #include "log4cpp/Category.hh"
-#include <thread>
+#include <chrono>
 
 namespace rp {
 
@@ -19,13 +19,8 @@ void PolicyTimer::run()
 {
     setThreadName("POLICYTIMER");
     log4cpp::Category::getRoot().info("POLICYTIMER starting");
-    while (!stopped()) {
-        for (int i = 0; i < seconds_ && !stopped() ; ++i) {
-            this_thread::sleep_for(chrono::seconds(1));
-        }
-        if (!stopped()) {
-            bus_.publish(new rmcommon::TimerEvent());
-        }
+    while (sleepFor(chrono::seconds(seconds_))) {
+        bus_.publish(new rmcommon::TimerEvent());
     }
     log4cpp::Category::getRoot().info("POLICYTIMER exiting");
 }
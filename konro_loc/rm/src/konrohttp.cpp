@@ -3,8 +3,13 @@
 #include "../../lib/json/json.hpp"
 #include "addrequestevent.h"
 #include "app.h"
+#include "appsnapshot.h"
 #include "feedbackrequestevent.h"
+#include "latencystats.h"
 #include "namespaces.h"
+#include "placementwaiters.h"
+#include <chrono>
+#include <sstream>
 #include <string>
 
 #ifdef TIMING
@@ -15,13 +20,19 @@ using namespace std;
 
 namespace http {
 
+/*! How long an add request with "wait" waits for the placement of the app */
+static constexpr std::chrono::seconds placementTimeout(5);
+
 struct KonroHttp::KonroHttpImpl {
   rmcommon::EventBus &bus_;
+  pc::IPlatformControl &platformControl_;
   log4cpp::Category &cat_;
   httplib::Server srv;
 
-  KonroHttpImpl(rmcommon::EventBus &eventBus)
-      : bus_(eventBus), cat_(log4cpp::Category::getRoot()) {}
+  KonroHttpImpl(rmcommon::EventBus &eventBus,
+                pc::IPlatformControl &platformControl)
+      : bus_(eventBus), platformControl_(platformControl),
+        cat_(log4cpp::Category::getRoot()) {}
 
   /*!
    * Extracts the data from the JSON and publishes a FeedbackRequestEvent
@@ -57,8 +68,11 @@ struct KonroHttp::KonroHttpImpl {
    * Extracts the data from the JSON and publishes an AddRequestEvent
    *
    * \param data the JSON in text format
+   * \param wait set to true if the sender waits for the placement of the app
+   * \return the pid of the application in Konro's namespace, or 0 if the
+   *         message is invalid
    */
-  void sendAddEvent(const std::string &data) {
+  pid_t sendAddEvent(const std::string &data, bool &wait) {
     using namespace nlohmann;
     rmcommon::KonroTimer::TimePoint tp = rmcommon::KonroTimer::now();
     basic_json<> j = json::parse(data);
@@ -72,7 +86,7 @@ struct KonroHttp::KonroHttpImpl {
     /* PID must always be present */
     if (!j.contains("pid")) {
       cat_.error("KONROHTTP missing pid in add message");
-      return;
+      return 0;
     }
     nsPid = j["pid"];
     /* Application name is optional */
@@ -87,7 +101,7 @@ struct KonroHttp::KonroHttpImpl {
       appType = rmcommon::App::getTypeByName(type);
       if (appType == rmcommon::App::AppType::UNKNOWN) {
         cat_.error("KONROHTTP invalid application type %s", type.c_str());
-        return;
+        return 0;
       }
       // The received pid is the one inside Konro's namespace
       pid = nsPid;
@@ -102,16 +116,25 @@ struct KonroHttp::KonroHttpImpl {
       }
     } else {
       cat_.error("KONROHTTP invalid message: no type or ns specified");
-      return;
+      return 0;
     }
+    /* If "tree" is true, the descendants of the process are added too */
+    bool tree = j.contains("tree") && j["tree"].is_boolean() && j["tree"].get<bool>();
+    /* If "wait" is true, the reply is sent when the app has been placed */
+    wait = j.contains("wait") && j["wait"].is_boolean() && j["wait"].get<bool>();
     cat_.info("KONROHTTP publishing AddRequestEvent for pid %ld in ns %lu with "
-              "name \"%s\" and type \"%s\"",
+              "name \"%s\" and type \"%s\"%s",
               static_cast<long>(nsPid), ns, name.c_str(),
-              rmcommon::App::getAppTypeString(appType).c_str());
+              rmcommon::App::getAppTypeString(appType).c_str(),
+              tree ? " (tree)" : "");
     rmcommon::AddRequestEvent *event = new rmcommon::AddRequestEvent(
-        rmcommon::App::makeApp(pid, appType, name, nsPid, ns));
+        rmcommon::App::makeApp(pid, appType, name, nsPid, ns), tree);
     event->setTimePoint(tp);
+    if (wait) {
+      rmcommon::PlacementWaiters::instance().expect(pid);
+    }
     bus_.publish(event);
+    return pid;
   }
 
   void handleGet([[maybe_unused]] const httplib::Request &req,
@@ -121,6 +144,28 @@ struct KonroHttp::KonroHttpImpl {
     res.set_content("200 - OK\r\n", "text/html");
   }
 
+  /*!
+   * \brief returns the latency histograms of all components as JSON
+   */
+  void handleLatencyGet([[maybe_unused]] const httplib::Request &req,
+                        httplib::Response &res) {
+    ostringstream os;
+    rmcommon::LatencyStats::instance().printOnOstream(os);
+    res.status = 200;
+    res.set_content(os.str(), "application/json");
+  }
+
+  /*!
+   * \brief returns the applications monitored by Konro as JSON
+   */
+  void handleAppsGet([[maybe_unused]] const httplib::Request &req,
+                     httplib::Response &res) {
+    ostringstream os;
+    rmcommon::AppSnapshot::instance().printOnOstream(os);
+    res.status = 200;
+    res.set_content(os.str(), "application/json");
+  }
+
   /*!
    * \brief handles the addition of a new process to Konro
    */
@@ -137,9 +182,35 @@ struct KonroHttp::KonroHttpImpl {
       body.append(data, data_length);
       return true;
     });
+    bool wait = false;
+    pid_t pid = sendAddEvent(body, wait);
+    if (pid > 0 && wait &&
+        !rmcommon::PlacementWaiters::instance().wait(pid, placementTimeout)) {
+      cat_.warn("KONROHTTP pid %ld not placed by the policy",
+                static_cast<long>(pid));
+      res.status = 504;
+    }
     res.set_content("You have sent an ADD POST '" + body + "'\r\n",
                     "text/plain");
-    sendAddEvent(body);
+  }
+
+  /*!
+   * \brief reserves a cgroup for an application which a launcher is about
+   *        to start, and returns its path as JSON
+   */
+  void handleReservePost([[maybe_unused]] const httplib::Request &req,
+                         httplib::Response &res) {
+    cat_.info("KONROHTTP RESERVE POST received");
+    std::string cgroupDir = platformControl_.reserveApplicationGroup();
+    if (cgroupDir.empty()) {
+      res.status = 503;
+      res.set_content("503 - No cgroup available\r\n", "text/plain");
+      return;
+    }
+    nlohmann::json j;
+    j["cgroup"] = cgroupDir;
+    res.status = 200;
+    res.set_content(j.dump(), "application/json");
   }
 
   /*!
@@ -160,9 +231,11 @@ struct KonroHttp::KonroHttpImpl {
   }
 };
 
-KonroHttp::KonroHttp(rmcommon::EventBus &eventBus, const char *listen_host,
-                     int listen_port)
-    : pimpl_(new KonroHttpImpl(eventBus)), cat_(log4cpp::Category::getRoot()),
+KonroHttp::KonroHttp(rmcommon::EventBus &eventBus,
+                     pc::IPlatformControl &platformControl,
+                     const char *listen_host, int listen_port)
+    : pimpl_(new KonroHttpImpl(eventBus, platformControl)),
+      cat_(log4cpp::Category::getRoot()),
       listen_host_(listen_host), listen_port_(listen_port) {}
 
 KonroHttp::~KonroHttp() {}
@@ -183,6 +256,18 @@ void KonroHttp::run() {
                     this->pimpl_->handleGet(req, res);
                   });
 
+  /* Latency histograms of the event pipeline */
+  pimpl_->srv.Get("/latency",
+                  [this](const httplib::Request &req, httplib::Response &res) {
+                    this->pimpl_->handleLatencyGet(req, res);
+                  });
+
+  /* Applications currently monitored */
+  pimpl_->srv.Get("/apps",
+                  [this](const httplib::Request &req, httplib::Response &res) {
+                    this->pimpl_->handleAppsGet(req, res);
+                  });
+
   /* Add new process under Konro's management */
   pimpl_->srv.Post("/add",
                    [this](const httplib::Request &req, httplib::Response &res,
@@ -190,6 +275,12 @@ void KonroHttp::run() {
                      this->pimpl_->handleAddPost(req, res, content_reader);
                    });
 
+  /* Cgroup for an application started by a launcher */
+  pimpl_->srv.Post("/reserve",
+                   [this](const httplib::Request &req, httplib::Response &res) {
+                     this->pimpl_->handleReservePost(req, res);
+                   });
+
   /* Communication with integrated applications */
   pimpl_->srv.Post("/feedback",
                    [this](const httplib::Request &req, httplib::Response &res,
@@ -3,6 +3,7 @@
 
 #include "eventbus.h"
 #include "basethread.h"
+#include "iplatformcontrol.h"
 #include <thread>
 #include <memory>
 #include <log4cpp/Category.hh>
@@ -25,7 +26,8 @@ class KonroHttp : public rmcommon::BaseThread {
     virtual void run() override;
 
 public:
-    explicit KonroHttp(rmcommon::EventBus &eventBus, const char *listen_host = "localhost", int listen_port = 8080);
+    KonroHttp(rmcommon::EventBus &eventBus, pc::IPlatformControl &platformControl,
+              const char *listen_host = "localhost", int listen_port = 8080);
     ~KonroHttp();
 
     virtual void stop() override;
@@ -6,12 +6,18 @@
 #include "proclistener.h"
 #include "policymanager.h"
 #include "workloadmanager.h"
+#include "exittracker.h"
 #include "platformmonitor.h"
 #include "proclistener.h"
 #include "konrohttp.h"
 #include "policytimer.h"
 #include "eventbus.h"
+#include "statejournal.h"
+#include "cgroupwriter.h"
+#include "cgrouphandle.h"
+#include <memory>
 #include <unistd.h>
+#include <sys/resource.h>
 #include <log4cpp/Appender.hh>
 #include <log4cpp/FileAppender.hh>
 #include <log4cpp/OstreamAppender.hh>
@@ -45,6 +51,7 @@ struct KonroManager::KonroManagerImpl {
     PlatformDescription platformDescription;
     wm::ProcListener *procListener;
     wm::WorkloadManager *workloadManager;
+    wm::ExitTracker *exitTracker;
     http::KonroHttp *http;
     rp::PolicyManager *policyManager;
     rp::PolicyTimer *policyTimer;
@@ -53,6 +60,7 @@ struct KonroManager::KonroManagerImpl {
     KonroManagerImpl() {
         procListener = nullptr;
         workloadManager = nullptr;
+        exitTracker = nullptr;
         http = nullptr;
         policyManager = nullptr;
         policyTimer = nullptr;
@@ -62,6 +70,7 @@ struct KonroManager::KonroManagerImpl {
     ~KonroManagerImpl() {
         delete procListener;
         delete workloadManager;
+        delete exitTracker;
         delete http;
         delete policyManager;
         delete policyTimer;
@@ -89,6 +98,15 @@ std::string KonroManager::defaultConfigFilePath()
         return rmcommon::make_path(home, CONFIG_PATH);
 }
 
+std::string KonroManager::defaultStateJournalPath()
+{
+    std::string home = rmcommon::Dir::home();
+    if (home.empty())
+        return STATE_JOURNAL_PATH;
+    else
+        return rmcommon::make_path(home, STATE_JOURNAL_PATH);
+}
+
 void KonroManager::loadConfiguration(std::string configFile)
 {
     if (configFile.empty())
@@ -112,6 +130,12 @@ void KonroManager::loadConfiguration(std::string configFile)
     httpListenPort_ = configRead(config, "http", "listenport", 8080);
     changeContainerCgroup_ = configRead(config, "container", "changecontainercgroup", 1);
     changeKubernetesCgroup_ = configRead(config, "kubernetes", "changekubernetescgroup", 1);
+    cfgProcListenerRcvbufSize_ = configRead(config, "proclistener", "rcvbufsize", 0);
+    cfgProcListenerPidFilter_ = configRead(config, "proclistener", "pidfilter", 1);
+    cfgExitTracking_ = configRead(config, "workloadmanager", "exittracking", std::string("netlink"));
+    cfgRecovery_ = configRead(config, "workloadmanager", "recovery", 0);
+    cfgStateJournal_ = configRead(config, "workloadmanager", "statejournal", defaultStateJournalPath());
+    cfgScopePoolSize_ = configRead(config, "cgroup", "scopepool", 4);
 
     cat_.info("MAIN configuration: policy = %s", cfgPolicyName_.c_str());
     cat_.info("MAIN configuration: policy timer seconds = %d", cfgTimerSeconds_);
@@ -123,19 +147,77 @@ void KonroManager::loadConfiguration(std::string configFile)
               changeContainerCgroup_ ? "true" : "false");
     cat_.info("MAIN configuration: change Kubernetes cgroup = %s",
               changeKubernetesCgroup_ ? "true" : "false");
+    cat_.info("MAIN configuration: ProcListener receive buffer size = %d", cfgProcListenerRcvbufSize_);
+    cat_.info("MAIN configuration: ProcListener pid filter = %s",
+              cfgProcListenerPidFilter_ ? "true" : "false");
+    cat_.info("MAIN configuration: exit tracking = %s", cfgExitTracking_.c_str());
+    cat_.info("MAIN configuration: recovery = %s", cfgRecovery_ ? "true" : "false");
+    cat_.info("MAIN configuration: state journal = %s", cfgStateJournal_.c_str());
+    cat_.info("MAIN configuration: cgroup scope pool size = %d", cfgScopePoolSize_);
+}
+
+void KonroManager::raiseFileLimit()
+{
+    // each managed application keeps open the descriptors of its cgroup
+    struct rlimit rlim;
+    if (getrlimit(RLIMIT_NOFILE, &rlim) == 0 && rlim.rlim_cur < rlim.rlim_max) {
+        rlim_t soft = rlim.rlim_cur;
+        rlim.rlim_cur = rlim.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &rlim) < 0) {
+            cat_.warn("MAIN could not raise the open file limit from %lu", static_cast<unsigned long>(soft));
+        }
+    }
+    cat_.info("MAIN cgroup handles keep up to %zu open files", pc::CgroupHandle::fdBudget());
 }
 
 void KonroManager::run()
 {
+    raiseFileLimit();
     rp::PolicyManager::Policy policy = rp::PolicyManager::getPolicyByName(cfgPolicyName_);
 
-    pimpl_->cgc.cleanup();
+    // in recovery mode the cgroup hierarchy of the previous run is kept
+    if (!cfgRecovery_) {
+        pimpl_->cgc.cleanup();
+    }
     pimpl_->cgc.setChangeContainerCgroup(changeContainerCgroup_);
     pimpl_->cgc.setChangeKubernetesCgroup(changeKubernetesCgroup_);
-    pimpl_->http = new http::KonroHttp(pimpl_->eventBus, httpListenHost_.c_str(), httpListenPort_);
+    pimpl_->http = new http::KonroHttp(pimpl_->eventBus, pimpl_->cgc, httpListenHost_.c_str(), httpListenPort_);
     pimpl_->policyManager = new rp::PolicyManager(pimpl_->eventBus, pimpl_->platformDescription, policy);
     pimpl_->workloadManager = new wm::WorkloadManager(pimpl_->eventBus, pimpl_->cgc);
     pimpl_->procListener = new wm::ProcListener(pimpl_->eventBus);
+    pimpl_->procListener->setReceiveBufferSize(cfgProcListenerRcvbufSize_);
+    pimpl_->procListener->setPidFilter(cfgProcListenerPidFilter_);
+    if (cfgExitTracking_ == "pidfd") {
+        if (wm::ExitTracker::isSupported()) {
+            pimpl_->exitTracker = new wm::ExitTracker(pimpl_->eventBus);
+            // exits of the managed applications come from their pidfds,
+            // exits of their threads still come from the Proc Connector
+            pimpl_->procListener->setExitEvents(false);
+        } else {
+            cat_.warn("MAIN pidfd exit tracking not supported by the kernel, using Proc Connector");
+        }
+    }
+    if (!cfgStateJournal_.empty()) {
+        try {
+            auto journal = std::make_unique<rmcommon::StateJournal>(cfgStateJournal_);
+            // without recovery, the applications of the previous run are gone
+            if (!cfgRecovery_) {
+                journal->rewrite({});
+            }
+            pimpl_->workloadManager->setStateJournal(std::move(journal));
+        } catch (std::runtime_error &e) {
+            cat_.error("MAIN %s", e.what());
+        }
+    }
+    if (cfgRecovery_) {
+        // all the subscribers of AddEvent must exist at this point
+        pimpl_->workloadManager->recover();
+    }
+    // after the recovery, which removes the empty cgroups
+    if (cfgScopePoolSize_ > 0) {
+        cat_.info("MAIN starting scope pool thread");
+        pimpl_->cgc.setScopePoolSize(static_cast<size_t>(cfgScopePoolSize_));
+    }
     pimpl_->platformMonitor = new PlatformMonitor(pimpl_->eventBus, pimpl_->platformDescription, cfgMonitorPeriod_);
     pimpl_->policyTimer = new rp::PolicyTimer(pimpl_->eventBus, cfgTimerSeconds_);
 
@@ -151,6 +233,7 @@ void KonroManager::run()
     // 4. PlatformMonitor runs in a separate thread
     // 5. KonroHttp runs in a separate thread
     // 6. PolicyTimer runs in a separate thread
+    // 7. ExitTracker runs in a separate thread (optional)
 
     cat_.info("MAIN starting WorkloadManager thread");
     pimpl_->workloadManager->start();
@@ -166,6 +249,11 @@ void KonroManager::run()
         cat_.info("MAIN PolicyTimer thread not started (timerseconds is %d)", cfgTimerSeconds_);
     }
 
+    if (pimpl_->exitTracker) {
+        cat_.info("MAIN starting ExitTracker thread");
+        pimpl_->exitTracker->start();
+    }
+
     cat_.info("MAIN starting PlatformMonitor thread");
     pimpl_->platformMonitor->start();
 
@@ -184,6 +272,9 @@ void KonroManager::run()
         pimpl_->policyTimer->stop();
     }
     pimpl_->platformMonitor->stop();
+    if (pimpl_->exitTracker) {
+        pimpl_->exitTracker->stop();
+    }
     pimpl_->workloadManager->stop();
     pimpl_->policyManager->stop();
 
@@ -196,8 +287,15 @@ void KonroManager::run()
         pimpl_->policyTimer->join();
     }
     pimpl_->platformMonitor->join();
+    if (pimpl_->exitTracker) {
+        pimpl_->exitTracker->join();
+    }
     pimpl_->workloadManager->join();
     pimpl_->policyManager->join();
+    // the writes submitted by the policy are completed
+    pc::CgroupWriter::instance().stop();
+    // the empty cgroups of the pool are removed
+    pimpl_->cgc.setScopePoolSize(0);
 
     cat_.info("KONROMANAGER exiting");
 }
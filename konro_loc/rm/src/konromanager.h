@@ -20,10 +20,19 @@ class KonroManager {
     int httpListenPort_;
     bool changeContainerCgroup_;
     bool changeKubernetesCgroup_;
+    int cfgProcListenerRcvbufSize_ = 0; // 0 means "system default"
+    bool cfgProcListenerPidFilter_ = true;
+    std::string cfgExitTracking_;       // "netlink" or "pidfd"
+    bool cfgRecovery_ = false;          // recover the applications of the previous run
+    std::string cfgStateJournal_;       // empty means "no journal"
+    int cfgScopePoolSize_ = 4;          // 0 means "no pool of cgroups"
 
     std::string defaultConfigFilePath();
+    std::string defaultStateJournalPath();
     void setupLogging();
     void loadConfiguration(std::string configFile);
+    /*! Raises the RLIMIT_NOFILE soft limit to the hard limit */
+    void raiseFileLimit();
 public:
     KonroManager(std::string configFile = "");
     ~KonroManager();
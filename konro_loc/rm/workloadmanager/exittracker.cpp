@@ -0,0 +1,183 @@
+#include "exittracker.h"
+#include "exitevent.h"
+#include <system_error>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <linux/cn_proc.h>
+
+// pidfd_open() has no glibc wrapper before 2.36
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+using namespace std;
+
+namespace wm {
+
+/*! epoll key of the stop Wakeup */
+static constexpr uint64_t WAKEUP_KEY = ~uint64_t(0);
+
+static int pidfdOpen(pid_t pid)
+{
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
+
+/*!
+ * The epoll key contains both the pid and the pidfd, so that an event
+ * of a pidfd closed after epoll_wait() returned is recognized as stale
+ */
+static uint64_t makeKey(pid_t pid, int fd)
+{
+    return (static_cast<uint64_t>(pid) << 32) | static_cast<uint32_t>(fd);
+}
+
+ExitTracker::ExitTracker(rmcommon::EventBus &bus) :
+    bus_(bus),
+    cat_(log4cpp::Category::getRoot()),
+    exits_(0)
+{
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+        throw system_error(errno, generic_category(), "ExitTracker: could not create epoll set");
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKEUP_KEY;
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, wakeup_.fd(), &ev) != 0) {
+        int err = errno;
+        close(epollFd_);
+        throw system_error(err, generic_category(), "ExitTracker: could not watch wakeup");
+    }
+    // the handlers are called in the thread of the WorkloadManager
+    bus_.subscribe<ExitTracker, rmcommon::AddEvent, rmcommon::BaseEvent>(this, &ExitTracker::processAddEvent);
+    bus_.subscribe<ExitTracker, rmcommon::RemoveEvent, rmcommon::BaseEvent>(this, &ExitTracker::processRemoveEvent);
+}
+
+ExitTracker::~ExitTracker()
+{
+    for (const auto &p: pidfds_) {
+        close(p.second);
+    }
+    close(epollFd_);
+}
+
+bool ExitTracker::isSupported()
+{
+    int fd = pidfdOpen(getpid());
+    if (fd < 0) {
+        return false;
+    }
+    close(fd);
+    return true;
+}
+
+void ExitTracker::untrack(pid_t pid)
+{
+    auto it = pidfds_.find(pid);
+    if (it != pidfds_.end()) {
+        // closing the pidfd also removes it from the epoll set
+        close(it->second);
+        pidfds_.erase(it);
+    }
+}
+
+void ExitTracker::publishExit(pid_t pid)
+{
+    struct proc_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.what = proc_event::PROC_EVENT_EXIT;
+    ev.event_data.exit.process_pid = pid;
+    ev.event_data.exit.process_tgid = pid;
+    exits_.fetch_add(1, memory_order_relaxed);
+    bus_.publishPooled<rmcommon::ExitEvent>(reinterpret_cast<uint8_t *>(&ev), sizeof(ev));
+}
+
+void ExitTracker::track(pid_t pid)
+{
+    int fd = pidfdOpen(pid);
+    if (fd < 0) {
+        if (errno == ESRCH) {
+            // the process terminated before it could be tracked
+            publishExit(pid);
+        } else {
+            cat_.error("EXITTRACKER could not open pidfd of process %ld: %s", (long)pid, strerror(errno));
+        }
+        return;
+    }
+    lock_guard<mutex> lck(mut_);
+    untrack(pid);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = makeKey(pid, fd);
+    if (epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        cat_.error("EXITTRACKER could not watch pidfd of process %ld: %s", (long)pid, strerror(errno));
+        close(fd);
+        return;
+    }
+    pidfds_[pid] = fd;
+}
+
+void ExitTracker::processAddEvent(std::shared_ptr<const rmcommon::BaseEvent> event)
+{
+    auto addEvent = static_pointer_cast<const rmcommon::AddEvent>(event);
+    track(addEvent->getApp()->getPid());
+    for (const auto &member: addEvent->getMembers()) {
+        track(member->getPid());
+    }
+}
+
+void ExitTracker::processRemoveEvent(std::shared_ptr<const rmcommon::BaseEvent> event)
+{
+    pid_t pid = static_pointer_cast<const rmcommon::RemoveEvent>(event)->getApp()->getPid();
+    lock_guard<mutex> lck(mut_);
+    untrack(pid);
+}
+
+void ExitTracker::run()
+{
+    setThreadName("EXITTRACKER");
+    cat_.info("EXITTRACKER thread started");
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stopped()) {
+        int n = epoll_wait(epollFd_, events, MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cat_.error("EXITTRACKER epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            uint64_t key = events[i].data.u64;
+            if (key == WAKEUP_KEY) {
+                wakeup_.wait(chrono::milliseconds(0));
+                continue;
+            }
+            pid_t pid = static_cast<pid_t>(key >> 32);
+            {
+                lock_guard<mutex> lck(mut_);
+                auto it = pidfds_.find(pid);
+                if (it == pidfds_.end() || makeKey(pid, it->second) != key) {
+                    continue;
+                }
+                untrack(pid);
+            }
+            publishExit(pid);
+        }
+    }
+    cat_.info("EXITTRACKER thread exiting {\"exits\":%lu}", (unsigned long)getExits());
+}
+
+void ExitTracker::stop()
+{
+    BaseThread::stop();
+    wakeup_.notify();
+}
+
+}   // namespace wm
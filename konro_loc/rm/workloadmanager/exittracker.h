@@ -0,0 +1,81 @@
+#ifndef EXITTRACKER_H
+#define EXITTRACKER_H
+
+#include "basethread.h"
+#include "eventbus.h"
+#include "wakeup.h"
+#include "addevent.h"
+#include "removeevent.h"
+#include <log4cpp/Category.hh>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <sys/types.h>
+
+namespace wm {
+
+/*!
+ * \brief Detects the termination of the managed applications with pidfds
+ *
+ * A pidfd is opened for each application added by the WorkloadManager
+ * and all the pidfds are waited on with one epoll set. A pidfd becomes
+ * readable when its process terminates: the ExitTracker then publishes
+ * an ExitEvent, so that the WorkloadManager removes the application
+ * exactly as for an exit reported by the Proc Connector.
+ * \p
+ * Unlike the Proc Connector, the cost is proportional to the number of
+ * managed applications and no exit is lost when the kernel drops
+ * Netlink messages.
+ */
+class ExitTracker : public rmcommon::BaseThread {
+    rmcommon::EventBus &bus_;
+    log4cpp::Category &cat_;
+    int epollFd_;
+    /*! wakes up the thread when stop() is called */
+    rmcommon::Wakeup wakeup_;
+    /*! pidfds of the managed applications, indexed by pid */
+    std::map<pid_t, int> pidfds_;
+    std::mutex mut_;
+    /*! number of exits detected through a pidfd */
+    std::atomic<std::uint64_t> exits_;
+
+    /*! maximum number of events returned by one epoll_wait() call */
+    static constexpr int MAX_EVENTS = 32;
+
+    /*! Opens and watches the pidfd of "pid" */
+    void track(pid_t pid);
+
+    /*! Closes the pidfd of "pid". Called with mut_ held */
+    void untrack(pid_t pid);
+
+    /*! Publishes an ExitEvent for the process */
+    void publishExit(pid_t pid);
+
+    void processAddEvent(std::shared_ptr<const rmcommon::BaseEvent> event);
+    void processRemoveEvent(std::shared_ptr<const rmcommon::BaseEvent> event);
+
+public:
+    /*!
+     * \throws std::system_error if the epoll set cannot be created
+     */
+    explicit ExitTracker(rmcommon::EventBus &bus);
+    virtual ~ExitTracker();
+
+    /*!
+     * Returns true if the kernel supports pidfds (Linux 5.3 and later)
+     */
+    static bool isSupported();
+
+    virtual void run() override;
+
+    virtual void stop() override;
+
+    std::uint64_t getExits() const noexcept {
+        return exits_.load(std::memory_order_relaxed);
+    }
+};
+
+}   // namespace wm
+
+#endif // EXITTRACKER_H
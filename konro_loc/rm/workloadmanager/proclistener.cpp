@@ -2,6 +2,9 @@
 #include "forkevent.h"
 #include "execevent.h"
 #include "exitevent.h"
+#include "resyncevent.h"
+#include "dir.h"
+#include <fstream>
 #include <iostream>
 #include <sstream>
 #include <cstdio>
@@ -11,6 +14,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <vector>
 #include <linux/netlink.h>
 #include <linux/connector.h>
 #include <linux/cn_proc.h>
@@ -28,10 +35,281 @@ namespace wm {
 #define KERNEL_PID                  0
 #define NLMSG_STOP_MESSAGE_TYPE     (NLMSG_MIN_TYPE+12345)
 
+// Offsets of the fields inspected by the BPF filter, from the start
+// of the Netlink message
+#define CN_MSG_OFFSET               NLMSG_LENGTH(0)
+#define PROC_EVENT_OFFSET           (CN_MSG_OFFSET + offsetof(struct cn_msg, data))
+#define WHAT_OFFSET                 (PROC_EVENT_OFFSET + offsetof(struct proc_event, what))
+#define TGID_OFFSET                 (PROC_EVENT_OFFSET + offsetof(struct proc_event, event_data.exec.process_tgid))
+#define CHILD_TGID_OFFSET           (PROC_EVENT_OFFSET + offsetof(struct proc_event, event_data.fork.child_tgid))
+#define EXIT_PID_OFFSET             (PROC_EVENT_OFFSET + offsetof(struct proc_event, event_data.exit.process_pid))
+
+// The filter checks the same offset for the three event types
+static_assert(offsetof(struct proc_event, event_data.fork.parent_tgid) ==
+              offsetof(struct proc_event, event_data.exec.process_tgid));
+static_assert(offsetof(struct proc_event, event_data.exit.process_tgid) ==
+              offsetof(struct proc_event, event_data.exec.process_tgid));
+
+// With more tracked pids the filter only checks the event type
+// (each pid appears in three lists of two instructions)
+#define MAX_FILTERED_PIDS           ((BPF_MAXINSNS - 24) / 6)
+
+static constexpr uint32_t ACCEPT = 0xffffffff;
+static constexpr uint32_t DROP = 0;
+
+/*!
+ * Appends to "prog" the instructions which accept the message if the
+ * accumulator contains one of "pids"; falls through otherwise
+ */
+static void appendPidList(vector<struct sock_filter> &prog, const set<pid_t> &pids)
+{
+    for (pid_t pid: pids) {
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(static_cast<uint32_t>(pid)), 0, 1));
+        prog.push_back(BPF_STMT(BPF_RET | BPF_K, ACCEPT));
+    }
+}
+
+/*!
+ * Appends to "prog" the instructions which drop an exit event if it is
+ * the exit of a process (pid == tgid); falls through for the exit of a
+ * thread. Uses the scratch memory M[0].
+ */
+static void appendThreadExitCheck(vector<struct sock_filter> &prog)
+{
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, EXIT_PID_OFFSET));
+    prog.push_back(BPF_STMT(BPF_ST, 0));
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, TGID_OFFSET));
+    prog.push_back(BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 0));
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_X, 0, 0, 1));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, DROP));
+}
+
+/*!
+ * Builds a classic BPF program which accepts:
+ * - all the Netlink messages which are not Proc Connector events
+ *   (errors, overruns, our STOP message);
+ * - fork, exec and exit events of the processes in "pids", or all
+ *   of them if "filterPids" is false. If "exitEvents" is false, only
+ *   the exits of threads are accepted: the exits of the processes are
+ *   reported by the ExitTracker, but the threads must still be removed
+ *   from their applications.
+ * Everything else is dropped by the kernel.
+ * \p
+ * Events are matched on the thread group id, so that the events of
+ * all the threads of a process are accepted. A fork is accepted if
+ * either the parent (fork) or the child (new thread: the parent is
+ * the parent of the whole process) belongs to a tracked process.
+ * \note BPF loads convert from network byte order, so the constants
+ *       are converted as well.
+ */
+static vector<struct sock_filter> buildFilter(const set<pid_t> &pids, bool filterPids, bool exitEvents)
+{
+    vector<struct sock_filter> prog = {
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, offsetof(struct nlmsghdr, nlmsg_type)),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(NLMSG_DONE), 1, 0),
+        BPF_STMT(BPF_RET | BPF_K, ACCEPT),
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, WHAT_OFFSET),
+    };
+    if (!filterPids || pids.size() > MAX_FILTERED_PIDS) {
+        // forks and execs jump to the final ACCEPT
+        size_t forkJump = prog.size();
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_FORK), 0, 0));
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_EXEC), 0, 0));
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_EXIT), 1, 0));
+        prog.push_back(BPF_STMT(BPF_RET | BPF_K, DROP));
+        if (!exitEvents) {
+            appendThreadExitCheck(prog);
+        }
+        prog.push_back(BPF_STMT(BPF_RET | BPF_K, ACCEPT));
+        prog[forkJump].jt = static_cast<uint8_t>(prog.size() - forkJump - 2);
+        prog[forkJump + 1].jt = static_cast<uint8_t>(prog.size() - forkJump - 3);
+        return prog;
+    }
+    // forks jump to the fork block at the end of the program
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_FORK), 0, 1));
+    size_t jumpToFork = prog.size();
+    prog.push_back(BPF_STMT(BPF_JMP | BPF_JA, 0));
+    // execs jump to the check of the process
+    size_t execJump = prog.size();
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_EXEC), 0, 0));
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(proc_event::PROC_EVENT_EXIT), 1, 0));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, DROP));
+    if (!exitEvents) {
+        appendThreadExitCheck(prog);
+    }
+    prog[execJump].jt = static_cast<uint8_t>(prog.size() - execJump - 1);
+    // exec and exit: the process (thread group) of the thread
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, TGID_OFFSET));
+    appendPidList(prog, pids);
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, DROP));
+    // fork: the process of the new thread or of the parent
+    prog[jumpToFork].k = static_cast<uint32_t>(prog.size() - jumpToFork - 1);
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, CHILD_TGID_OFFSET));
+    appendPidList(prog, pids);
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, TGID_OFFSET));
+    appendPidList(prog, pids);
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, DROP));
+    return prog;
+}
+
 
 ProcListener::ProcListener(rmcommon::EventBus &eventBus) :
     bus_(eventBus),
-    cat_(log4cpp::Category::getRoot()) {
+    nl_socket_(-1),
+    rcvbufSize_(0),
+    receivedMessages_(0),
+    overruns_(0),
+    cat_(log4cpp::Category::getRoot()),
+    pidFilter_(true),
+    exitEvents_(true),
+    wideFilterAttached_(false) {
+    // the handlers are called in the thread of the WorkloadManager
+    bus_.subscribe<ProcListener, rmcommon::AddEvent, rmcommon::BaseEvent>(this, &ProcListener::processAddEvent);
+    bus_.subscribe<ProcListener, rmcommon::RemoveEvent, rmcommon::BaseEvent>(this, &ProcListener::processRemoveEvent);
+}
+
+void ProcListener::attachFilter()
+{
+    if (nl_socket_ == -1) {
+        return;
+    }
+    // the filter without pids does not change with the set
+    bool wide = !pidFilter_ || trackedPids_.size() > MAX_FILTERED_PIDS;
+    if (wide && wideFilterAttached_) {
+        return;
+    }
+    vector<struct sock_filter> prog = buildFilter(trackedPids_, pidFilter_, exitEvents_);
+    struct sock_fprog fprog;
+    fprog.len = static_cast<unsigned short>(prog.size());
+    fprog.filter = prog.data();
+    // the kernel replaces the previous filter atomically
+    if (setsockopt(nl_socket_, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) != 0) {
+        cat_.error("PROCLISTENER could not attach socket filter: %s", strerror(errno));
+    } else {
+        wideFilterAttached_ = wide;
+        cat_.debug("PROCLISTENER socket filter attached (%lu pids, %lu instructions)",
+                   (unsigned long)trackedPids_.size(), (unsigned long)prog.size());
+    }
+}
+
+void ProcListener::processAddEvent(std::shared_ptr<const rmcommon::BaseEvent> event)
+{
+    auto addEvent = static_pointer_cast<const rmcommon::AddEvent>(event);
+    lock_guard<mutex> lck(filterMutex_);
+    bool changed = trackedPids_.insert(addEvent->getApp()->getPid()).second;
+    for (const auto &member: addEvent->getMembers()) {
+        changed |= trackedPids_.insert(member->getPid()).second;
+    }
+    // the filter is rebuilt once for the whole tree
+    if (changed && pidFilter_) {
+        attachFilter();
+    }
+}
+
+void ProcListener::processRemoveEvent(std::shared_ptr<const rmcommon::BaseEvent> event)
+{
+    pid_t pid = static_pointer_cast<const rmcommon::RemoveEvent>(event)->getApp()->getPid();
+    lock_guard<mutex> lck(filterMutex_);
+    if (trackedPids_.erase(pid) > 0 && pidFilter_) {
+        attachFilter();
+    }
+}
+
+bool ProcListener::trackChild(pid_t parentPid, pid_t childPid)
+{
+    if (!pidFilter_) {
+        return false;
+    }
+    lock_guard<mutex> lck(filterMutex_);
+    if (trackedPids_.count(parentPid) == 0 || !trackedPids_.insert(childPid).second) {
+        return false;
+    }
+    attachFilter();
+    return true;
+}
+
+void ProcListener::untrack(pid_t pid)
+{
+    lock_guard<mutex> lck(filterMutex_);
+    if (trackedPids_.erase(pid) > 0 && pidFilter_) {
+        attachFilter();
+    }
+}
+
+/*!
+ * Returns true if the process exists and has not terminated
+ */
+static bool isProcessRunning(pid_t pid)
+{
+    ifstream ifs("/proc/" + to_string(pid) + "/stat");
+    string stat;
+    if (!getline(ifs, stat)) {
+        return false;
+    }
+    // the command name (second field) is enclosed in parentheses
+    size_t pos = stat.rfind(") ");
+    return pos != string::npos && stat.size() > pos + 2 &&
+            stat[pos + 2] != 'Z' && stat[pos + 2] != 'X';
+}
+
+/*!
+ * Returns the children of all the threads of a process
+ */
+static vector<pid_t> readChildren(pid_t pid)
+{
+    vector<pid_t> children;
+    string taskDir = "/proc/" + to_string(pid) + "/task";
+    try {
+        rmcommon::Dir tasks = rmcommon::Dir::localdir(taskDir.c_str());
+        for (const auto &de: tasks) {
+            if (!isdigit(static_cast<unsigned char>(de.name()[0]))) {
+                continue;
+            }
+            ifstream ifs(taskDir + "/" + de.name() + "/children");
+            pid_t child;
+            while (ifs >> child) {
+                children.push_back(child);
+            }
+        }
+    } catch (runtime_error &) {
+        // the process has terminated
+    }
+    return children;
+}
+
+void ProcListener::publishMissedEvents(pid_t pid)
+{
+    using namespace rmcommon;
+
+    struct proc_event ev;
+    memset(&ev, 0, sizeof(ev));
+    uint8_t *data = reinterpret_cast<uint8_t *>(&ev);
+    if (!isProcessRunning(pid)) {
+        if (exitEvents_) {
+            ev.what = proc_event::PROC_EVENT_EXIT;
+            ev.event_data.exit.process_pid = pid;
+            ev.event_data.exit.process_tgid = pid;
+            bus_.publishPooled<ExitEvent>(data, sizeof(ev));
+        }
+        untrack(pid);
+        return;
+    }
+    ev.what = proc_event::PROC_EVENT_EXEC;
+    ev.event_data.exec.process_pid = pid;
+    ev.event_data.exec.process_tgid = pid;
+    bus_.publishPooled<ExecEvent>(data, sizeof(ev));
+    for (pid_t child: readChildren(pid)) {
+        if (trackChild(pid, child)) {
+            memset(&ev, 0, sizeof(ev));
+            ev.what = proc_event::PROC_EVENT_FORK;
+            ev.event_data.fork.parent_pid = pid;
+            ev.event_data.fork.parent_tgid = pid;
+            ev.event_data.fork.child_pid = child;
+            ev.event_data.fork.child_tgid = child;
+            bus_.publishPooled<ForkEvent>(data, sizeof(ev));
+            publishMissedEvents(child);
+        }
+    }
 }
 
 int ProcListener::createNetlinkSocket()
@@ -59,6 +337,23 @@ bool ProcListener::bindNetlinkSocket(int sock, unsigned int pid)
     return true;
 }
 
+void ProcListener::setReceiveBuffer(int sock)
+{
+    if (rcvbufSize_ <= 0) {
+        return;
+    }
+    if (setsockopt(sock, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbufSize_, sizeof(rcvbufSize_)) != 0 &&
+            setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbufSize_, sizeof(rcvbufSize_)) != 0) {
+        cat_.error("PROCLISTENER could not set receive buffer size to %d: %s", rcvbufSize_, strerror(errno));
+        return;
+    }
+    int actual = 0;
+    socklen_t len = sizeof(actual);
+    getsockopt(sock, SOL_SOCKET, SO_RCVBUF, &actual, &len);
+    // the kernel doubles the requested value to account for its bookkeeping
+    cat_.info("PROCLISTENER receive buffer size is %d bytes", actual);
+}
+
 bool ProcListener::sendNetlinkMessage(int sock, void *buf, std::size_t bufsize, unsigned int pid, unsigned int groups)
 {
     sockaddr_nl dstAddr;
@@ -146,36 +441,63 @@ bool ProcListener::sendConnectorNetlinkMessageToThread(int socket, MessageData o
     return sendNetlinkMessage(socket, messageBuffer, nlmsgSize, 0, CN_IDX_PROC);
 }
 
-bool ProcListener::receiveConnectorNetlinkMessage(int socket, void *buffer, size_t bufferSize)
+bool ProcListener::receiveConnectorNetlinkMessages(int socket)
 {
-    // the sender
-    sockaddr_nl srcAddr;
-    memset(&srcAddr, 0, sizeof(srcAddr));
-    socklen_t addrLen = sizeof(srcAddr);
-
-    // Receive the Netlink message into the buffer
-    struct nlmsghdr* nl_hdr = (struct nlmsghdr*)buffer;
+    alignas(struct nlmsghdr) uint8_t buffers[RECV_BATCH_SIZE][RECV_BUFFER_SIZE];
+    struct iovec iov[RECV_BATCH_SIZE];
+    struct mmsghdr msgs[RECV_BATCH_SIZE];
+    memset(msgs, 0, sizeof(msgs));
+    for (size_t i = 0; i < RECV_BATCH_SIZE; ++i) {
+        iov[i].iov_base = buffers[i];
+        iov[i].iov_len = RECV_BUFFER_SIZE;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
-    ssize_t nBytes = recvfrom(socket, buffer, bufferSize, 0,
-                             (sockaddr*)&srcAddr, &addrLen);
-    if (nBytes <= 0) {
+    // Wait for the first datagram, then take the ones already queued
+    int nMsgs = recvmmsg(socket, msgs, RECV_BATCH_SIZE, MSG_WAITFORONE, nullptr);
+    if (nMsgs < 0) {
         errno_ = errno;
+        if (errno == ENOBUFS) {
+            // the socket buffer was full and the kernel dropped messages
+            handleOverrun();
+            return true;
+        } else if (errno == EINTR) {
+            return true;
+        }
         ostringstream os;
-        os << "PROCLISTENER receiveConnectorNetlinkMessage: nBytes is " << nBytes << ", errno is " << errno;
+        os << "PROCLISTENER receiveConnectorNetlinkMessages: recvmmsg returned " << nMsgs << ", errno is " << errno;
         cat_.debug(os.str());
         return false;
     }
+    receivedMessages_.fetch_add(nMsgs, memory_order_relaxed);
+
+    for (int i = 0; i < nMsgs && !stop_; ++i) {
+        if (!processNetlinkDatagram(buffers[i], msgs[i].msg_len)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    //cat_.debug("PROCLISTENER message received by thread from pid %u", (unsigned int)srcAddr.nl_pid);
+bool ProcListener::processNetlinkDatagram(void *buffer, size_t nBytes)
+{
+    struct nlmsghdr* nl_hdr = (struct nlmsghdr*)buffer;
+    int len = static_cast<int>(nBytes);
 
     // While the nl_hdr points to a valid message, keep processing
-    while (NLMSG_OK(nl_hdr, nBytes)) {
+    while (NLMSG_OK(nl_hdr, len)) {
 
         // Handle NOOP and ERROR messages
         unsigned msg_type = nl_hdr->nlmsg_type;
         if (msg_type == NLMSG_NOOP) {
+            nl_hdr = NLMSG_NEXT(nl_hdr, len);
+            continue;
+        } else if (msg_type == NLMSG_OVERRUN) {
+            handleOverrun();
+            nl_hdr = NLMSG_NEXT(nl_hdr, len);
             continue;
-        } else if (msg_type == NLMSG_ERROR || msg_type == NLMSG_OVERRUN) {
+        } else if (msg_type == NLMSG_ERROR) {
             errno = -EINVAL;
             return false;
         } else if (msg_type == NLMSG_STOP_MESSAGE_TYPE) {
@@ -187,7 +509,7 @@ bool ProcListener::receiveConnectorNetlinkMessage(int socket, void *buffer, size
 
         // Call our handler with the inner proc_event struct
         struct cn_msg* msg = (struct cn_msg*)(NLMSG_DATA(nl_hdr));
-        forwardEvent(msg->data, nBytes);
+        forwardEvent(msg->data, msg->len);
 
         // Terminate if this was the last message
         if (msg_type == NLMSG_DONE) {
@@ -195,11 +517,20 @@ bool ProcListener::receiveConnectorNetlinkMessage(int socket, void *buffer, size
         }
 
         // Handle more messages if such exist
-        nl_hdr = NLMSG_NEXT(nl_hdr, nBytes);
+        nl_hdr = NLMSG_NEXT(nl_hdr, len);
     }
     return true;
 }
 
+void ProcListener::handleOverrun()
+{
+    uint64_t overruns = overruns_.fetch_add(1, memory_order_relaxed) + 1;
+    cat_.warn("PROCLISTENER receive buffer overrun, process events were lost "
+              "(%lu overruns, %lu messages received): resynchronizing",
+              (unsigned long)overruns, (unsigned long)getReceivedMessages());
+    bus_.publish(new rmcommon::ResyncEvent(overruns));
+}
+
 void ProcListener::forwardEvent(uint8_t *data, size_t len)
 {
     using namespace rmcommon;
@@ -207,14 +538,27 @@ void ProcListener::forwardEvent(uint8_t *data, size_t len)
     struct proc_event *ev = reinterpret_cast<struct proc_event *>(data);
 
     switch (ev->what) {
-    case proc_event::PROC_EVENT_FORK:
-        bus_.publish(new ForkEvent(data, len));
+    case proc_event::PROC_EVENT_FORK: {
+        // A new process of a tracked parent: the filter is updated before
+        // the WorkloadManager adds the child, as its own events follow
+        pid_t childPid = ev->event_data.fork.child_pid;
+        bool tracked = childPid == ev->event_data.fork.child_tgid &&
+                trackChild(ev->event_data.fork.parent_tgid, childPid);
+        bus_.publishPooled<ForkEvent>(data, len);
+        if (tracked) {
+            publishMissedEvents(childPid);
+        }
         break;
+    }
     case proc_event::PROC_EVENT_EXEC:
-        bus_.publish(new ExecEvent(data, len));
+        bus_.publishPooled<ExecEvent>(data, len);
         break;
     case proc_event::PROC_EVENT_EXIT:
-        bus_.publish(new ExitEvent(data, len));
+        bus_.publishPooled<ExitEvent>(data, len);
+        // a child tracked here may never have been added
+        if (ev->event_data.exit.process_pid == ev->event_data.exit.process_tgid) {
+            untrack(ev->event_data.exit.process_pid);
+        }
         break;
         /* Other event types: PROC_EVENT_NONE, PROC_EVENT_UID, PROC_EVENT_GID,
            PROC_EVENT_SID, PROC_EVENT_PTRACE, PROC_EVENT_COREDUMP */
@@ -227,22 +571,31 @@ void ProcListener::forwardEvent(uint8_t *data, size_t len)
 void ProcListener::run()
 {
     cat_.info("PROCLISTENER running");
-    nl_socket_ = createNetlinkSocket();
-    if (nl_socket_ == -1) {
+    int sock = createNetlinkSocket();
+    if (sock == -1) {
         cat_.error("PROCLISTENER could not create Netlink socket %s", strerror(errno));
         return;
     }
+    {
+        // the filter must be in place before the socket receives events
+        lock_guard<mutex> lck(filterMutex_);
+        nl_socket_ = sock;
+        attachFilter();
+    }
     nl_pid_ = gettid();
     if (!bindNetlinkSocket(nl_socket_, nl_pid_)) {
         cat_.error("PROCLISTENER could not bind Netlink socket %s", strerror(errno));
+        lock_guard<mutex> lck(filterMutex_);
         close(nl_socket_);
         nl_socket_ = -1;
         nl_pid_ = -1;
         return;
     }
+    setReceiveBuffer(nl_socket_);
 
     if (!sendConnectorNetlinkMessageToKernel(nl_socket_, LISTEN)) {
         cat_.error("PROCLISTENER could not register %s", strerror(errno));
+        lock_guard<mutex> lck(filterMutex_);
         close(nl_socket_);
         nl_socket_ = -1;
         nl_pid_ = -1;
@@ -251,10 +604,9 @@ void ProcListener::run()
 
     // main loop
 
-    uint8_t buffer[1024];
     stop_ = false;
     while (!stop_) {
-        if (!receiveConnectorNetlinkMessage(nl_socket_, buffer, sizeof(buffer))) {
+        if (!receiveConnectorNetlinkMessages(nl_socket_)) {
             cat_.error("PROCLISTENER error in receiveMessage: exiting");
             break;
         }
@@ -264,7 +616,8 @@ void ProcListener::run()
 
     sendConnectorNetlinkMessageToKernel(nl_socket_, IGNORE);
 
-    cat_.info("PROCLISTENER exiting");
+    cat_.info("PROCLISTENER exiting (%lu messages received, %lu overruns)",
+              (unsigned long)getReceivedMessages(), (unsigned long)getOverruns());
 }
 
 bool ProcListener::stop()
@@ -2,15 +2,33 @@
 #define PROCLISTENER_H
 
 #include "eventbus.h"
+#include "addevent.h"
+#include "removeevent.h"
 #include <log4cpp/Category.hh>
 #include <cstdint>
 #include <cctype>
 #include <atomic>
+#include <mutex>
+#include <set>
+#include <sys/types.h>
 
 namespace wm {
 
 /*!
  * \brief Interface to the Linux kernel Proc Connector
+ *
+ * A classic BPF filter attached to the Netlink socket makes the kernel
+ * drop the events which Konro does not use, so that the thread wakes up
+ * only for fork, exec and exit events of the managed applications.
+ * The set of managed pids is followed through the AddEvents and
+ * RemoveEvents published by the WorkloadManager; the filter is rebuilt
+ * each time the set changes.
+ * \p
+ * A child forked by a tracked process is tracked by the ProcListener
+ * itself, as soon as the fork event is received, without waiting for the
+ * WorkloadManager. The events of the child which the kernel dropped
+ * before the filter was updated are published afterwards from the
+ * content of /proc (see publishMissedEvents()).
  */
 class ProcListener final {
     enum MessageData {
@@ -22,14 +40,35 @@ class ProcListener final {
     rmcommon::EventBus &bus_;
 
     int errno_;
-    /*! Netlink socket */
+    /*! Netlink socket, protected by filterMutex_ after run() started */
     int nl_socket_;
     /*! unique id used for Netlink communication */
     unsigned int nl_pid_;
     /*! stop flag for the thread */
     std::atomic_bool stop_;
+    /*! requested size of the socket receive buffer (0 = system default) */
+    int rcvbufSize_;
+    /*! number of datagrams received from the kernel */
+    std::atomic<std::uint64_t> receivedMessages_;
+    /*! number of times the kernel dropped messages (receive buffer full) */
+    std::atomic<std::uint64_t> overruns_;
     log4cpp::Category &cat_;
 
+    /*! if true, only the events of the tracked pids reach user space */
+    bool pidFilter_;
+    /*! if false, the exit events of processes are dropped by the kernel */
+    bool exitEvents_;
+    /*! pids of the managed applications */
+    std::set<pid_t> trackedPids_;
+    std::mutex filterMutex_;
+    /*! true if the attached filter does not check the pids */
+    bool wideFilterAttached_;
+
+    /*! maximum number of datagrams received by one recvmmsg() call */
+    static constexpr std::size_t RECV_BATCH_SIZE = 32;
+    /*! size of the buffer of each datagram */
+    static constexpr std::size_t RECV_BUFFER_SIZE = 1024;
+
     /*!
      * \brief Creates a socket for the Netlink protocol
      * \return the socket or -1 in case of error
@@ -45,6 +84,13 @@ class ProcListener final {
      * \return the outcome of the operation
      */
     bool bindNetlinkSocket(int sock, unsigned int pid);
+
+    /*!
+     * Sets the size of the socket receive buffer to rcvbufSize_.
+     * SO_RCVBUFFORCE is tried first, since it can exceed the
+     * net.core.rmem_max limit when Konro runs with CAP_NET_ADMIN.
+     */
+    void setReceiveBuffer(int sock);
     bool sendNetlinkMessage(int sock, void *msg, std::size_t msgsize, unsigned int pid, unsigned int groups);
 
     /*!
@@ -57,11 +103,53 @@ class ProcListener final {
     bool sendConnectorNetlinkMessageToThread(int socket, MessageData op);
 
     /*!
-     * Receives a Netlink message from the kernel (Proc Connector)
+     * Receives a batch of Netlink messages from the kernel (Proc Connector)
+     * with a single recvmmsg() call.
+     * When the kernel reports that messages were dropped, the overrun
+     * is counted and a ResyncEvent is published.
      *
-     * \return the outcome of the operation
+     * \return false in case of unrecoverable error
+     */
+    bool receiveConnectorNetlinkMessages(int socket);
+
+    /*!
+     * Processes the Netlink messages contained in one datagram
+     *
+     * \return false in case of unrecoverable error
      */
-    bool receiveConnectorNetlinkMessage(int socket, void *buffer, std::size_t bufferSize);
+    bool processNetlinkDatagram(void *buffer, std::size_t nBytes);
+
+    /*!
+     * Counts an overrun and asks the receivers to rebuild their state
+     */
+    void handleOverrun();
+
+    /*!
+     * Builds the BPF program and attaches it to the Netlink socket.
+     * Called with filterMutex_ held.
+     */
+    void attachFilter();
+
+    /*!
+     * Adds a new child of a tracked process to the filter
+     * \return false if the parent is not tracked or the child already is
+     */
+    bool trackChild(pid_t parentPid, pid_t childPid);
+
+    /*! Removes a terminated process from the filter */
+    void untrack(pid_t pid);
+
+    /*!
+     * Publishes the events of a newly tracked process which were dropped
+     * by the kernel before the filter was updated: an exit if the process
+     * has terminated; otherwise an exec (the name is read again) and a fork
+     * for each of its children, which are tracked in turn.
+     * Duplicates of the events which did pass the filter are harmless.
+     */
+    void publishMissedEvents(pid_t pid);
+
+    void processAddEvent(std::shared_ptr<const rmcommon::BaseEvent> event);
+    void processRemoveEvent(std::shared_ptr<const rmcommon::BaseEvent> event);
 
     /*!
      * \brief Notifies the WorkloadManager of a new event
@@ -78,6 +166,41 @@ public:
      * \return the outcome of the operation
      */
     bool stop();
+
+    /*!
+     * Sets the size in bytes of the socket receive buffer.
+     * Must be called before run(); 0 keeps the system default.
+     */
+    void setReceiveBufferSize(int bytes) {
+        rcvbufSize_ = bytes;
+    }
+
+    std::uint64_t getReceivedMessages() const noexcept {
+        return receivedMessages_.load(std::memory_order_relaxed);
+    }
+
+    /*!
+     * Enables or disables the filtering of the events by pid.
+     * Must be called before run(); event types not used by Konro
+     * are always filtered.
+     */
+    void setPidFilter(bool enable) {
+        pidFilter_ = enable;
+    }
+
+    /*!
+     * Enables or disables the exit events of processes. Must be called
+     * before run(); disabled when the exits are tracked by the ExitTracker.
+     * The exits of threads are always received, as the ExitTracker only
+     * reports the exits of processes.
+     */
+    void setExitEvents(bool enable) {
+        exitEvents_ = enable;
+    }
+
+    std::uint64_t getOverruns() const noexcept {
+        return overruns_.load(std::memory_order_relaxed);
+    }
 };
 
 }   // namespace wm
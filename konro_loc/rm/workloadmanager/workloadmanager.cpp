@@ -1,11 +1,18 @@
 #include "workloadmanager.h"
 #include "eventbus.h"
 #include "timer.h"
+#include "dir.h"
+#include "appsnapshot.h"
+#include "nspidindex.h"
+#include "placementwaiters.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <string>
-#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <cctype>
 #include <linux/cn_proc.h>
 
 using namespace std;
@@ -13,77 +20,109 @@ using namespace std;
 namespace wm {
 
 /*!
- * Returns the name of a process, given the process PID
+ * Returns the name of an application if it is already known, or an empty
+ * string. Used for logging, so that the fork/exec/exit path does not
+ * read /proc.
+ */
+static string cachedName(const rmcommon::App &app)
+{
+    return app.hasName() ? app.getName() : string();
+}
+
+/*!
+ * Reads the state and the parent pid of a process from /proc/<pid>/stat
  *
- * The name is read from /proc/<pid>/cmdline.
- * If the name is not found, an empty string is returned,
+ * \return false if the process does not exist
  */
-static string getProcessNameByPid(int pid)
+static bool readProcessStat(pid_t pid, char &state, pid_t &ppid)
 {
     ostringstream os;
-    os << "/proc/" << pid << "/cmdline";
-    fstream fs(os.str());
-    string cmdline;
-    if (fs.is_open()) {
-        if (getline(fs, cmdline)) {
-            // get rid of embedded '\0'
-            replace(cmdline.begin(), cmdline.end(), '\0', ' ');
-        }
+    os << "/proc/" << pid << "/stat";
+    ifstream ifs(os.str());
+    string stat;
+    if (!getline(ifs, stat)) {
+        return false;
+    }
+    // the command name (second field) is enclosed in parentheses
+    // and may contain spaces
+    size_t pos = stat.rfind(')');
+    if (pos == string::npos) {
+        return false;
     }
-    return cmdline;
+    istringstream is(stat.substr(pos + 1));
+    return static_cast<bool>(is >> state >> ppid);
 }
 
 /*!
- * Compares by PID two App ("less" function) handled
- * by shared pointers
- *
- * \param lhs the first app to compare
- * \param rhs the second app to compare
- * \return true if pid of lsh is < than pid of rhs
+ * Returns true if the process exists and has not terminated
  */
-static bool appComp(const shared_ptr<rmcommon::App> &lhs, const shared_ptr<rmcommon::App> &rhs)
+static bool isProcessAlive(pid_t pid)
 {
-    return lhs->getPid() < rhs->getPid();
+    char state;
+    pid_t ppid;
+    return readProcessStat(pid, state, ppid) && state != 'Z' && state != 'X';
 }
 
 WorkloadManager::WorkloadManager(rmcommon::EventBus &bus, pc::IPlatformControl &pc) :
     rmcommon::BaseEventReceiver("WORKLOADMANAGER"),
     bus_(bus),
     platformControl_(pc),
-    cat_(log4cpp::Category::getRoot()),
-    apps_(appComp)
+    cat_(log4cpp::Category::getRoot())
 {
     subscribeToEvents();
 }
 
-WorkloadManager::AppSet::iterator WorkloadManager::findAppByPid(pid_t pid)
-{
-    // create a temporary App as key for the search
-    shared_ptr<rmcommon::App> key = rmcommon::App::makeApp(pid, rmcommon::App::AppType::UNKNOWN);
-    return apps_.find(key);
-}
-
-WorkloadManager::AppSet::iterator WorkloadManager::findAppByNsPid(pid_t nspid, rmcommon::namespace_t ns)
+/*!
+ * Returns the live descendants of a process, in breadth-first order.
+ * /proc is scanned once.
+ *
+ * \throws runtime_error if /proc cannot be read
+ */
+static vector<pid_t> findDescendants(pid_t root)
 {
-    AppSet::iterator it;
-    for (it = apps_.begin(); it != apps_.end(); ++it) {
-        shared_ptr<rmcommon::App> app = *it;
-        if (app->getNsPid() == nspid && app->getPidNamespace() == ns) {
-            break;
+    unordered_map<pid_t, vector<pid_t>> children;
+    rmcommon::Dir proc = rmcommon::Dir::localdir("/proc");
+    for (const auto &de: proc) {
+        if (!de.is_dir() || !isdigit(static_cast<unsigned char>(de.name()[0]))) {
+            continue;
+        }
+        pid_t pid = static_cast<pid_t>(strtol(de.name().c_str(), nullptr, 10));
+        char state;
+        pid_t ppid;
+        if (readProcessStat(pid, state, ppid) && state != 'Z' && state != 'X') {
+            children[ppid].push_back(pid);
+        }
+    }
+    vector<pid_t> descendants;
+    vector<pid_t> queue { root };
+    for (size_t i = 0; i < queue.size(); ++i) {
+        auto it = children.find(queue[i]);
+        if (it != children.end()) {
+            for (pid_t child: it->second) {
+                queue.push_back(child);
+                descendants.push_back(child);
+            }
         }
     }
-    return it;
+    return descendants;
 }
 
 void WorkloadManager::subscribeToEvents()
 {
-    using namespace rmcommon;
-
-    bus_.subscribe<WorkloadManager, ForkEvent, BaseEvent>(this, &WorkloadManager::addEvent);
-    bus_.subscribe<WorkloadManager, ExecEvent, BaseEvent>(this, &WorkloadManager::addEvent);
-    bus_.subscribe<WorkloadManager, ExitEvent, BaseEvent>(this, &WorkloadManager::addEvent);
-    bus_.subscribe<WorkloadManager, AddRequestEvent, BaseEvent>(this, &WorkloadManager::addEvent);
-    bus_.subscribe<WorkloadManager, FeedbackRequestEvent, BaseEvent>(this, &WorkloadManager::addEvent);
+    // only the newest feedback of each application is worth forwarding
+    coalesce<rmcommon::FeedbackRequestEvent>([](const rmcommon::FeedbackRequestEvent &event) {
+        return make_pair(event.getPid(), event.getPidNamespace());
+    });
+    // a burst of overruns needs a single resync
+    coalesce<rmcommon::ResyncEvent>([](const rmcommon::ResyncEvent &) {
+        return make_pair(pid_t(0), rmcommon::namespace_t(0));
+    });
+    subscribe(bus_, &WorkloadManager::processForkEvent, LIFECYCLE_LANE);
+    subscribe(bus_, &WorkloadManager::processExecEvent, LIFECYCLE_LANE);
+    subscribe(bus_, &WorkloadManager::processExitEvent, LIFECYCLE_LANE);
+    subscribe(bus_, &WorkloadManager::processAddRequestEvent, LIFECYCLE_LANE);
+    subscribe(bus_, &WorkloadManager::processFeedbackRequestEvent);
+    subscribe(bus_, &WorkloadManager::processResyncEvent, LIFECYCLE_LANE);
 }
 
 void WorkloadManager::add(shared_ptr<rmcommon::App> app)
@@ -94,6 +133,7 @@ void WorkloadManager::add(shared_ptr<rmcommon::App> app)
 
     if (!platformControl_.addApplication(app)) {
         cat_.error("WORKLOADMANAGER could not add application (pid=%ld)", (long)app->getPid());
+        rmcommon::PlacementWaiters::instance().complete(app->getPid(), false);
         return;
     }
 
@@ -104,7 +144,7 @@ void WorkloadManager::add(shared_ptr<rmcommon::App> app)
                (long)micros1.count());
 #endif
 
-    apps_.insert(app);
+    track(app);
 
 #ifdef TIMING
     timer.Restart();
@@ -119,39 +159,65 @@ void WorkloadManager::add(shared_ptr<rmcommon::App> app)
 #endif
 }
 
-void WorkloadManager::remove(pid_t pid)
+void WorkloadManager::addTree(shared_ptr<rmcommon::App> app)
 {
-    AppSet::iterator it = findAppByPid(pid);
-    if (it != end(apps_)) {
-        bus_.publish(new rmcommon::RemoveEvent(*it));
-        platformControl_.removeApplication(*it);
-        apps_.erase(it);
+    vector<shared_ptr<rmcommon::App>> members;
+    try {
+        for (pid_t pid: findDescendants(app->getPid())) {
+            if (!isInKonro(pid)) {
+                // the members have the type of the root; their names are
+                // read on first use, as they may have called exec
+                members.push_back(rmcommon::App::makeApp(pid, app->getAppType()));
+            }
+        }
+    } catch (runtime_error &e) {
+        cat_.error("WORKLOADMANAGER could not scan /proc: %s", e.what());
+    }
+
+    if (!platformControl_.addApplicationTree(app, members)) {
+        cat_.error("WORKLOADMANAGER could not add application tree (pid=%ld)", (long)app->getPid());
+        rmcommon::PlacementWaiters::instance().complete(app->getPid(), false);
+        return;
+    }
+
+    track(app);
+    for (const auto &member: members) {
+        track(member);
     }
+
+    // one event for the whole tree
+    bus_.publish(new rmcommon::AddEvent(app, std::move(members)));
 }
 
-bool WorkloadManager::isInKonro(pid_t pid)
+void WorkloadManager::remove(pid_t pid)
 {
-    return findAppByPid(pid) != end(apps_);
+    shared_ptr<rmcommon::App> app = apps_.erase(pid);
+    if (app) {
+        bus_.publish(new rmcommon::RemoveEvent(app));
+        platformControl_.removeApplication(app);
+        logChange('-', pid, rmcommon::AppSnapshot::instance().remove(pid));
+        if (journal_ && !journal_->recordRemove(pid)) {
+            cat_.warn("WORKLOADMANAGER could not write to journal %s", journal_->path().c_str());
+        }
+        // most of the lines are about applications which exited
+        if (journal_ && journal_->lines() > max(2 * apps_.size(), JOURNAL_MIN_LINES)) {
+            compactJournal();
+        }
+    }
 }
 
-bool WorkloadManager::processEvent(std::shared_ptr<const rmcommon::BaseEvent> event)
+void WorkloadManager::track(shared_ptr<rmcommon::App> app)
 {
-    using namespace rmcommon;
-
-    if (const ForkEvent *ev = dynamic_cast<const ForkEvent *>(event.get())) {
-        processForkEvent(static_pointer_cast<const ForkEvent>(event));
-    } else if (const ExecEvent *ev = dynamic_cast<const ExecEvent *>(event.get())) {
-        processExecEvent(static_pointer_cast<const ExecEvent>(event));
-    } else if (const ExitEvent *ev = dynamic_cast<const ExitEvent *>(event.get())) {
-        processExitEvent(static_pointer_cast<const ExitEvent>(event));
-    } else if (const AddRequestEvent *ev = dynamic_cast<const AddRequestEvent *>(event.get())) {
-        processAddRequestEvent(static_pointer_cast<const AddRequestEvent>(event));
-    } else if (const FeedbackRequestEvent *ev = dynamic_cast<const FeedbackRequestEvent *>(event.get())) {
-        processFeedbackRequestEvent(static_pointer_cast<const FeedbackRequestEvent>(event));
-    } else {
-        cat_.error("WORKLOADMANAGER received wrong event: %s", event->getName().c_str());
+    apps_.insert(app);
+    logChange('+', app->getPid(), rmcommon::AppSnapshot::instance().add(app));
+    if (journal_ && !journal_->recordAdd(*app)) {
+        cat_.warn("WORKLOADMANAGER could not write to journal %s", journal_->path().c_str());
     }
-    return true;
+}
+
+bool WorkloadManager::isInKonro(pid_t pid)
+{
+    return apps_.contains(pid);
 }
 
 void WorkloadManager::processForkEvent(std::shared_ptr<const rmcommon::ForkEvent> event)
@@ -163,40 +229,54 @@ void WorkloadManager::processForkEvent(std::shared_ptr<const rmcommon::ForkEvent
     //       child
     // https://natanyellin.com/posts/understanding-netlink-process-connector-output/
 
-    AppSet::iterator iter = findAppByPid(ev->event_data.fork.parent_pid);
-    bool isParentInKonro = iter != apps_.end();
-    if (isParentInKonro) {
-        // Child app inherits type from parent
-        rmcommon::App::AppType parentType = (*iter)->getAppType();
-        shared_ptr<rmcommon::App> app = rmcommon::App::makeApp(ev->event_data.fork.child_pid, parentType);
-        app->setName(getProcessNameByPid(app->getPid()));
-        add(app);
+    pid_t childPid = ev->event_data.fork.child_pid;
+    pid_t childTgid = ev->event_data.fork.child_tgid;
+    if (childPid != childTgid) {
+        // A new thread: its parent is the parent of the whole process.
+        // The thread stays in the cgroup of its process.
+        shared_ptr<rmcommon::App> app = apps_.find(childTgid);
+        if (app) {
+            app->addThread(childPid);
+            cat_.debug(R"(WORKLOADMANAGER thread {"process_pid":%ld,"thread_id":%ld,"threads":%lu})",
+                       (long)childTgid, (long)childPid,
+                       (unsigned long)app->getThreadCount());
+        }
+        return;
+    }
+
+    rmcommon::NsPidIndex::instance().processFork(ev->event_data.fork.parent_tgid, childPid);
+
+    // the parent process, whichever of its threads called fork
+    shared_ptr<rmcommon::App> parent = apps_.find(ev->event_data.fork.parent_tgid);
+    if (parent) {
+        addChild(childPid, parent);
+        // the child runs the program of the parent until it calls exec
+        string name = cachedName(*parent);
         cat_.info(
             R"(WORKLOADMANAGER fork {"parent_pid":%ld,"parent_name":'%s',"child_pid":%ld,"child_tgid":%ld,"child_name":'%s'})",
-                (long)ev->event_data.fork.parent_pid,
-                getProcessNameByPid(ev->event_data.fork.parent_pid).c_str(),
-                (long)ev->event_data.fork.child_pid,
-                (long)ev->event_data.fork.child_tgid,
-                getProcessNameByPid(ev->event_data.fork.child_pid).c_str()
+                (long)ev->event_data.fork.parent_tgid,
+                name.c_str(),
+                (long)childPid,
+                (long)childTgid,
+                name.c_str()
             );
-        dumpMonitoredApps();
     }
 }
 
 void WorkloadManager::processExecEvent(std::shared_ptr<const rmcommon::ExecEvent> event)
 {
     const struct proc_event *ev = reinterpret_cast<const struct proc_event *>(&event->data_[0]);
-    pid_t pid = ev->event_data.exec.process_pid;
-    AppSet::iterator it = findAppByPid(pid);
-    if (it != apps_.end()) {
-        shared_ptr<rmcommon::App> app = *it;
-        app->setName(getProcessNameByPid(pid));
-
-        cat_.info(R"(WORKLOADMANAGER exec {"process_pid":%ld,"process_name":'%s',"process_tgid":%ld})",
+    // any thread may call exec; the other threads are terminated
+    pid_t pid = ev->event_data.exec.process_tgid;
+    shared_ptr<rmcommon::App> app = apps_.find(pid);
+    if (app) {
+        // the name of the new program is read on first use
+        app->resetName();
+        app->clearThreads();
+
+        cat_.info(R"(WORKLOADMANAGER exec {"process_pid":%ld,"process_tgid":%ld})",
                   (long)ev->event_data.exec.process_pid,
-                  getProcessNameByPid(ev->event_data.exec.process_pid).c_str(),
-                  (long)ev->event_data.exec.process_pid);
-        dumpMonitoredApps();
+                  (long)ev->event_data.exec.process_tgid);
     }
 }
 
@@ -205,52 +285,63 @@ void WorkloadManager::processExitEvent(std::shared_ptr<const rmcommon::ExitEvent
     const struct proc_event *ev = reinterpret_cast<const struct proc_event *>(&event->data_[0]);
 
     pid_t pid = ev->event_data.exit.process_pid;
-    if (isInKonro(pid)) {
+    pid_t tgid = ev->event_data.exit.process_tgid;
+    if (pid != tgid) {
+        // a thread: the process is still running
+        shared_ptr<rmcommon::App> app = apps_.find(tgid);
+        if (app) {
+            app->removeThread(pid);
+        }
+        return;
+    }
+    rmcommon::NsPidIndex::instance().processExit(pid);
+    shared_ptr<rmcommon::App> app = apps_.find(pid);
+    if (app) {
+        // the process is gone: only the cached name is available
+        string name = cachedName(*app);
         remove(pid);
 
         cat_.info(R"(WORKLOADMANAGER exit {"process_pid":%ld,"process_name":%s,"process_tgid":%ld})",
                   (long)ev->event_data.exit.process_pid,
-                  getProcessNameByPid(ev->event_data.exit.process_pid).c_str(),
+                  name.c_str(),
                   (long)ev->event_data.exit.process_tgid);
-        dumpMonitoredApps();
     }
 }
 
 void WorkloadManager::processAddRequestEvent(std::shared_ptr<const rmcommon::AddRequestEvent> event)
 {
     if(!isInKonro(event->getApp()->getPid())) {
-        add(event->getApp());
+        if (event->isTree()) {
+            addTree(event->getApp());
+        } else {
+            add(event->getApp());
+        }
 
-        cat_.info(R"(WORKLOADMANAGER AddRequest {"process_pid":%ld,"process_name":'%s'})",
+        cat_.info(R"(WORKLOADMANAGER AddRequest {"process_pid":%ld,"process_name":'%s',"tree":%s})",
                   (long)event->getApp()->getPid(),
-                  event->getApp()->getName().c_str());
-        dumpMonitoredApps();
+                  event->getApp()->getName().c_str(),
+                  event->isTree() ? "true" : "false");
     } else {
         cat_.error(R"(WORKLOADMANAGER AddRequest from process already in Konro {"process_pid":%ld,"process_name":'%s'})",
                   (long)event->getApp()->getPid(),
                   event->getApp()->getName().c_str());
+        rmcommon::PlacementWaiters::instance().complete(event->getApp()->getPid(), false);
     }
 }
 
 void WorkloadManager::processFeedbackRequestEvent(std::shared_ptr<const rmcommon::FeedbackRequestEvent> event)
 {
-    AppSet::iterator it;
-
-    if (event->getPidNamespace() == 0) {
-        // The process belongs to Konro's namespace
-        it = findAppByPid(event->getPid());
-    } else {
-        it = findAppByNsPid(event->getPid(), event->getPidNamespace());
-    }
-    if (it != end(apps_)) {
-        rmcommon::FeedbackEvent *feedbackEvent = new rmcommon::FeedbackEvent(*it, event->getFeedback());
+    // namespace 0 is Konro's namespace
+    shared_ptr<rmcommon::App> app = apps_.findByNsPid(event->getPid(), event->getPidNamespace());
+    if (app) {
+        rmcommon::FeedbackEvent *feedbackEvent = new rmcommon::FeedbackEvent(app, event->getFeedback());
         // propagate original event time point, in order to track how much time if took
         // to deliver the original message fron HTTP to PolicyManager
         feedbackEvent->setTimePoint(event->getTimePoint());
         bus_.publish(feedbackEvent);
 
         cat_.info(R"(WORKLOADMANAGER FeedbackRequest received {"name":"%s","process_pid":%ld,"namespace":%ld,"feedback_value":%d})",
-                  (*it)->getName().c_str(),
+                  app->getName().c_str(),
                   (long)event->getPid(),
                   (long)event->getPidNamespace(),
                   event->getFeedback());
@@ -262,20 +353,168 @@ void WorkloadManager::processFeedbackRequestEvent(std::shared_ptr<const rmcommon
     }
 }
 
-void WorkloadManager::dumpMonitoredApps()
+void WorkloadManager::addChild(pid_t pid, std::shared_ptr<rmcommon::App> parent, bool inheritName)
 {
-    ostringstream os;
-    os << "WORKLOADMANAGER monitoring PIDS [";
-    bool first = true;
-    for (auto &app: apps_) {
-        if (first)
-            first = false;
-        else
-            os << ",";
-        os << app->getPid();
+    // Child app inherits type from parent
+    shared_ptr<rmcommon::App> app = rmcommon::App::makeApp(pid, parent->getAppType());
+    if (inheritName) {
+        app->setName(*parent);
+    }
+    add(app);
+}
+
+void WorkloadManager::processResyncEvent(std::shared_ptr<const rmcommon::ResyncEvent> event)
+{
+    cat_.warn("WORKLOADMANAGER resync after Proc Connector overrun {\"overruns\":%lu,\"apps\":%lu}",
+              (unsigned long)event->getOverruns(), (unsigned long)apps_.size());
+
+    // 1 - Lost exit events: remove the applications which have terminated
+    vector<pid_t> exited;
+    for (const auto &app: apps_) {
+        if (!isProcessAlive(app->getPid())) {
+            exited.push_back(app->getPid());
+        }
+    }
+    for (pid_t pid: exited) {
+        cat_.info(R"(WORKLOADMANAGER resync exit {"process_pid":%ld})", (long)pid);
+        remove(pid);
+    }
+
+    // 2 - Lost fork events: processes in the cgroups of the managed
+    //     applications. Orphaned children are found here too.
+    vector<shared_ptr<rmcommon::App>> apps(begin(apps_), end(apps_));
+    for (const auto &app: apps) {
+        for (pid_t pid: platformControl_.getApplicationPids(app)) {
+            if (!isInKonro(pid) && isProcessAlive(pid)) {
+                cat_.info(R"(WORKLOADMANAGER resync fork {"parent_pid":%ld,"child_pid":%ld})",
+                          (long)app->getPid(), (long)pid);
+                addChild(pid, app, false);
+            }
+        }
+    }
+
+    // 3 - Lost fork events: children of managed applications which
+    //     are not in a cgroup of their own (e.g. containers)
+    try {
+        rmcommon::Dir proc = rmcommon::Dir::localdir("/proc");
+        for (const auto &de: proc) {
+            if (!de.is_dir() || !isdigit(static_cast<unsigned char>(de.name()[0]))) {
+                continue;
+            }
+            pid_t pid = static_cast<pid_t>(strtol(de.name().c_str(), nullptr, 10));
+            char state;
+            pid_t ppid;
+            if (isInKonro(pid) || !readProcessStat(pid, state, ppid) || state == 'Z') {
+                continue;
+            }
+            shared_ptr<rmcommon::App> parent = apps_.find(ppid);
+            if (parent) {
+                cat_.info(R"(WORKLOADMANAGER resync fork {"parent_pid":%ld,"child_pid":%ld})",
+                          (long)ppid, (long)pid);
+                addChild(pid, parent, false);
+            }
+        }
+    } catch (runtime_error &e) {
+        cat_.error("WORKLOADMANAGER resync: could not scan /proc: %s", e.what());
+    }
+}
+
+void WorkloadManager::setStateJournal(std::unique_ptr<rmcommon::StateJournal> journal)
+{
+    journal_ = std::move(journal);
+}
+
+shared_ptr<rmcommon::App> WorkloadManager::makeRecoveredApp(pid_t pid,
+        const map<pid_t, rmcommon::StateJournal::Entry> &entries) const
+{
+    auto it = entries.find(pid);
+    if (it == entries.end()) {
+        return rmcommon::App::makeApp(pid, rmcommon::App::AppType::STANDALONE);
     }
-    os << "]";
-    cat_.info(os.str());
+    const rmcommon::StateJournal::Entry &e = it->second;
+    return rmcommon::App::makeApp(pid, e.appType, "", e.nsPid, e.ns);
+}
+
+void WorkloadManager::recover()
+{
+    rmcommon::KonroTimer timer;
+    map<pid_t, rmcommon::StateJournal::Entry> entries;
+    if (journal_) {
+        entries = journal_->load();
+    }
+
+    // 1 - Processes still in the cgroups created by Konro
+    for (const auto &group: platformControl_.recoverApplications()) {
+        // the process for which the cgroup was created may have terminated
+        pid_t rootPid = find(begin(group.pids), end(group.pids), group.pid) != end(group.pids)
+                ? group.pid : group.pids.front();
+        if (isInKonro(rootPid)) {
+            continue;
+        }
+        shared_ptr<rmcommon::App> app = makeRecoveredApp(rootPid, entries);
+        app->setCgroupDir(group.cgroupDir);
+        vector<shared_ptr<rmcommon::App>> members;
+        for (pid_t pid: group.pids) {
+            if (pid != rootPid && !isInKonro(pid)) {
+                members.push_back(makeRecoveredApp(pid, entries));
+                members.back()->setCgroupDir(group.cgroupDir);
+            }
+        }
+        track(app);
+        for (const auto &member: members) {
+            track(member);
+        }
+        cat_.info(R"(WORKLOADMANAGER recover {"process_pid":%ld,"members":%lu,"cgroup":"%s"})",
+                  (long)rootPid, (unsigned long)members.size(), group.cgroupDir.c_str());
+        bus_.publish(new rmcommon::AddEvent(app, std::move(members), true));
+    }
+
+    // 2 - Containers left in their own cgroup: recovered only if the
+    //     pid still belongs to the same PID namespace
+    for (const auto &p: entries) {
+        const rmcommon::StateJournal::Entry &e = p.second;
+        if ((e.appType != rmcommon::App::AppType::CONTAINER && e.appType != rmcommon::App::AppType::KUBERNETES)
+                || isInKonro(e.pid) || !isProcessAlive(e.pid)
+                || (e.ns != 0 && rmcommon::getPidNamespace(e.pid) != e.ns)) {
+            continue;
+        }
+        shared_ptr<rmcommon::App> app = makeRecoveredApp(e.pid, entries);
+        if (!platformControl_.addApplication(app)) {
+            continue;
+        }
+        track(app);
+        cat_.info(R"(WORKLOADMANAGER recover {"process_pid":%ld,"cgroup":"%s"})",
+                  (long)e.pid, app->getCgroupDir().c_str());
+        bus_.publish(new rmcommon::AddEvent(app, {}, true));
+    }
+
+    // 3 - Compact the journal
+    if (journal_) {
+        compactJournal();
+    }
+
+    cat_.info(R"(WORKLOADMANAGER recovery completed {"apps":%lu,"microseconds":%ld})",
+              (unsigned long)apps_.size(), (long)timer.Elapsed().count());
+}
+
+void WorkloadManager::compactJournal()
+{
+    vector<rmcommon::StateJournal::Entry> current;
+    current.reserve(apps_.size());
+    for (const auto &app: apps_) {
+        current.push_back({ app->getPid(), app->getAppType(), app->getNsPid(), app->getPidNamespace() });
+    }
+    try {
+        journal_->rewrite(current);
+    } catch (runtime_error &e) {
+        cat_.error("WORKLOADMANAGER %s", e.what());
+    }
+}
+
+void WorkloadManager::logChange(char op, pid_t pid, uint64_t version)
+{
+    cat_.info(R"(WORKLOADMANAGER monitoring %c%ld {"apps":%lu,"version":%lu})",
+              op, (long)pid, (unsigned long)apps_.size(), (unsigned long)version);
 }
 
 }   // namespace wm
@@ -13,9 +13,13 @@
 #include "feedbackevent.h"
 #include "addrequestevent.h"
 #include "feedbackrequestevent.h"
+#include "resyncevent.h"
 #include "namespaces.h"
+#include "appregistry.h"
+#include "statejournal.h"
 #include <log4cpp/Category.hh>
-#include <set>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <sys/types.h>
 
@@ -32,30 +36,21 @@ class WorkloadManager : public rmcommon::BaseEventReceiver {
     pc::IPlatformControl &platformControl_;
     log4cpp::Category &cat_;
 
-    /*! Comparison function for the set */
-    using AppComparator = bool (*)(const std::shared_ptr<rmcommon::App> &lhs,
-                                   const std::shared_ptr<rmcommon::App> &rhs);
+    /*! the managed applications, indexed by pid and namespace pid */
+    rmcommon::AppRegistry<rmcommon::App> apps_;
+    /*! records the managed applications across restarts, may be null */
+    std::unique_ptr<rmcommon::StateJournal> journal_;
 
-    using AppSet = std::set<std::shared_ptr<rmcommon::App>, AppComparator>;
-    AppSet apps_;
-
-    /*!
-     * Returns an iterator to the app with the specified pid from the set
-     * of Konro's applications. If iter == apps_.end(), the app with the
-     * desired PID is not present
-     *
-     * \param pid the pid of the application of interest
-     * \return AppSet::iterator
-     */
-    AppSet::iterator findAppByPid(pid_t pid);
-
-    AppSet::iterator findAppByNsPid(pid_t nspid, rmcommon::namespace_t ns);
+    /*! the journal is not compacted while it is shorter than this */
+    static constexpr std::size_t JOURNAL_MIN_LINES = 1024;
 
     /*!
      * Processes a fork event.
      *
      * If a new process was forked by another process already handled by Konro,
      * the forked process is added to Konro.
+     * New threads (tid != tgid) are not added: they are recorded as members
+     * of the App of their process and stay in its cgroup.
      */
     void processForkEvent(std::shared_ptr<const rmcommon::ForkEvent> event);
 
@@ -71,7 +66,8 @@ class WorkloadManager : public rmcommon::BaseEventReceiver {
      * Processes an exit event.
      *
      * If the exiting process was handled by Konro, the process is removed
-     * from Konro's management.
+     * from Konro's management. The exit of a thread only removes the thread
+     * from its App.
      */
     void processExitEvent(std::shared_ptr<const rmcommon::ExitEvent> event);
 
@@ -94,7 +90,45 @@ class WorkloadManager : public rmcommon::BaseEventReceiver {
      */
     void processFeedbackRequestEvent(std::shared_ptr<const rmcommon::FeedbackRequestEvent> event);
 
-    void dumpMonitoredApps();
+    /*!
+     * Processes a resync request, sent after the kernel dropped
+     * Proc Connector messages.
+     *
+     * Since fork and exit events may have been lost, the managed
+     * applications which are no longer in /proc are removed, and the
+     * processes found in the cgroups of the managed applications or
+     * whose parent is a managed application are added.
+     */
+    void processResyncEvent(std::shared_ptr<const rmcommon::ResyncEvent> event);
+
+    /*!
+     * Adds a process forked by a managed application
+     * \param pid the pid of the new process
+     * \param parent the application which forked the process
+     * \param inheritName true if the process still runs the program of the
+     *                    parent (no exec yet), false to read its name on first use
+     */
+    void addChild(pid_t pid, std::shared_ptr<rmcommon::App> parent, bool inheritName = true);
+
+    /*!
+     * Logs the addition ('+') or removal ('-') of an application.
+     * Only the change is logged: the whole set of applications is
+     * available on demand through the AppSnapshot.
+     */
+    void logChange(char op, pid_t pid, std::uint64_t version);
+
+    /*!
+     * Records a new managed application in the registry, in the
+     * snapshot and in the journal.
+     */
+    void track(std::shared_ptr<rmcommon::App> app);
+
+    /*!
+     * Creates the App of a process managed by a previous execution of
+     * Konro, with the type and namespace recorded in the journal.
+     */
+    std::shared_ptr<rmcommon::App> makeRecoveredApp(pid_t pid,
+            const std::map<pid_t, rmcommon::StateJournal::Entry> &entries) const;
 
     /*!
      * Adds the specified application under the management of Konro.
@@ -102,6 +136,14 @@ class WorkloadManager : public rmcommon::BaseEventReceiver {
      */
     void add(std::shared_ptr<rmcommon::App> app);
 
+    /*!
+     * Adds the specified application and its descendants under the
+     * management of Konro. The descendants share the cgroup of the
+     * application and are announced with a single AddEvent.
+     * \param app the root of the tree
+     */
+    void addTree(std::shared_ptr<rmcommon::App> app);
+
     /*!
      * Removes the specified application from the management of Konro.
      * \param app the application to remove
@@ -121,6 +163,12 @@ class WorkloadManager : public rmcommon::BaseEventReceiver {
      */
     bool isInKonro(pid_t pid);
 
+    /*!
+     * Rewrites the journal with the managed applications only,
+     * dropping the lines of the applications which exited
+     */
+    void compactJournal();
+
     /*!
      * Subscribes to the relevant events from the EventBus.
      */
@@ -129,7 +177,22 @@ class WorkloadManager : public rmcommon::BaseEventReceiver {
 public:
     WorkloadManager(rmcommon::EventBus &bus, pc::IPlatformControl &pc);
 
-    virtual bool processEvent(std::shared_ptr<const rmcommon::BaseEvent> event) override;
+    /*!
+     * Records the additions and removals of applications in the journal,
+     * so that they can be recovered after a restart.
+     */
+    void setStateJournal(std::unique_ptr<rmcommon::StateJournal> journal);
+
+    /*!
+     * Manages again the applications left in the cgroup hierarchy by a
+     * previous execution of Konro, without changing their resources.
+     * The type and namespace of the applications are read from the
+     * journal. An AddEvent marked as recovered is published for each
+     * application (or group of processes sharing a cgroup).
+     * \p
+     * Must be called before the thread is started.
+     */
+    void recover();
 };
 
 }   // namespace wm
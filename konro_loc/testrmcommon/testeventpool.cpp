@@ -0,0 +1,169 @@
+#include "eventbus.h"
+#include "eventpool.h"
+#include "forkevent.h"
+#include "mpscqueue.h"
+#include "timer.h"
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <vector>
+
+#define TEST_OK 0
+#define TEST_FAILED 1
+
+using namespace std;
+using namespace rmcommon;
+
+/*!
+ * Released blocks must be reused before the pool grows
+ */
+static int test_blockPoolReuse() {
+  BlockPool pool(64, 16);
+  vector<void *> blocks;
+  for (int i = 0; i < 16; ++i)
+    blocks.push_back(pool.allocate());
+  if (pool.capacity() != 16)
+    return TEST_FAILED;
+  set<void *> unique(blocks.begin(), blocks.end());
+  if (unique.size() != blocks.size())
+    return TEST_FAILED;
+  for (void *p : blocks)
+    pool.deallocate(p);
+  for (int i = 0; i < 16; ++i) {
+    if (unique.count(pool.allocate()) == 0)
+      return TEST_FAILED;
+  }
+  if (pool.capacity() != 16)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Events allocated by one thread and released by another one
+ */
+static int test_crossThreadRelease() {
+  MpscQueue<shared_ptr<const ForkEvent>> queue;
+  struct proc_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.what = proc_event::PROC_EVENT_FORK;
+  constexpr int NUM_EVENTS = 100000;
+  atomic<long> sum(0);
+
+  thread consumer([&queue, &sum] {
+    vector<shared_ptr<const ForkEvent>> batch;
+    int received = 0;
+    while (received < NUM_EVENTS) {
+      received += queue.waitAndDrain(batch, chrono::milliseconds(1000));
+      for (auto &e : batch) {
+        const struct proc_event *pe =
+            reinterpret_cast<const struct proc_event *>(&e->data_[0]);
+        sum += pe->event_data.fork.child_pid;
+      }
+      batch.clear();
+    }
+  });
+  long expected = 0;
+  for (int i = 0; i < NUM_EVENTS; ++i) {
+    ev.event_data.fork.child_pid = i;
+    expected += i;
+    queue.push(allocate_shared<ForkEvent>(
+        PoolAllocator<ForkEvent>(), reinterpret_cast<uint8_t *>(&ev), sizeof(ev)));
+  }
+  consumer.join();
+  return sum == expected ? TEST_OK : TEST_FAILED;
+}
+
+class ForkConsumer {
+  MpscQueue<shared_ptr<const BaseEvent>> queue_;
+  thread thread_;
+  atomic_bool stop_;
+
+public:
+  ForkConsumer() : stop_(false) {
+    thread_ = thread([this] {
+      vector<shared_ptr<const BaseEvent>> batch;
+      while (!stop_ || !queue_.empty()) {
+        queue_.waitAndDrain(batch, chrono::milliseconds(10));
+        batch.clear();
+      }
+    });
+  }
+  ~ForkConsumer() {
+    stop_ = true;
+    thread_.join();
+  }
+  void addEvent(shared_ptr<const BaseEvent> event) { queue_.push(event); }
+};
+
+static long threadCpuMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1000000L + ts.tv_nsec / 1000L;
+}
+
+/*!
+ * Publishes "numEvents" ForkEvents at "rate" events per second
+ * (or as fast as possible if rate is 0), as the ProcListener does,
+ * to a receiver running in another thread.
+ * Returns the CPU time in microseconds spent by the publisher thread.
+ */
+static long publishForkEvents(bool pooled, int rate, int numEvents) {
+  EventBus bus;
+  ForkConsumer consumer;
+  bus.subscribe<ForkConsumer, ForkEvent, BaseEvent>(&consumer,
+                                                    &ForkConsumer::addEvent);
+  struct proc_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.what = proc_event::PROC_EVENT_FORK;
+  uint8_t *data = reinterpret_cast<uint8_t *>(&ev);
+
+  KonroTimer::TimePoint start = KonroTimer::now();
+  long cpuStart = threadCpuMicros();
+  for (int i = 0; i < numEvents; ++i) {
+    if (rate > 0) {
+      // pace the events in bursts of 100
+      if (i % 100 == 0) {
+        this_thread::sleep_until(start + chrono::microseconds(
+                                             (long)i * 1000000L / rate));
+      }
+    }
+    ev.event_data.fork.child_pid = i;
+    if (pooled)
+      bus.publishPooled<ForkEvent>(data, sizeof(ev));
+    else
+      bus.publish(new ForkEvent(data, sizeof(ev)));
+  }
+  return threadCpuMicros() - cpuStart;
+}
+
+static int benchmark_eventChurn() {
+  constexpr int RATE = 100000;
+  constexpr int NUM_EVENTS = 100000;
+
+  long newMicros = publishForkEvents(false, RATE, NUM_EVENTS);
+  long pooledMicros = publishForkEvents(true, RATE, NUM_EVENTS);
+  cout << "benchmark " << NUM_EVENTS << " ForkEvents at " << RATE
+       << " events/s, publisher CPU time: new " << newMicros << " us, pooled "
+       << pooledMicros << " us" << endl;
+
+  newMicros = publishForkEvents(false, 0, NUM_EVENTS * 10);
+  pooledMicros = publishForkEvents(true, 0, NUM_EVENTS * 10);
+  cout << "benchmark " << NUM_EVENTS * 10
+       << " ForkEvents unpaced, publisher CPU time: new " << newMicros
+       << " us, pooled " << pooledMicros << " us" << endl;
+  return TEST_OK;
+}
+
+int main() {
+  if (test_blockPoolReuse() != TEST_OK)
+    return TEST_FAILED;
+  if (test_crossThreadRelease() != TEST_OK)
+    return TEST_FAILED;
+  if (benchmark_eventChurn() != TEST_OK)
+    return TEST_FAILED;
+
+  return TEST_OK;
+}
@@ -1,6 +1,28 @@
 #include "cpusetvector.h"
+#include "eventbus.h"
+#include "eventdispatcher.h"
+#include "eventcoalescer.h"
+#include "latencystats.h"
+#include "processnames.h"
+#include "app.h"
+#include "appregistry.h"
+#include "appsnapshot.h"
+#include "processtrees.h"
+#include "statejournal.h"
+#include "nspidindex.h"
+#include "placementwaiters.h"
+#include <sstream>
+#include "timerevent.h"
+#include "feedbackrequestevent.h"
+#include <atomic>
 #include <cstddef>
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include <csignal>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #define TEST_OK 0
 #define TEST_FAILED 1
@@ -90,6 +112,346 @@ static int test_toString() {
   return TEST_OK;
 }
 
+struct TestEventA {
+  int value;
+};
+struct TestEventB {};
+
+class TestSubscriber {
+public:
+  int total = 0;
+  int count = 0;
+  void onA(std::shared_ptr<const TestEventA> event) { total += event->value; }
+  void onB(std::shared_ptr<const TestEventB>) { ++count; }
+};
+
+static int test_eventBus() {
+  EventBus bus;
+  TestSubscriber s1, s2;
+
+  // no subscribers yet
+  bus.publish(new TestEventA{1});
+
+  bus.subscribe<TestSubscriber, TestEventA>(&s1, &TestSubscriber::onA);
+  bus.publish(new TestEventA{2});
+  bus.subscribe<TestSubscriber, TestEventA>(&s2, &TestSubscriber::onA);
+  bus.subscribe<TestSubscriber, TestEventB>(&s2, &TestSubscriber::onB);
+  bus.publish(new TestEventA{3});
+  bus.publish(new TestEventB());
+
+  if (s1.total != 5 || s2.total != 3 || s1.count != 0 || s2.count != 1)
+    return TEST_FAILED;
+  if (eventTypeId<TestEventA>() == eventTypeId<TestEventB>() ||
+      eventTypeId<TestEventA>() != eventTypeId<const TestEventA>())
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+class TestReceiver {
+public:
+  int timers = 0;
+  void onTimer(std::shared_ptr<const TimerEvent>) { ++timers; }
+};
+
+static int test_eventDispatcher() {
+  EventDispatcher dispatcher;
+  TestReceiver receiver;
+  dispatcher.registerHandler(&receiver, &TestReceiver::onTimer);
+
+  std::shared_ptr<const BaseEvent> timer = std::make_shared<TimerEvent>();
+  std::shared_ptr<const BaseEvent> feedback =
+      std::make_shared<FeedbackRequestEvent>(1, 0, 50);
+  if (!dispatcher.dispatch(timer) || !dispatcher.dispatch(timer))
+    return TEST_FAILED;
+  if (dispatcher.dispatch(feedback))
+    return TEST_FAILED;
+  if (receiver.timers != 2 || dispatcher.getUnhandledEvents() != 1)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Feedbacks for the same application must be merged while one of them
+ * is pending; the pending one is then replaced by the newest value
+ */
+static int test_eventCoalescer() {
+  EventCoalescer coalescer;
+  coalescer.coalesce<FeedbackRequestEvent>([](const FeedbackRequestEvent &e) {
+    return make_pair(e.getPid(), e.getPidNamespace());
+  });
+
+  std::shared_ptr<const BaseEvent> f1 =
+      std::make_shared<FeedbackRequestEvent>(1, 0, 10);
+  std::shared_ptr<const BaseEvent> f2 =
+      std::make_shared<FeedbackRequestEvent>(1, 0, 20);
+  std::shared_ptr<const BaseEvent> f3 =
+      std::make_shared<FeedbackRequestEvent>(1, 7, 30);
+  std::shared_ptr<const BaseEvent> timer = std::make_shared<TimerEvent>();
+  if (!coalescer.offer(f1) || coalescer.offer(f2) || !coalescer.offer(f3))
+    return TEST_FAILED;
+  if (!coalescer.offer(timer) || !coalescer.offer(timer))
+    return TEST_FAILED;
+  if (coalescer.getCoalescedEvents() != 1)
+    return TEST_FAILED;
+  if (coalescer.take(f1) != f2 || coalescer.take(f3) != f3 ||
+      coalescer.take(timer) != timer)
+    return TEST_FAILED;
+  // nothing is pending anymore
+  if (!coalescer.offer(f1) || coalescer.take(f1) != f1)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Percentiles must be within the resolution of the histogram
+ */
+static int test_latencyHistogram() {
+  LatencyHistogram h;
+  if (h.count() != 0 || h.percentile(99.0) != 0)
+    return TEST_FAILED;
+  for (uint64_t v = 1; v <= 10000; ++v)
+    h.record(v);
+  if (h.count() != 10000 || h.max() != 10000 || h.mean() != 5000.5)
+    return TEST_FAILED;
+  for (double p : {50.0, 90.0, 99.0, 99.9}) {
+    double expected = p * 100;
+    double actual = static_cast<double>(h.percentile(p));
+    if (actual < expected || actual > expected * 1.0625)
+      return TEST_FAILED;
+  }
+  if (h.percentile(100.0) != 10000)
+    return TEST_FAILED;
+  h.record(UINT64_MAX);
+  if (h.max() != UINT64_MAX || h.percentile(100.0) != UINT64_MAX)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Names are interned and read from /proc only when first used
+ */
+static int test_processNames() {
+  if (ProcessNames::intern("konro") != ProcessNames::intern(string("konro")))
+    return TEST_FAILED;
+  ProcessNames::Name self = ProcessNames::read(getpid());
+  if (self->empty() || self != ProcessNames::read(getpid()))
+    return TEST_FAILED;
+  auto parent = App::makeApp(getpid(), App::AppType::STANDALONE);
+  if (parent->hasName())
+    return TEST_FAILED;
+  if (parent->getNamePtr() != self || !parent->hasName())
+    return TEST_FAILED;
+  auto child = App::makeApp(getpid() + 1, App::AppType::STANDALONE);
+  child->setName(*parent);
+  if (child->getNamePtr() != self)
+    return TEST_FAILED;
+  child->resetName();
+  if (child->hasName())
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Lookups by pid and by namespace pid must survive removals
+ */
+static int test_appRegistry() {
+  AppRegistry<App> apps(16);
+  for (pid_t pid = 100; pid < 200; ++pid)
+    apps.insert(App::makeApp(pid, App::AppType::STANDALONE));
+  auto container = App::makeApp(500, App::AppType::CONTAINER, "", 1, 4026531836UL);
+  if (!apps.insert(container) || apps.insert(App::makeApp(500, App::AppType::UNKNOWN)))
+    return TEST_FAILED;
+  for (pid_t pid = 100; pid < 200; pid += 2) {
+    if (!apps.erase(pid))
+      return TEST_FAILED;
+  }
+  if (apps.size() != 51 || apps.erase(100) || apps.find(100))
+    return TEST_FAILED;
+  for (pid_t pid = 101; pid < 200; pid += 2) {
+    if (!apps.find(pid) || apps.find(pid)->getPid() != pid)
+      return TEST_FAILED;
+  }
+  if (apps.findByNsPid(1, 4026531836UL) != container || apps.findByNsPid(1, 1))
+    return TEST_FAILED;
+  if (apps.findByNsPid(101, 0)->getPid() != 101)
+    return TEST_FAILED;
+  apps.erase(500);
+  if (apps.findByNsPid(1, 4026531836UL))
+    return TEST_FAILED;
+  size_t n = 0;
+  for (const auto &app : apps)
+    n += apps.contains(app->getPid());
+  return n == apps.size() ? TEST_OK : TEST_FAILED;
+}
+
+/*!
+ * When the root of a tree exits first, a member owns the tree until
+ * the last process exits
+ */
+static int test_processTrees_rootExitsFirst() {
+  ProcessTrees trees;
+  trees.add(10, {App::makeApp(11, App::AppType::STANDALONE),
+                 App::makeApp(12, App::AppType::STANDALONE)});
+  if (trees.ownerOf(11) != 10 || trees.ownerOf(12) != 10 || trees.ownerOf(10) != 0)
+    return TEST_FAILED;
+  auto heir = trees.promote(10);
+  if (!heir || heir->getPid() == 10 || trees.memberCount(heir->getPid()) != 1)
+    return TEST_FAILED;
+  pid_t other = heir->getPid() == 11 ? 12 : 11;
+  if (trees.ownerOf(other) != heir->getPid() || trees.ownerOf(heir->getPid()) != 0)
+    return TEST_FAILED;
+  if (!trees.removeMember(other) || trees.removeMember(other))
+    return TEST_FAILED;
+  // the last process of the tree: the application can be released
+  if (trees.promote(heir->getPid()) || trees.memberCount(heir->getPid()) != 0)
+    return TEST_FAILED;
+  return trees.promote(20) ? TEST_FAILED : TEST_OK;
+}
+
+/*!
+ * Every change of the snapshot increments its version
+ */
+static int test_appSnapshot() {
+  AppSnapshot &snapshot = AppSnapshot::instance();
+  uint64_t v0 = snapshot.version();
+  if (snapshot.add(App::makeApp(10, App::AppType::STANDALONE, "a \"b\"")) != v0 + 1)
+    return TEST_FAILED;
+  if (snapshot.add(App::makeApp(10, App::AppType::STANDALONE)) != v0 + 1)
+    return TEST_FAILED;
+  ostringstream os;
+  snapshot.printOnOstream(os);
+  string expected = "{\"version\":" + to_string(v0 + 1) +
+      ",\"apps\":[{\"pid\":10,\"type\":\"STANDALONE\",\"name\":\"a \\\"b\\\"\"}]}";
+  if (os.str() != expected)
+    return TEST_FAILED;
+  if (snapshot.remove(10) != v0 + 2 || snapshot.remove(10) != v0 + 2 || snapshot.size() != 0)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * The journal must survive a torn last line and a rewrite
+ */
+static int test_stateJournal() {
+  string path = "/tmp/testrmcommon-" + to_string(getpid()) + ".journal";
+  int result = TEST_FAILED;
+  {
+    StateJournal journal(path);
+    journal.recordAdd(*App::makeApp(10, App::AppType::STANDALONE));
+    journal.recordAdd(*App::makeApp(11, App::AppType::CONTAINER, "", 1, 4026531836UL));
+    journal.recordAdd(*App::makeApp(12, App::AppType::INTEGRATED));
+    journal.recordRemove(10);
+    ofstream(path, ios::app) << "+ 13 STANDALONE";
+    auto entries = journal.load();
+    if (journal.lines() == 4 && entries.size() == 2 && entries.count(11) && entries.count(12) &&
+        entries[11].appType == App::AppType::CONTAINER && entries[11].nsPid == 1 &&
+        entries[11].ns == 4026531836UL) {
+      journal.rewrite({entries[12]});
+      journal.recordAdd(*App::makeApp(14, App::AppType::KUBERNETES));
+      entries = journal.load();
+      if (journal.lines() == 2 && entries.size() == 2 && entries.count(12) &&
+          entries[14].appType == App::AppType::KUBERNETES)
+        result = TEST_OK;
+    }
+  }
+  unlink(path.c_str());
+  return result;
+}
+
+/*!
+ * Pids in Konro's namespace and in unknown namespaces are not changed
+ */
+static int test_nsPidIndex() {
+  NsPidIndex &index = NsPidIndex::instance();
+  if (index.map(1234, 0) != 1234 || index.map(1, getSelfPidNamespace()) != 1)
+    return TEST_FAILED;
+  // namespace 1 does not exist: /proc is scanned and the pid is not found
+  if (index.map(77, 1) != 77)
+    return TEST_FAILED;
+  index.processExit(getpid());
+  return TEST_OK;
+}
+
+/*!
+ * The first process of a new PID namespace has pid 1 in it: the index
+ * must scan /proc and return its pid in our namespace
+ */
+static int test_nsPidIndex_newNamespace() {
+  int fds[2];
+  if (pipe(fds) != 0)
+    return TEST_FAILED;
+  pid_t child = fork();
+  if (child == 0) {
+    // a new user namespace allows an unprivileged process to unshare
+    pid_t init = -1;
+    if (unshare(CLONE_NEWUSER | CLONE_NEWPID) == 0) {
+      init = fork();
+      if (init == 0) {
+        pause();
+        _exit(0);
+      }
+    }
+    if (write(fds[1], &init, sizeof(init)) != sizeof(init) || init < 0)
+      _exit(1);
+    waitpid(init, nullptr, 0);
+    _exit(0);
+  }
+  close(fds[1]);
+  pid_t init = -1;
+  if (read(fds[0], &init, sizeof(init)) != sizeof(init))
+    init = -1;
+  close(fds[0]);
+  int result = TEST_OK;
+  if (init > 0) {
+    namespace_t ns = getPidNamespace(init);
+    if (ns == getSelfPidNamespace() || NsPidIndex::instance().map(1, ns) != init)
+      result = TEST_FAILED;
+    kill(init, SIGKILL);
+  } else {
+    cout << "test_nsPidIndex_newNamespace: cannot create a PID namespace, skipped" << endl;
+  }
+  waitpid(child, nullptr, 0);
+  return result;
+}
+
+/*
+ * A waiter is woken up by complete(); complete() without a waiter and
+ * wait() after a timeout do nothing
+ */
+static int test_placementWaiters() {
+  PlacementWaiters &waiters = PlacementWaiters::instance();
+  waiters.complete(100, true);
+  if (waiters.wait(100, chrono::milliseconds(0)))
+    return TEST_FAILED;
+  waiters.expect(101);
+  thread t([&waiters] { waiters.complete(101, true); });
+  bool placed = waiters.wait(101, chrono::seconds(5));
+  t.join();
+  if (!placed)
+    return TEST_FAILED;
+  waiters.expect(102);
+  waiters.complete(102, false);
+  if (waiters.wait(102, chrono::seconds(5)))
+    return TEST_FAILED;
+  waiters.expect(103);
+  if (waiters.wait(103, chrono::milliseconds(10)))
+    return TEST_FAILED;
+  // two waiters for the same pid: the one which wakes up second
+  // finds no waiter
+  waiters.expect(104);
+  atomic<int> placedCount(0);
+  auto waitPlaced = [&waiters, &placedCount] {
+    if (waiters.wait(104, chrono::seconds(5)))
+      ++placedCount;
+  };
+  thread t1(waitPlaced), t2(waitPlaced);
+  this_thread::sleep_for(chrono::milliseconds(20));
+  waiters.complete(104, true);
+  t1.join();
+  t2.join();
+  return placedCount == 1 ? TEST_OK : TEST_FAILED;
+}
+
 int main() {
   if (test_toSet1() != TEST_OK)
     return TEST_FAILED;
@@ -103,6 +465,30 @@ int main() {
     return TEST_FAILED;
   if (test_toString() != TEST_OK)
     return TEST_FAILED;
+  if (test_eventBus() != TEST_OK)
+    return TEST_FAILED;
+  if (test_eventDispatcher() != TEST_OK)
+    return TEST_FAILED;
+  if (test_eventCoalescer() != TEST_OK)
+    return TEST_FAILED;
+  if (test_latencyHistogram() != TEST_OK)
+    return TEST_FAILED;
+  if (test_processNames() != TEST_OK)
+    return TEST_FAILED;
+  if (test_appRegistry() != TEST_OK)
+    return TEST_FAILED;
+  if (test_processTrees_rootExitsFirst() != TEST_OK)
+    return TEST_FAILED;
+  if (test_appSnapshot() != TEST_OK)
+    return TEST_FAILED;
+  if (test_stateJournal() != TEST_OK)
+    return TEST_FAILED;
+  if (test_nsPidIndex() != TEST_OK)
+    return TEST_FAILED;
+  if (test_nsPidIndex_newNamespace() != TEST_OK)
+    return TEST_FAILED;
+  if (test_placementWaiters() != TEST_OK)
+    return TEST_FAILED;
 
   return TEST_OK;
 }
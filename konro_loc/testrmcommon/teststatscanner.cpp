@@ -0,0 +1,456 @@
+#include "statscanner.h"
+#include "timer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define TEST_OK 0
+#define TEST_FAILED 1
+
+using namespace std;
+using namespace rmcommon;
+
+// Counts the allocations of the whole program
+static atomic<long> numAllocations(0);
+
+void *operator new(size_t size) {
+  ++numAllocations;
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static const char cpuStatText[] = "usage_usec 1159803131\n"
+                                  "user_usec 1048414293\n"
+                                  "system_usec 111388837\n"
+                                  "nice_usec 0\n"
+                                  "core_sched.force_idle_usec 0\n"
+                                  "nr_periods 100\n"
+                                  "nr_throttled 7\n"
+                                  "throttled_usec 123456\n"
+                                  "nr_bursts 0\n"
+                                  "burst_usec 0\n";
+
+static const char *memoryStatKeys[] = {
+    "anon",          "file",          "kernel",
+    "kernel_stack",  "pagetables",    "sec_pagetables",
+    "percpu",        "sock",          "vmalloc",
+    "shmem",         "zswap",         "zswapped",
+    "file_mapped",   "file_dirty",    "file_writeback",
+    "swapcached",    "anon_thp",      "file_thp",
+    "shmem_thp",     "inactive_anon", "active_anon",
+    "inactive_file", "active_file",   "unevictable",
+    "slab_reclaimable", "slab_unreclaimable", "slab",
+    "workingset_refault_anon", "workingset_refault_file",
+    "workingset_activate_anon", "workingset_activate_file",
+    "workingset_restore_anon", "workingset_restore_file",
+    "workingset_nodereclaim", "pgscan", "pgsteal", "pgscan_kswapd",
+    "pgscan_direct", "pgsteal_kswapd", "pgsteal_direct", "pgfault",
+    "pgmajfault", "pgrefill", "pgactivate", "pgdeactivate", "pglazyfree",
+    "pglazyfreed", "thp_fault_alloc", "thp_collapse_alloc"};
+
+static string makeMemoryStat(uint64_t seed) {
+  ostringstream os;
+  uint64_t value = seed;
+  for (const char *key : memoryStatKeys) {
+    os << key << ' ' << value << '\n';
+    value += 4096;
+  }
+  return os.str();
+}
+
+static string makeIoStat(uint64_t seed) {
+  ostringstream os;
+  os << "259:0 rbytes=" << seed << " wbytes=" << seed * 2 << " rios=" << seed / 7
+     << " wios=" << seed / 5 << " dbytes=0 dios=0\n";
+  os << "8:0 rbytes=" << seed * 3 << " wbytes=" << seed * 4 << " rios=11"
+     << " wios=12 dbytes=13 dios=14\n";
+  return os.str();
+}
+
+/*!
+ * A /proc/stat with "numPu" processing units, with its long "intr" line
+ */
+static string makeProcStat(int numPu) {
+  ostringstream os;
+  os << "cpu  104841 10 11129 412418 179 0 9 5487 0 0\n";
+  for (int n = 0; n < numPu; ++n) {
+    os << "cpu" << n << ' ' << 104841 + n << " 0 " << 11129 + n << ' '
+       << 412418 + n << " 179 0 9 5487 0 0\n";
+  }
+  os << "intr 533453";
+  for (int n = 0; n < 1024; ++n)
+    os << ' ' << n % 3;
+  os << "\nctxt 1071239\nbtime 1760716800\nprocesses 4711\n"
+        "procs_running 2\nprocs_blocked 0\nsoftirq 92014 0 1 2 3 4 5 6 7 8\n";
+  return os.str();
+}
+
+static int test_parseNumber() {
+  uint64_t value = 0;
+  if (!parseNumber("12345", value) || value != 12345)
+    return TEST_FAILED;
+  if (!parseNumber("18446744073709551615", value) || value != UINT64_MAX)
+    return TEST_FAILED;
+  if (parseNumber("", value) || parseNumber("12a", value) ||
+      parseNumber("-1", value) || parseNumber(" 1", value) ||
+      parseNumber("18446744073709551616", value))
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+static int test_scanner() {
+  StatScanner sc("alfa  1\t2\n\nbeta=3\ngamma");
+  string_view key;
+  uint64_t value;
+  if (!sc.nextLine() || sc.token() != "alfa")
+    return TEST_FAILED;
+  if (!sc.number(value) || value != 1 || !sc.number(value) || value != 2)
+    return TEST_FAILED;
+  if (!sc.token().empty())
+    return TEST_FAILED;
+  // the empty line is skipped
+  if (!sc.nextLine() || !sc.keyValue('=', key, value) || key != "beta" ||
+      value != 3)
+    return TEST_FAILED;
+  if (!sc.nextLine() || sc.rest() != "gamma" || sc.number(value))
+    return TEST_FAILED;
+  if (sc.nextLine())
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+static int test_cpuStat() {
+  CgroupCpuStat stat;
+  if (!parseCpuStat(cpuStatText, stat))
+    return TEST_FAILED;
+  if (stat.usage_usec != 1159803131 || stat.user_usec != 1048414293 ||
+      stat.system_usec != 111388837 || stat.nr_periods != 100 ||
+      stat.nr_throttled != 7 || stat.throttled_usec != 123456)
+    return TEST_FAILED;
+  if (parseCpuStat("usage_usec abc\n", stat))
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+static int test_memoryStat() {
+  CgroupMemoryStat stat;
+  if (!parseMemoryStat(makeMemoryStat(1000), stat))
+    return TEST_FAILED;
+  // the values grow by 4096 in the order of memoryStatKeys
+  if (stat.anon != 1000 || stat.file != 1000 + 4096 ||
+      stat.slab != 1000 + 26 * 4096 || stat.pgmajfault != 1000 + 41 * 4096 ||
+      stat.workingset_refault_file != 1000 + 28 * 4096)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+static int test_ioStat() {
+  string text = makeIoStat(700);
+  CgroupIoStat stat;
+  if (!parseIoStat(text, 8, 0, stat))
+    return TEST_FAILED;
+  if (stat.major != 8 || stat.minor != 0 || stat.rbytes != 2100 ||
+      stat.wbytes != 2800 || stat.rios != 11 || stat.wios != 12 ||
+      stat.dbytes != 13 || stat.dios != 14)
+    return TEST_FAILED;
+  if (!parseIoStat(text, 259, 0, stat) || stat.rbytes != 700 ||
+      stat.wios != 140)
+    return TEST_FAILED;
+  if (parseIoStat(text, 8, 16, stat))
+    return TEST_FAILED;
+  if (parseIoStat("8:0 rbytes=12 wbytes\n", 8, 0, stat))
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+static int test_procStatCpus() {
+  string text = makeProcStat(4);
+  ProcStatCpu cpus[8];
+  size_t n = parseProcStatCpus(text, cpus, 8);
+  if (n != 5)
+    return TEST_FAILED;
+  if (cpus[0].cpu != -1 || cpus[0].user != 104841 || cpus[0].nice != 10 ||
+      cpus[0].steal != 5487)
+    return TEST_FAILED;
+  if (cpus[4].cpu != 3 || cpus[4].user != 104844 || cpus[4].idle != 412421)
+    return TEST_FAILED;
+  // only the requested number of lines
+  if (parseProcStatCpus(text, cpus, 2) != 2)
+    return TEST_FAILED;
+  // a line with missing times stops the parsing
+  if (parseProcStatCpus("cpu 1 2 3\ncpu0 1 2 3 4 5 6 7 8 9 10\n", cpus, 8) != 0)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Creates a temporary file with the specified content and returns
+ * its descriptor
+ */
+static int makeTempFile(const string &content) {
+  char path[] = "/tmp/teststatscannerXXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return -1;
+  unlink(path);
+  if (write(fd, content.data(), content.size()) !=
+      static_cast<ssize_t>(content.size())) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int test_scanLines() {
+  string content;
+  vector<string> expected;
+  for (int n = 0; n < 200; ++n) {
+    expected.push_back(to_string(n * 7919));
+    content += expected.back() + '\n';
+  }
+  // the last line has no newline
+  expected.push_back("4711");
+  content += "4711";
+  int fd = makeTempFile(content);
+  if (fd < 0)
+    return TEST_FAILED;
+  vector<string> lines;
+  bool ok = scanLines<16>(fd, [&lines](string_view line) {
+    lines.emplace_back(line);
+  });
+  if (!ok || lines != expected) {
+    close(fd);
+    return TEST_FAILED;
+  }
+  // a line longer than the buffer
+  ok = scanLines<4>(fd, [](string_view) {});
+  close(fd);
+  return ok ? TEST_FAILED : TEST_OK;
+}
+
+static int test_statBuffer() {
+  string text = makeProcStat(256);
+  int fd = makeTempFile(text);
+  if (fd < 0)
+    return TEST_FAILED;
+  StatBuffer<4096> small;
+  auto big = make_unique<StatBuffer<65536>>();
+  bool ok = small.read(fd) && big->read(fd);
+  close(fd);
+  if (!ok)
+    return TEST_FAILED;
+  // the small buffer keeps only complete lines
+  if (!small.truncated() || small.view().empty() ||
+      small.view().back() != '\n' ||
+      text.compare(0, small.view().size(), small.view()) != 0)
+    return TEST_FAILED;
+  if (big->truncated() || big->view() != text)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Sampling a file, once the buffers exist, must not allocate memory
+ */
+static int test_noAllocations() {
+  string memoryStat = makeMemoryStat(1);
+  string ioStat = makeIoStat(1);
+  int fd = makeTempFile(makeProcStat(256));
+  if (fd < 0)
+    return TEST_FAILED;
+  auto procStat = make_unique<StatBuffer<65536>>();
+  vector<ProcStatCpu> cpus(257);
+
+  long before = numAllocations;
+  bool ok = procStat->read(fd) &&
+            parseProcStatCpus(procStat->view(), cpus.data(), cpus.size()) ==
+                cpus.size();
+  CgroupCpuStat cpuStat;
+  CgroupMemoryStat memStat;
+  CgroupIoStat ioStatValues;
+  ok = ok && parseCpuStat(cpuStatText, cpuStat) &&
+       parseMemoryStat(memoryStat, memStat) &&
+       parseIoStat(ioStat, 8, 0, ioStatValues);
+  long allocations = numAllocations - before;
+  close(fd);
+  if (!ok || allocations != 0) {
+    cout << "allocations while sampling: " << allocations << endl;
+    return TEST_FAILED;
+  }
+  return TEST_OK;
+}
+
+/*!
+ * The parsing before StatScanner: getline, istringstream and maps
+ */
+struct LegacyCpuTime {
+  string name;
+  uint64_t times[10];
+};
+
+static int legacyProcStat(const string &content, vector<LegacyCpuTime> &cpus) {
+  istringstream ifs(content);
+  int n = 0;
+  for (LegacyCpuTime &ct : cpus) {
+    string line;
+    if (!getline(ifs, line) || line.compare(0, 3, "cpu") != 0)
+      break;
+    istringstream is(line);
+    string name;
+    uint64_t t[10];
+    is >> name >> t[0] >> t[1] >> t[2] >> t[3] >> t[4] >> t[5] >> t[6] >>
+        t[7] >> t[8] >> t[9];
+    if (is.fail())
+      break;
+    ct.name = name;
+    copy(begin(t), end(t), begin(ct.times));
+    ++n;
+  }
+  return n;
+}
+
+static map<string, uint64_t> legacyFlatKeyed(const string &content) {
+  vector<string> lines;
+  istringstream in(content);
+  string line;
+  while (getline(in, line))
+    lines.push_back(line);
+  map<string, uint64_t> tags;
+  for (auto &l : lines) {
+    string tag;
+    uint64_t value;
+    istringstream is(l);
+    is >> tag >> value;
+    if (is.fail())
+      break;
+    tags.emplace(tag, value);
+  }
+  return tags;
+}
+
+static map<string, uint64_t> legacyIoStat(const string &content,
+                                          const string &device) {
+  istringstream in(content);
+  string line;
+  map<string, uint64_t> tags;
+  while (getline(in, line)) {
+    istringstream is(line);
+    string dev, kv;
+    is >> dev;
+    if (dev != device)
+      continue;
+    while (is >> kv) {
+      size_t pos = kv.find('=');
+      tags.emplace(kv.substr(0, pos), stoull(kv.substr(pos + 1)));
+    }
+    break;
+  }
+  return tags;
+}
+
+/*!
+ * Parses a /proc/stat of 256 processing units and the cpu.stat,
+ * memory.stat and io.stat files of 1000 applications, as one sample
+ * of the PlatformMonitor and of a policy which reads the statistics
+ * of all the applications.
+ */
+static int benchmark_sample() {
+  constexpr int NUM_PU = 256;
+  constexpr int NUM_APPS = 1000;
+  constexpr int NUM_SAMPLES = 20;
+
+  string procStat = makeProcStat(NUM_PU);
+  vector<string> memoryStats, ioStats;
+  for (int i = 0; i < NUM_APPS; ++i) {
+    memoryStats.push_back(makeMemoryStat(i * 4096));
+    ioStats.push_back(makeIoStat(i * 512));
+  }
+  string cpuStat = cpuStatText;
+
+  uint64_t checkLegacy = 0, checkScanner = 0;
+
+  vector<LegacyCpuTime> legacyCpus(NUM_PU + 1);
+  long before = numAllocations;
+  KonroTimer timer;
+  for (int s = 0; s < NUM_SAMPLES; ++s) {
+    checkLegacy += legacyProcStat(procStat, legacyCpus);
+    for (int i = 0; i < NUM_APPS; ++i) {
+      checkLegacy += legacyFlatKeyed(cpuStat)["usage_usec"];
+      checkLegacy += legacyFlatKeyed(memoryStats[i])["anon"];
+      checkLegacy += legacyIoStat(ioStats[i], "8:0")["rbytes"];
+    }
+  }
+  long legacyMicros = timer.Elapsed().count();
+  long legacyAllocations = numAllocations - before;
+
+  vector<ProcStatCpu> cpus(NUM_PU + 1);
+  before = numAllocations;
+  timer.Restart();
+  for (int s = 0; s < NUM_SAMPLES; ++s) {
+    checkScanner += parseProcStatCpus(procStat, cpus.data(), cpus.size());
+    for (int i = 0; i < NUM_APPS; ++i) {
+      CgroupCpuStat cs;
+      CgroupMemoryStat ms;
+      CgroupIoStat is;
+      parseCpuStat(cpuStat, cs);
+      parseMemoryStat(memoryStats[i], ms);
+      parseIoStat(ioStats[i], 8, 0, is);
+      checkScanner += cs.usage_usec + ms.anon + is.rbytes;
+    }
+  }
+  long scannerMicros = timer.Elapsed().count();
+  long scannerAllocations = numAllocations - before;
+
+  cout << "benchmark sample of /proc/stat with " << NUM_PU << " PUs and "
+       << NUM_APPS << " x cpu.stat, memory.stat, io.stat, per sample: legacy "
+       << legacyMicros / NUM_SAMPLES << " us, "
+       << legacyAllocations / NUM_SAMPLES << " allocations; StatScanner "
+       << scannerMicros / NUM_SAMPLES << " us, "
+       << scannerAllocations / NUM_SAMPLES << " allocations" << endl;
+
+  if (checkLegacy != checkScanner || scannerAllocations != 0)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+int main() {
+  if (test_parseNumber() != TEST_OK)
+    return TEST_FAILED;
+  if (test_scanner() != TEST_OK)
+    return TEST_FAILED;
+  if (test_cpuStat() != TEST_OK)
+    return TEST_FAILED;
+  if (test_memoryStat() != TEST_OK)
+    return TEST_FAILED;
+  if (test_ioStat() != TEST_OK)
+    return TEST_FAILED;
+  if (test_procStatCpus() != TEST_OK)
+    return TEST_FAILED;
+  if (test_scanLines() != TEST_OK)
+    return TEST_FAILED;
+  if (test_statBuffer() != TEST_OK)
+    return TEST_FAILED;
+  if (test_noAllocations() != TEST_OK)
+    return TEST_FAILED;
+  if (benchmark_sample() != TEST_OK)
+    return TEST_FAILED;
+
+  return TEST_OK;
+}
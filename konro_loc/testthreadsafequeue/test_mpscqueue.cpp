@@ -0,0 +1,241 @@
+#include "mpscqueue.h"
+#include "lanequeue.h"
+#include "threadsafequeue.h"
+#include "timer.h"
+#include "unittest.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static int testMpscQueue1() {
+  rmcommon::MpscQueue<int, 4> queue;
+  queue.push(1);
+  queue.push(2);
+  queue.push(3);
+
+  int val;
+  if (!queue.tryPop(val) || val != 1)
+    return TEST_FAILED;
+  if (!queue.tryPop(val) || val != 2)
+    return TEST_FAILED;
+  if (!queue.tryPop(val) || val != 3)
+    return TEST_FAILED;
+  if (!queue.empty())
+    return TEST_FAILED;
+  // wrap around the ring
+  for (int i = 0; i < 10; ++i) {
+    queue.push(i);
+    if (!queue.tryPop(val) || val != i)
+      return TEST_FAILED;
+  }
+  return TEST_OK;
+}
+
+static int testMpscQueue2() {
+  rmcommon::MpscQueue<int> queue;
+  int val;
+  if (queue.waitAndPop(val, std::chrono::milliseconds(100)))
+    return TEST_FAILED;
+  vector<int> batch;
+  if (queue.waitAndDrain(batch, std::chrono::milliseconds(100)) != 0)
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Tests that drain() returns all the pending values in FIFO order
+ * and respects the maximum batch size
+ */
+static int testMpscQueue3() {
+  rmcommon::MpscQueue<int> queue;
+  for (int i = 0; i < 100; ++i)
+    queue.push(i);
+  vector<int> batch;
+  if (queue.drain(batch, 60) != 60)
+    return TEST_FAILED;
+  if (queue.drain(batch) != 40)
+    return TEST_FAILED;
+  for (int i = 0; i < 100; ++i) {
+    if (batch[i] != i)
+      return TEST_FAILED;
+  }
+  return queue.empty() ? TEST_OK : TEST_FAILED;
+}
+
+/*!
+ * Tests multiple producers in separate threads. The ring is smaller
+ * than the number of values, so producers also hit the "queue full" path.
+ * Values of each producer must be received in order.
+ *
+ * \return Outcome of the test
+ */
+static int testMpscQueue4() {
+  constexpr int NUM_PRODUCERS = 4;
+  constexpr int NUM_VALUES = 100000;
+  rmcommon::MpscQueue<int, 256> queue;
+  vector<thread> producers;
+  for (int p = 0; p < NUM_PRODUCERS; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (int i = 0; i < NUM_VALUES; ++i)
+        queue.push(p * NUM_VALUES + i);
+    });
+  }
+
+  vector<int> last(NUM_PRODUCERS, -1);
+  vector<int> batch;
+  long received = 0;
+  bool ordered = true;
+  while (received < NUM_PRODUCERS * NUM_VALUES) {
+    if (queue.waitAndDrain(batch, chrono::milliseconds(1000)) == 0)
+      break;
+    for (int v : batch) {
+      int p = v / NUM_VALUES;
+      if (v % NUM_VALUES != last[p] + 1)
+        ordered = false;
+      last[p] = v % NUM_VALUES;
+    }
+    received += batch.size();
+    batch.clear();
+  }
+  for (auto &t : producers)
+    t.join();
+  if (received != NUM_PRODUCERS * NUM_VALUES || !ordered) {
+    cout << "Expected " << NUM_PRODUCERS * NUM_VALUES << " ordered values, got "
+         << received << (ordered ? " ordered" : " unordered") << endl;
+    return TEST_FAILED;
+  }
+  return TEST_OK;
+}
+
+/*!
+ * Tests that a consumer waiting without timeout is released
+ * by a push and by interrupt()
+ */
+static int testMpscQueue5() {
+  rmcommon::MpscQueue<int> queue;
+  vector<int> batch;
+  size_t first = 0, second = 1;
+  thread consumer([&] {
+    first = queue.waitAndDrain(batch);
+    second = queue.waitAndDrain(batch);
+  });
+  this_thread::sleep_for(chrono::milliseconds(50));
+  queue.push(42);
+  this_thread::sleep_for(chrono::milliseconds(50));
+  rmcommon::KonroTimer timer;
+  queue.interrupt();
+  consumer.join();
+  if (first != 1 || second != 0 || batch.size() != 1 || batch[0] != 42)
+    return TEST_FAILED;
+  // the consumer must not wait for a timeout
+  return timer.Elapsed() < chrono::milliseconds(1000) ? TEST_OK : TEST_FAILED;
+}
+
+/*!
+ * Tests that higher priority lanes are drained first and that
+ * lower priority lanes still get their quota at each round
+ */
+static int testLaneQueue() {
+  rmcommon::LaneQueue<int, 2> queue({4096, 2});
+  for (int i = 0; i < 5; ++i)
+    queue.push(100 + i, 1);
+  queue.push(1, 0);
+  queue.push(2, 0);
+  vector<int> batch;
+  if (queue.waitAndDrain(batch) != 4)
+    return TEST_FAILED;
+  if (batch != vector<int>{1, 2, 100, 101})
+    return TEST_FAILED;
+  queue.push(3, 0);
+  batch.clear();
+  queue.drain(batch);
+  if (batch != vector<int>{3, 102, 103})
+    return TEST_FAILED;
+  batch.clear();
+  queue.drain(batch);
+  if (batch != vector<int>{104} || !queue.empty())
+    return TEST_FAILED;
+  return TEST_OK;
+}
+
+/*!
+ * Pushes "numValues" values from each of "numProducers" threads
+ * and returns the time in microseconds needed by the consumer to
+ * receive all of them.
+ */
+template <typename Producer, typename Consumer>
+static long runBenchmark(int numProducers, int numValues, Producer produce,
+                         Consumer consume) {
+  rmcommon::KonroTimer timer;
+  vector<thread> producers;
+  for (int p = 0; p < numProducers; ++p) {
+    producers.emplace_back([&produce, numValues] {
+      for (int i = 0; i < numValues; ++i)
+        produce(i);
+    });
+  }
+  long expected = (long)numProducers * numValues;
+  long received = 0;
+  while (received < expected)
+    received += consume();
+  for (auto &t : producers)
+    t.join();
+  return (long)timer.Elapsed().count();
+}
+
+/*!
+ * Compares ThreadsafeQueue (one pop per wakeup) with MpscQueue
+ * (drain per wakeup), as used by BaseEventReceiver
+ */
+static int benchmarkQueues() {
+  constexpr int NUM_VALUES = 250000;
+  const chrono::milliseconds timeout(1000);
+
+  for (int numProducers : {1, 2, 4, 8}) {
+    rmcommon::ThreadsafeQueue<shared_ptr<int>> tsQueue;
+    long tsMicros = runBenchmark(
+        numProducers, NUM_VALUES,
+        [&tsQueue](int i) { tsQueue.push(make_shared<int>(i)); },
+        [&tsQueue, &timeout]() -> long {
+          shared_ptr<int> v;
+          return tsQueue.waitAndPop(v, timeout) ? 1 : 0;
+        });
+
+    rmcommon::MpscQueue<shared_ptr<int>> mpscQueue;
+    vector<shared_ptr<int>> batch;
+    long mpscMicros = runBenchmark(
+        numProducers, NUM_VALUES,
+        [&mpscQueue](int i) { mpscQueue.push(make_shared<int>(i)); },
+        [&mpscQueue, &batch, &timeout]() -> long {
+          long n = mpscQueue.waitAndDrain(batch, timeout);
+          batch.clear();
+          return n;
+        });
+
+    cout << "benchmark " << numProducers << " producer(s) x " << NUM_VALUES
+         << " events: ThreadsafeQueue " << tsMicros << " us, MpscQueue "
+         << mpscMicros << " us" << endl;
+  }
+  return TEST_OK;
+}
+
+int main() {
+  if (testMpscQueue1() != TEST_OK)
+    return TEST_FAILED;
+  if (testMpscQueue2() != TEST_OK)
+    return TEST_FAILED;
+  if (testMpscQueue3() != TEST_OK)
+    return TEST_FAILED;
+  if (testMpscQueue4() != TEST_OK)
+    return TEST_FAILED;
+  if (testMpscQueue5() != TEST_OK)
+    return TEST_FAILED;
+  if (testLaneQueue() != TEST_OK)
+    return TEST_FAILED;
+  if (benchmarkQueues() != TEST_OK)
+    return TEST_FAILED;
+
+  return TEST_OK;
+}